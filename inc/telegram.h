@@ -5,6 +5,25 @@
 #include <stdbool.h>
 #include <stdlib.h>
 #include "telegram_parse.h"
+#include "telegram_io.h"
+#include "telegram_cache.h"
+#include "telegram_stats.h"
+#include "telegram_mem.h"
+#include "telegram_trace.h"
+#include "telegram_webhook.h"
+#include "telegram_coalesce.h"
+#include "telegram_live.h"
+#include "telegram_sender.h"
+#include "telegram_img.h"
+#include "telegram_rec.h"
+#include "telegram_snap.h"
+#include "telegram_session.h"
+#include "telegram_fsm.h"
+#include "telegram_cbdata.h"
+#include "telegram_ack.h"
+#include "telegram_lane.h"
+#include "telegram_response.h"
+#include "telegram_deadchat.h"
 
 #define TELEGRAM_MAX_TOKEN_LEN 	128U
 
@@ -27,7 +46,7 @@ typedef struct
 {
 	uint8_t  *buf;
 	uint32_t pice_size;
-	uint32_t total_size;
+	uint32_t total_size; /** 0 if the length of the downloaded file is unknown (chunked answer) */
 	uint32_t offset;
 } telegram_write_data_evt_t;
 
@@ -39,18 +58,200 @@ void telegram_send_file_full(void *teleCtx_ptr, telegram_int_t chat_id, char *ca
 void telegram_send_file(void *teleCtx_ptr, telegram_int_t chat_id, char *caption, char *filename, uint32_t total_len,
 	void *ctx, telegram_evt_cb_t cb);
 
+/**
+* Uploads file from memory regions, they are written to the connection without copying.
+* Parts with a producer callback (data == NULL) are pulled through the io buffer.
+* Upload that is made only of memory parts is retried on transient failures.
+*/
+bool telegram_send_file_iov(void *teleCtx_ptr, telegram_int_t chat_id, const char *caption, const char *filename,
+	const telegram_io_part_t *iov, uint32_t count, telegram_file_type_t file_type);
+
+/** Uploads contiguous buffer, e.g. camera frame buffer, without copying */
+bool telegram_send_file_mem(void *teleCtx_ptr, telegram_int_t chat_id, const char *caption, const char *filename,
+	const uint8_t *data, uint32_t len, telegram_file_type_t file_type);
+
+#define TELEGRAM_MEDIA_GROUP_MIN (2U)
+#define TELEGRAM_MEDIA_GROUP_MAX (10U)
+
+/** Item of the album */
+typedef struct
+{
+	telegram_file_type_t type; /** Photos and documents can not be mixed in one album */
+	const char *filename;
+	const char *caption;       /** Optional */
+	telegram_io_part_t data;   /** Memory region or producer callback of the file */
+} telegram_media_t;
+
+/**
+* Sends 2-10 photos or documents as an album in one multipart request (sendMediaGroup),
+* items are streamed in order, each from its own memory region or producer callback.
+*/
+bool telegram_send_media_group(void *teleCtx_ptr, telegram_int_t chat_id, const telegram_media_t *media, uint32_t count);
+
+/** Uploads len bytes read from the current position of the file descriptor */
+bool telegram_send_file_fd(void *teleCtx_ptr, telegram_int_t chat_id, const char *caption, const char *filename,
+	int fd, uint32_t len, telegram_file_type_t file_type);
+
 void telegram_get_file(void *teleCtx_ptr, const char *file_id, void *ctx, telegram_evt_cb_t cb);
 
+/**
+* Downloads file starting from the offset. Dropped connections are resumed internally with HTTP Range
+* requests, TELEGRAM_WRITE_DATA events carry the offset of the piece so the sink may be sparse.
+* If the transfer still fails TELEGRAM_ERR is reported with the offset of the first not written byte,
+* call this function again with that offset to continue the download.
+*/
+void telegram_get_file_from(void *teleCtx_ptr, const char *file_id, uint32_t offset, void *ctx, telegram_evt_cb_t cb);
+
 void telegram_kbrd(void *teleCtx_ptr, telegram_int_t chat_id, const char *message, telegram_kbrd_t *kbrd);
 void telegram_send_text_message(void *teleCtx_ptr, telegram_int_t chat_id, const char *message);
 void telegram_send_text(void *teleCtx_ptr, telegram_int_t chat_id, telegram_kbrd_t *kbrd, const char *fmt, ...);
 
 void telegram_stop(void *teleCtx);
+
+/** Returns download url of the file, memory should be freed with telegram_free */
 char *telegram_get_file_path(void *teleCtx_ptr, const char *file_id);
 
+/** Hit and miss counters of the file_id -> download url cache used by telegram_get_file_path */
+void telegram_get_file_cache_stats(void *teleCtx_ptr, telegram_cache_stats_t *stats);
+
+
+/**
+* Snapshot of per method request counters and latency histograms, see telegram_stats_t.
+* Each method is copied consistently, but methods are copied one by one.
+*/
+void telegram_get_stats(void *teleCtx_ptr, telegram_stats_t *stats);
+void telegram_reset_stats(void *teleCtx_ptr);
 
 void *telegram_init(const char *token, uint32_t message_limit, telegram_on_msg_cb_t cb);
 
+/**
+* Enables merging of plain text messages: consecutive texts for the same chat sent within window_ms
+* are joined with new line and sent as one message of up to TELEGRAM_MESSAGE_MAX_LEN characters.
+* Messages with keyboard flush pending text and are sent immediately. 0 disables coalescing.
+*/
+void telegram_set_coalescing(void *teleCtx_ptr, uint32_t window_ms);
+
+/**
+* Enables per user session store, see telegram_session_init. NULL cfg disables it, existing sessions are saved and dropped.
+* Expired sessions are dropped after each batch of updates. If called while a batch is dispatched by another task,
+* waits for the batch to end. Sessions of the previous store are invalid after the call.
+*/
+bool telegram_set_sessions(void *teleCtx_ptr, const telegram_session_cfg_t *cfg);
+
+/**
+* Enables suppression of requests to chats which failed permanently (bot blocked, chat not found, group migrated).
+* Messages and edits to such chats fail locally until the entry expires, the chat sends an update
+* (message, edit or button press) or it is cleared.
+* capacity 0 disables it, ttl_sec 0 - TELEGRAM_DEADCHAT_TTL_SEC. Call before sending starts.
+*/
+bool telegram_set_dead_chats(void *teleCtx_ptr, uint32_t capacity, uint32_t ttl_sec);
+
+/** Forgets dead chat, chat_id 0 clears all entries */
+void telegram_clear_dead_chat(void *teleCtx_ptr, telegram_int_t chat_id);
+
+void telegram_get_dead_chat_stats(void *teleCtx_ptr, telegram_deadchat_stats_t *stats);
+
+/** Session store of the bot for direct access with telegram_session_* functions, NULL if disabled */
+void *telegram_get_session_store(void *teleCtx_ptr);
+
+/**
+* Session of the update sender, or of the chat for channel posts, created if missing. Does not allocate.
+* Call telegram_session_mark_dirty(telegram_get_session_store(bot), session) after changes to persist them.
+*
+* @return NULL if sessions are disabled or the update has no sender
+*/
+void *telegram_get_session(void *teleCtx_ptr, telegram_update_t *upd);
+
+/**
+* Creates multiplexer: one poller task and one connection to api.telegram.org shared by several bots.
+* Bots added with telegram_mux_add are polled round-robin, returned handle is used with the regular API
+* and may be removed with telegram_stop. Statistics are accounted per multiplexer.
+*/
+void *telegram_mux_init(void);
+void *telegram_mux_add(void *mux, const char *token, uint32_t message_limit, telegram_on_msg_cb_t cb);
+
+/** Stops poller and all bots of the multiplexer */
+void telegram_mux_stop(void *mux);
+
+/**
+* Starts bot in webhook mode: updates are pushed by Telegram to the embedded server instead of polling.
+* setWebhook is called on init and deleteWebhook on telegram_stop. The callback is called from the server task.
+*/
+void *telegram_init_webhook(const char *token, const telegram_webhook_cfg_t *cfg, telegram_on_msg_cb_t cb);
+
 void telegram_answer_cb_query(void *teleCtx_ptr, const char *cid, const char *text, 
 	bool show_alert, const char *url, telegram_int_t cache_time);
+
+/**
+* Acknowledges callback queries automatically as soon as the update is parsed, before the message callback runs.
+* Answers go through a dedicated task over the interactive lane, so they do not wait for the message callback:
+* the poll connection is released before the updates are dispatched.
+* Policy may fill text or alert of the answer or return false to leave the query to the handler, NULL - empty answer.
+* Repeated answers of the same query from any answer function are suppressed: an answer of the handler with text,
+* alert or URL to an acknowledged query is dropped with a warning, the policy has to leave such queries to the handler.
+* A failed answer is forgotten, so the query may be answered again.
+*/
+bool telegram_set_auto_ack(void *teleCtx_ptr, bool enable, telegram_ack_policy_t policy, void *ctx);
+
+/**
+* Moves method to another priority lane. By default all lanes share the poll connection and the lane is the
+* class of the request: when the connection is released, waiting interactive requests go before normal ones and
+* normal before bulk, an upload already in progress still delays them. With TELEGRAM_LANES_ENABLE each lane has
+* its own connection and lock, so uploads on the bulk lane never delay interactive replies.
+* Bots of one multiplexer share the lanes.
+*/
+bool telegram_set_method_lane(void *teleCtx_ptr, telegram_method_t method, telegram_lane_t lane);
+
+/** Sends message bypassing coalescing, returns message_id of the sent message or -1 */
+telegram_int_t telegram_send_message_get_id(void *teleCtx_ptr, telegram_int_t chat_id, const char *message, 
+	telegram_kbrd_t *kbrd);
+
+/** Sends message over the given lane bypassing coalescing, e.g. alarms on the interactive lane */
+bool telegram_send_message_lane(void *teleCtx_ptr, telegram_int_t chat_id, const char *message, 
+	telegram_kbrd_t *kbrd, telegram_lane_t lane);
+
+/**
+* Edits text and inline keyboard of the message sent by the bot (editMessageText),
+* if message is NULL only the keyboard is replaced (editMessageReplyMarkup).
+*/
+bool telegram_edit_message(void *teleCtx_ptr, telegram_int_t chat_id, telegram_int_t message_id, 
+	const char *message, telegram_kbrd_t *kbrd);
+
+/**
+* Starts sender task of the bot, required for *_async functions. Requests are queued and executed in order,
+* the caller does not wait for them, which also allows to send from the message callback.
+* queue_len 0 - TELEGRAM_SENDER_QUEUE_LEN. The sender is stopped with the bot after queued requests are executed.
+*/
+bool telegram_start_async(void *teleCtx_ptr, uint32_t queue_len);
+
+/** Queue message, cb receives status and the sent message. Returns false if the queue is full */
+bool telegram_send_message_async(void *teleCtx_ptr, telegram_int_t chat_id, const char *message, 
+	telegram_kbrd_t *kbrd, telegram_send_done_cb_t cb, void *ctx);
+
+bool telegram_edit_message_async(void *teleCtx_ptr, telegram_int_t chat_id, telegram_int_t message_id, 
+	const char *message, telegram_kbrd_t *kbrd, telegram_send_done_cb_t cb, void *ctx);
+
+bool telegram_answer_cb_query_async(void *teleCtx_ptr, const char *cid, const char *text, 
+	bool show_alert, const char *url, telegram_int_t cache_time, telegram_send_done_cb_t cb, void *ctx);
+
+/**
+* Queue request with the payload made by telegram_make_*, the payload is freed by the library in any case.
+* chat_id is used for dead chat suppression, 0 if the request is not addressed to a chat. Does not block.
+*/
+bool telegram_request_async(void *teleCtx_ptr, telegram_method_t method, telegram_int_t chat_id, char *payload, 
+	telegram_send_done_cb_t cb, void *ctx);
+
+/**
+* Answers the update being dispatched in webhook mode inside the webhook HTTP response, saving a request.
+* Must be called from the message callback, only one method per update can be answered this way.
+* Returns false if the reply can not be inlined, the caller should send it in the regular way then.
+*/
+bool telegram_webhook_reply(void *teleCtx_ptr, telegram_method_t method, const char *payload);
+
+/** Send message inline when called from webhook dispatch, otherwise as a regular request */
+void telegram_reply_message(void *teleCtx_ptr, telegram_int_t chat_id, const char *message, telegram_kbrd_t *kbrd);
+
+/** Answer callback query inline when called from webhook dispatch, otherwise as a regular request */
+void telegram_reply_cb_query(void *teleCtx_ptr, const char *cid, const char *text, 
+	bool show_alert, const char *url, telegram_int_t cache_time);
 #endif // TELEGRAM_H
\ No newline at end of file
@@ -0,0 +1,46 @@
+#ifndef TELEGRAM_ACK_H
+#define TELEGRAM_ACK_H
+#include <stdint.h>
+#include <stdbool.h>
+#include "telegram_parse.h"
+
+/** Number of recently answered callback queries remembered for duplicate suppression */
+#define TELEGRAM_ACK_HISTORY (16U)
+/** Max length of the query id, longer ids are not forgotten if their queued answer fails */
+#define TELEGRAM_ACK_ID_MAX_LEN (64U)
+/** Max number of acknowledgements waiting for the ack task */
+#define TELEGRAM_ACK_QUEUE_LEN (8U)
+
+/** Answer sent by automatic acknowledgement, empty answer only stops the spinner */
+typedef struct
+{
+	const char *text;          /** Opt. notification text, copied */
+	bool show_alert;           /** Show alert instead of notification */
+	const char *url;           /** Opt. URL to open */
+	telegram_int_t cache_time; /** Seconds the answer may be cached on the client */
+} telegram_ack_t;
+
+/**
+* Called from the dispatch task before the message callback for each callback query
+* @return false to leave the query to the message callback, e.g. when the answer depends on the handler
+*/
+typedef bool(*telegram_ack_policy_t)(void *teleCtx_ptr, const telegram_chat_callback_t *query, telegram_ack_t *ack, void *ctx);
+
+/** Hashes of answered query ids, ring buffer */
+typedef struct
+{
+	uint32_t ids[TELEGRAM_ACK_HISTORY];
+	uint32_t pos;
+} telegram_ack_history_t;
+
+/**
+* @brief Remember query id as answered
+*
+* @return false if the query was already answered, answer should be suppressed
+*/
+bool telegram_ack_history_add(telegram_ack_history_t *history, const char *cid);
+
+/** Forget query id, e.g. when its answer could not be queued, so the next answer is not suppressed */
+void telegram_ack_history_remove(telegram_ack_history_t *history, const char *cid);
+
+#endif /* TELEGRAM_ACK_H */
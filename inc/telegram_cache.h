@@ -0,0 +1,46 @@
+#ifndef TELEGRAM_CACHE_H
+#define TELEGRAM_CACHE_H
+#include <stdint.h>
+#include <stdbool.h>
+
+/** Number of file_id -> download url entries kept by the file path cache */
+#define TELEGRAM_FILE_CACHE_SIZE    (8U)
+/** Telegram keeps download links valid for at least one hour, keep some margin */
+#define TELEGRAM_FILE_CACHE_TTL_SEC (55U * 60U)
+
+typedef struct
+{
+	uint32_t hits;   /** Lookups served from the cache */
+	uint32_t misses; /** Lookups that required a round trip */
+} telegram_cache_stats_t;
+
+/**
+* @brief Create bounded LRU cache of strings with expiration time
+*
+* @param size max number of entries
+* @param ttl_sec lifetime of an entry in seconds
+*
+* @return NULL or cache handle
+*/
+void *telegram_cache_init(uint32_t size, uint32_t ttl_sec);
+
+/**
+* @brief Find value by key, expired entries are dropped
+* Memory should be freed
+*
+* @return copy of the value or NULL
+*/
+char *telegram_cache_get(void *cache, const char *key);
+
+/**
+* @brief Add or replace entry, least recently used entry is evicted if cache is full
+*/
+void telegram_cache_put(void *cache, const char *key, const char *value);
+
+void telegram_cache_remove(void *cache, const char *key);
+
+void telegram_cache_get_stats(void *cache, telegram_cache_stats_t *stats);
+
+void telegram_cache_free(void *cache);
+
+#endif /* TELEGRAM_CACHE_H */
@@ -0,0 +1,68 @@
+/**
+* Typed callback_data codec: small payload (action, integer arguments, short token) is packed to bytes
+* with zigzag varints, protected with a check byte and encoded with unpadded base64url, which is JSON safe.
+* Optional prefix is prepended as "prefix:", so telegram_fsm can route buttons by the prefix.
+*/
+#ifndef TELEGRAM_CBDATA_H
+#define TELEGRAM_CBDATA_H
+#include <stdint.h>
+#include <stdbool.h>
+#include "telegram_parse.h"
+
+/** Telegram limit of the callback_data in bytes */
+#define TELEGRAM_CBDATA_MAX_LEN (64U)
+#define TELEGRAM_CBDATA_MAX_ARGS (4U)
+#define TELEGRAM_CBDATA_TOKEN_MAX_LEN (24U)
+
+typedef struct
+{
+	uint8_t action;                                  /** Application defined action identifier */
+	uint8_t argc;                                    /** Number of used args */
+	int64_t args[TELEGRAM_CBDATA_MAX_ARGS];          /** Integer arguments, small absolute values take less space */
+	char token[TELEGRAM_CBDATA_TOKEN_MAX_LEN + 1];   /** Opt. short string, empty if not used */
+} telegram_cbdata_t;
+
+/** Button of the generated keyboard */
+typedef struct
+{
+	const char *text;       /** Label, must stay valid while the keyboard is used, JSON special characters are not escaped */
+	telegram_cbdata_t data;
+} telegram_cbdata_btn_t;
+
+/**
+* @brief Encode payload to the callback_data string
+*
+* @param prefix optional route prefix, must not contain ':'
+* @param data payload
+* @param out output buffer, TELEGRAM_CBDATA_MAX_LEN + 1 is always enough
+* @param out_size size of the output buffer
+*
+* @return length of the string or 0 if it does not fit TELEGRAM_CBDATA_MAX_LEN or the buffer
+*/
+uint32_t telegram_cbdata_encode(const char *prefix, const telegram_cbdata_t *data, char *out, uint32_t out_size);
+
+/**
+* @brief Decode callback_data, nothing is allocated
+*
+* @param str callback_data, prefix up to ':' is skipped if present
+* @param data decoded payload
+*
+* @return false if the string is not a valid payload
+*/
+bool telegram_cbdata_decode(const char *str, telegram_cbdata_t *data);
+
+/**
+* @brief Make inline keyboard from the array of buttons, all rows and buttons are in one allocation
+* Free with telegram_free
+*
+* @param prefix optional route prefix of all buttons
+* @param btns buttons
+* @param count number of buttons
+* @param per_row buttons in a row, 0 - all buttons in one row
+*
+* @return NULL or keyboard
+*/
+telegram_kbrd_t *telegram_cbdata_make_kbrd(const char *prefix, const telegram_cbdata_btn_t *btns, uint32_t count,
+	uint32_t per_row);
+
+#endif /* TELEGRAM_CBDATA_H */
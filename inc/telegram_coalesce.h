@@ -0,0 +1,46 @@
+#ifndef TELEGRAM_COALESCE_H
+#define TELEGRAM_COALESCE_H
+#include <stdint.h>
+#include <stdbool.h>
+#include "telegram_parse.h"
+
+/** Max length of the message text accepted by Telegram */
+#define TELEGRAM_MESSAGE_MAX_LEN (4096U)
+
+/** Separator between merged texts, goes to JSON string as is */
+#define TELEGRAM_COALESCE_SEPARATOR "\\n"
+
+#define TELEGRAM_COALESCE_TASK_STACK (5120U)
+
+/** Called to send merged text, from the coalescer task or from the pushing task */
+typedef void(*telegram_coalesce_flush_t)(void *ctx, telegram_int_t chat_id, const char *text);
+
+/**
+* @brief Start coalescer, consecutive texts for the same chat pushed within the window are sent as one message
+*
+* @param window_ms how long the first pending text waits for more texts
+* @param flush callback to send the merged text
+* @param ctx argument of the callback
+*
+* @return NULL or coalescer handle
+*/
+void *telegram_coalesce_init(uint32_t window_ms, telegram_coalesce_flush_t flush, void *ctx);
+
+/**
+* @brief Queue text, pending text of other chat is flushed first
+*
+* @return false if the text can not be merged (too long), it should be sent directly then
+*/
+bool telegram_coalesce_push(void *coalesce, telegram_int_t chat_id, const char *text);
+
+/**
+* @brief Send pending text now
+*/
+void telegram_coalesce_flush(void *coalesce);
+
+/**
+* @brief Flush pending text and stop coalescer
+*/
+void telegram_coalesce_stop(void *coalesce);
+
+#endif /* TELEGRAM_COALESCE_H */
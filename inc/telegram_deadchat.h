@@ -0,0 +1,55 @@
+#ifndef TELEGRAM_DEADCHAT_H
+#define TELEGRAM_DEADCHAT_H
+#include <stdint.h>
+#include <stdbool.h>
+#include "telegram_parse.h"
+#include "telegram_response.h"
+
+/** Default number of remembered dead chats, rounded up to a power of 2 */
+#define TELEGRAM_DEADCHAT_CAPACITY (64U)
+/** Users may unblock the bot, so entries are forgotten after a while */
+#define TELEGRAM_DEADCHAT_TTL_SEC  (6U * 3600U)
+
+typedef struct
+{
+	uint32_t entries;    /** Chats currently suppressed */
+	uint32_t added;      /** Chats recorded as dead */
+	uint32_t suppressed; /** Requests failed locally without a round trip */
+	uint32_t evicted;    /** Live entries replaced because the set was full */
+} telegram_deadchat_stats_t;
+
+/**
+* @brief Create set of chats which returned permanent errors, entries expire after ttl_sec
+*
+* @return NULL or set handle
+*/
+void *telegram_deadchat_init(uint32_t capacity, uint32_t ttl_sec);
+
+/**
+* @brief Error classes after which requests to the chat will fail until something changes:
+* bot blocked or kicked, chat not found, group migrated to supergroup
+*/
+bool telegram_deadchat_is_permanent(const telegram_response_t *resp);
+
+/**
+* @brief Remember chat as dead, the entry with the earliest expiration is replaced if there is no room
+*/
+void telegram_deadchat_add(void *set, telegram_int_t chat_id, int32_t error_code);
+
+/**
+* @brief Check chat before the request, counts suppressed requests
+*
+* @return error_code the chat was recorded with or 0 if it is not known as dead
+*/
+int32_t telegram_deadchat_check(void *set, telegram_int_t chat_id);
+
+/** Forget one chat, e.g. when the user writes to the bot again */
+void telegram_deadchat_remove(void *set, telegram_int_t chat_id);
+
+void telegram_deadchat_clear(void *set);
+
+void telegram_deadchat_get_stats(void *set, telegram_deadchat_stats_t *stats);
+
+void telegram_deadchat_free(void *set);
+
+#endif /* TELEGRAM_DEADCHAT_H */
@@ -0,0 +1,103 @@
+/**
+* Table driven conversation state machine. Transitions are declared statically and compiled on init
+* to a hash table keyed by (state, event, match), so dispatch of an update is a few table lookups
+* regardless of the number of transitions. Current state of each chat is kept in a session store.
+*/
+#ifndef TELEGRAM_FSM_H
+#define TELEGRAM_FSM_H
+#include <stdint.h>
+#include <stdbool.h>
+#include "telegram_parse.h"
+#include "telegram_session.h"
+
+typedef uint8_t telegram_fsm_state_t;
+
+#define TELEGRAM_FSM_ANY     (0xFFU) /** from: transition applies in every state */
+#define TELEGRAM_FSM_SAME    (0xFEU) /** to: keep current state */
+#define TELEGRAM_FSM_DEFAULT (0xFFU) /** Returned by action: go to the state given by the transition */
+#define TELEGRAM_FSM_MAX_STATES (0xFEU)
+
+/** Callback data is matched by the part before the separator, the rest is passed to the action */
+#define TELEGRAM_FSM_CB_SEP ':'
+
+/** Event of the update */
+typedef enum
+{
+	TELEGRAM_FSM_ON_ANY,      /** Any update, match is ignored */
+	TELEGRAM_FSM_ON_COMMAND,  /** Text starting with '/', match is the command e.g. "/start", empty - any command */
+	TELEGRAM_FSM_ON_CALLBACK, /** Callback query, match is the data prefix, empty - any data */
+	TELEGRAM_FSM_ON_TEXT,     /** Text message which is not a command */
+	TELEGRAM_FSM_ON_DOCUMENT,
+	TELEGRAM_FSM_ON_PHOTO,
+	TELEGRAM_FSM_ON_LOCATION,
+	TELEGRAM_FSM_ON_CONTACT,
+	TELEGRAM_FSM_ON_COUNT
+} telegram_fsm_on_t;
+
+/** Event passed to the action */
+typedef struct
+{
+	telegram_int_t chat_id;
+	telegram_fsm_state_t state; /** State before the transition */
+	telegram_fsm_on_t on;
+	const char *arg;            /** Command arguments or callback data after the separator, never NULL */
+} telegram_fsm_event_t;
+
+/**
+* Action of the transition, called from the dispatch path
+* @return TELEGRAM_FSM_DEFAULT or state to go to instead of the declared one, e.g. to stay on invalid input
+*/
+typedef telegram_fsm_state_t(*telegram_fsm_action_t)(void *teleCtx, telegram_update_t *upd,
+	const telegram_fsm_event_t *evt, void *ctx);
+
+typedef struct
+{
+	telegram_fsm_state_t from;    /** State or TELEGRAM_FSM_ANY */
+	telegram_fsm_on_t on;
+	const char *match;            /** Command or callback data prefix, NULL - any */
+	telegram_fsm_state_t to;      /** Next state or TELEGRAM_FSM_SAME */
+	telegram_fsm_action_t action; /** Opt. */
+} telegram_fsm_transition_t;
+
+/**
+* Declaration of the machine, must stay valid while the machine is used.
+* Lookup order: exact match in the state, exact match in any state, any match in the state,
+* any match in any state, then TELEGRAM_FSM_ON_ANY in the state and in any state.
+* For equal keys the first declared transition wins.
+*/
+typedef struct
+{
+	const telegram_fsm_transition_t *transitions;
+	uint32_t count;
+	telegram_fsm_state_t initial; /** State of a chat without stored state */
+	void *ctx;                    /** Argument of actions */
+} telegram_fsm_def_t;
+
+/**
+* @brief Compile the machine
+*
+* @param def declaration
+* @param store_cfg configuration of the per chat state store, data_size is ignored, NULL - defaults.
+* Persistence callbacks get one byte of the state.
+*
+* @return NULL or machine handle
+*/
+void *telegram_fsm_init(const telegram_fsm_def_t *def, const telegram_session_cfg_t *store_cfg);
+
+/**
+* @brief Find transition for the update, run its action and move the chat to the next state
+* Call it from the message callback, not thread safe.
+*
+* @return true if a transition was taken
+*/
+bool telegram_fsm_dispatch(void *fsm, void *teleCtx, telegram_update_t *upd);
+
+telegram_fsm_state_t telegram_fsm_get_state(void *fsm, telegram_int_t chat_id);
+void telegram_fsm_set_state(void *fsm, telegram_int_t chat_id, telegram_fsm_state_t state);
+
+/**
+* @brief Free the machine, stored states are saved
+*/
+void telegram_fsm_free(void *fsm);
+
+#endif /* TELEGRAM_FSM_H */
@@ -0,0 +1,22 @@
+#ifndef TELEGRAM_HASH_H
+#define TELEGRAM_HASH_H
+#include <stdint.h>
+
+/** Initial value of FNV-1a hash */
+#define TELEGRAM_HASH_INIT (2166136261U)
+
+/**
+* @brief Continue 32 bit FNV-1a hash with len bytes of data
+*
+* @param hash TELEGRAM_HASH_INIT or the result of the previous call
+* @param data bytes to hash
+* @param len number of bytes
+*
+* @return hash of all data
+*/
+uint32_t telegram_hash(uint32_t hash, const void *data, uint32_t len);
+
+/** Same as telegram_hash for the zero terminated string, NULL is hashed as empty string */
+uint32_t telegram_hash_str(uint32_t hash, const char *str);
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef TELEGRAM_IMG_H
+#define TELEGRAM_IMG_H
+#include <stdint.h>
+#include <stdbool.h>
+#include "telegram_parse.h"
+
+/** Photo downscale/recompress before upload, requires esp32-camera component (img_converters) */
+#define TELEGRAM_IMG_TRANSFORM (0)
+
+/** Defaults of telegram_img_cfg_t */
+#define TELEGRAM_IMG_QUALITY (60U)
+#define TELEGRAM_IMG_WORK_BUDGET (320U * 1024U)
+#define TELEGRAM_IMG_OUT_BUDGET (96U * 1024U)
+/** How many times quality is lowered if the result does not fit into the output budget */
+#define TELEGRAM_IMG_ENCODE_ATTEMPTS (3U)
+
+#if TELEGRAM_IMG_TRANSFORM == 1
+#include <img_converters.h>
+
+typedef struct
+{
+	uint8_t quality;      /** JPEG quality 1-100, 0 - TELEGRAM_IMG_QUALITY */
+	uint16_t max_width;   /** JPEG is decoded with 1/2, 1/4 or 1/8 scale until the width fits, 0 - keep size */
+	uint32_t work_budget; /** Max size of the decoded RGB565 frame, 0 - TELEGRAM_IMG_WORK_BUDGET */
+	uint32_t out_budget;  /** Max size of the produced JPEG, 0 - TELEGRAM_IMG_OUT_BUDGET */
+} telegram_img_cfg_t;
+
+/**
+* @brief Downscale and requantize JPEG, then upload it as photo.
+* The scale is chosen so the decoded frame fits into work_budget and the width into max_width.
+* If the image can not be transformed within the budgets the original JPEG is uploaded.
+*
+* @param cfg optional, NULL - defaults
+*
+* @return true if the photo was sent
+*/
+bool telegram_send_photo_jpeg(void *teleCtx_ptr, telegram_int_t chat_id, const char *caption, const char *filename,
+	const uint8_t *jpg, uint32_t len, const telegram_img_cfg_t *cfg);
+
+/**
+* @brief Encode raw camera frame (RGB565, RGB888, YUV422 or grayscale) to JPEG and upload it as photo
+*
+* @param cfg optional, NULL - defaults, max_width and work_budget are not used
+*
+* @return true if the photo was sent
+*/
+bool telegram_send_photo_raw(void *teleCtx_ptr, telegram_int_t chat_id, const char *caption, const char *filename,
+	const uint8_t *frame, uint32_t len, uint16_t width, uint16_t height, pixformat_t format, const telegram_img_cfg_t *cfg);
+#endif
+
+#endif /* TELEGRAM_IMG_H */
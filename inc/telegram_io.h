@@ -1,31 +1,105 @@
 #ifndef TELEGRAM_IO_H
 #define TELEGRAM_IO_H
+#include <stdint.h>
+#include <stdbool.h>
 
 #define TELEGRAM_LONG_POLLING (1)
 #define TELGRAM_DBG 0
 
 #define TELEGRAM_MAX_BUFFER 8192U
 
+/** How many times a dropped download is resumed with a Range request before giving up */
+#define TELEGRAM_IO_RESUME_ATTEMPTS 5U
+/** Delay before the first resume attempt, doubled for every next one */
+#define TELEGRAM_IO_RESUME_DELAY_MS (500U)
+#define TELEGRAM_IO_RANGE_HDR_LEN (32U)
+
+/** Connection of io context idle longer than this is reopened instead of reused */
+#define TELEGRAM_IO_KEEP_ALIVE_IDLE_MS (20000U)
+
 typedef struct
 {
 	const char *key;
 	const char *value;
 } telegram_io_header_t;
 
+/** Per request details filled by the io layer, all times are in microseconds */
+typedef struct
+{
+	uint32_t req_id;       /** In: request id for trace events, see telegram_trace.h */
+	int status;            /** HTTP status code, 0 if no response was received */
+	int err;               /** esp_err_t of the failed step or 0 */
+	uint32_t bytes_out;    /** Request body bytes written */
+	uint32_t bytes_in;     /** Response body bytes read */
+	int64_t connect_us;    /** Time spent in DNS lookup, TCP connect and TLS handshake */
+	int64_t first_byte_us; /** Time from the start of the request to the response headers */
+	int64_t total_us;      /** Whole request time */
+	bool reused;           /** Request was sent over the kept-alive connection of the io context */
+	bool body_sent;        /** Whole request was written, the server may have processed it */
+} telegram_io_info_t;
+
+/** Failure class of the request, see telegram_io_classify */
+typedef enum
+{
+	TELEGRAM_IO_OK,
+	TELEGRAM_IO_FAIL_CONNECT, /** DNS, TCP or TLS setup failed, nothing was sent */
+	TELEGRAM_IO_FAIL_SEND,    /** Connection dropped while writing the request, it was not complete */
+	TELEGRAM_IO_FAIL_TIMEOUT, /** No response after the whole request was written */
+	TELEGRAM_IO_FAIL_SERVER,  /** 5xx status */
+	TELEGRAM_IO_FAIL_FLOOD,   /** 429 status, see retry_after in the response */
+	TELEGRAM_IO_FAIL_CLIENT,  /** Other not 2xx status, retry will not help */
+	TELEGRAM_IO_FAIL_OTHER,   /** Local failure, e.g. no memory */
+} telegram_io_fail_t;
+
 typedef uint32_t(*telegram_io_send_file_cb_t)(void *ctx, uint8_t *buf, uint32_t max_size, uint32_t offset);
 
+/** Region of the request body: memory written to the transport as is, or data pulled by cb into the io buffer */
+typedef struct
+{
+	const uint8_t *data;           /** Memory of the part, NULL - use cb */
+	uint32_t len;                  /** Size of the part */
+	telegram_io_send_file_cb_t cb; /** Producer of the part if data is NULL, offset is relative to the part */
+	void *ctx;                     /** Argument of cb */
+} telegram_io_part_t;
+
 /**
  headers should be end with null key
+ info is optional, it receives status and timings of the request
 */
 
-char *telegram_io_get(const char *path, telegram_io_header_t *headers);
-char *telegram_io_get_ctx(void **io_ctx, const char *path, telegram_io_header_t *headers);
+char *telegram_io_get(const char *path, telegram_io_header_t *headers, telegram_io_info_t *info);
+char *telegram_io_get_ctx(void **io_ctx, const char *path, telegram_io_header_t *headers, telegram_io_info_t *info);
 void telegram_io_free_ctx(void **io_ctx);
-void telegram_io_send(const char *path, const char *message, telegram_io_header_t *headers);
+/** Returns response body or NULL, memory should be freed with telegram_free */
+char *telegram_io_send(const char *path, const char *message, telegram_io_header_t *headers, telegram_io_info_t *info);
+
+/** Same as telegram_io_send but reuses client and connection of the io context */
+char *telegram_io_send_ctx(void **io_ctx, const char *path, const char *message, telegram_io_header_t *headers, 
+    telegram_io_info_t *info);
+
+telegram_io_fail_t telegram_io_classify(const telegram_io_info_t *info);
 
 char *telegram_io_send_big(const char *path, uint32_t total_len, telegram_io_header_t *headers, 
-    const char *post_field, void *ctx, telegram_io_send_file_cb_t cb);
+    const char *post_field, void *ctx, telegram_io_send_file_cb_t cb, telegram_io_info_t *info);
+
+/**
+ Sends POST request with body made of parts, io_ctx is optional.
+ Memory parts are not copied, only parts with producer callback use TELEGRAM_MAX_BUFFER bounce buffer.
+*/
+char *telegram_io_send_parts(void **io_ctx, const char *path, telegram_io_header_t *headers, 
+    const telegram_io_part_t *parts, uint32_t count, telegram_io_info_t *info);
 
-typedef bool(*telegram_io_get_file_cb_t)(void *ctx, uint8_t *buf, int size, int total_len);
-void telegram_io_read_file(const char *file_path, void *ctx, telegram_io_get_file_cb_t cb);
+/**
+ size < 0 means the transfer failed, offset is the position of the first not acknowledged byte then.
+ total_len is 0 if the server did not report the length (chunked response).
+ Returning false from the callback aborts the transfer.
+*/
+typedef bool(*telegram_io_get_file_cb_t)(void *ctx, uint8_t *buf, int size, uint32_t offset, int total_len);
+
+/**
+ Downloads file starting from offset, dropped connections are resumed with HTTP Range requests
+ from the last acknowledged offset. Returns true if the whole file was received.
+*/
+bool telegram_io_read_file(const char *file_path, uint32_t offset, void *ctx, telegram_io_get_file_cb_t cb,
+    telegram_io_info_t *info);
 #endif /* TELEGRAM_IO_H */
\ No newline at end of file
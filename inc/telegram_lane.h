@@ -0,0 +1,31 @@
+#ifndef TELEGRAM_LANE_H
+#define TELEGRAM_LANE_H
+#include <stdint.h>
+#include <stdbool.h>
+#include "telegram_parse.h"
+
+/**
+* Set to 1 to send requests of each priority class over their own connection and lock, separate from the
+* getUpdates poll, so bulk transfers never delay interactive replies. A lane connects on its first request
+* and keeps its TLS session afterwards, up to three more sessions per bot or multiplexer: enable only with
+* enough heap (e.g. PSRAM). 0 - everything is sent over the poll connection, requests waiting for it are served
+* by class: interactive first, then normal (getUpdates included), then bulk. A transfer in progress is not
+* interrupted, the next request waits for its end.
+*/
+#define TELEGRAM_LANES_ENABLE (0)
+
+/** Priority class of outbound requests */
+typedef enum
+{
+	TELEGRAM_LANE_INTERACTIVE, /** Answers to the user actions: callback answers, edits */
+	TELEGRAM_LANE_NORMAL,      /** Messages and small requests */
+	TELEGRAM_LANE_BULK,        /** Uploads, downloads, broadcasts */
+	TELEGRAM_LANE_COUNT
+} telegram_lane_t;
+
+/**
+* @brief Default priority class of the method
+*/
+telegram_lane_t telegram_lane_default(telegram_method_t method);
+
+#endif /* TELEGRAM_LANE_H */
@@ -0,0 +1,52 @@
+#ifndef TELEGRAM_LIVE_H
+#define TELEGRAM_LIVE_H
+#include <stdint.h>
+#include <stdbool.h>
+#include "telegram_parse.h"
+
+/** Default min interval between edits, Telegram limits bots to about one message per second per chat */
+#define TELEGRAM_LIVE_MIN_INTERVAL_MS (1000U)
+
+typedef enum
+{
+	TELEGRAM_LIVE_SENT,      /** Message was sent or edited */
+	TELEGRAM_LIVE_UNCHANGED, /** Text and keyboard are the same as shown, nothing was sent */
+	TELEGRAM_LIVE_THROTTLED, /** Too early after the previous edit, the edit is sent when the interval expires */
+	TELEGRAM_LIVE_FAILED,    /** Request failed */
+} telegram_live_res_t;
+
+/**
+* @brief Create live message: status message that is sent once and edited in place on updates
+*
+* @param teleCtx_ptr bot handle
+* @param chat_id chat to send the message to
+* @param min_interval_ms min interval between edits, 0 - TELEGRAM_LIVE_MIN_INTERVAL_MS
+*
+* @return NULL or live message handle
+*/
+void *telegram_live_init(void *teleCtx_ptr, telegram_int_t chat_id, uint32_t min_interval_ms);
+
+/**
+* @brief Show new text and keyboard, first update sends the message, next ones edit it.
+* Edit is skipped if text and keyboard are unchanged, only keyboard is edited if only it was changed.
+* Edits made too early are kept, only the latest one, and queued to the async sender when the interval
+* expires, so the last state of a burst is always shown. This requires telegram_start_async, without it
+* the throttled state is dropped and has to be submitted again.
+*
+* @param live live message handle
+* @param text text of the message
+* @param kbrd optional keyboard, only inline keyboard can be edited
+*
+* @return see telegram_live_res_t
+*/
+telegram_live_res_t telegram_live_update(void *live, const char *text, telegram_kbrd_t *kbrd);
+
+/** message_id of the live message or -1 if it was not sent yet */
+telegram_int_t telegram_live_get_message_id(void *live);
+
+/** Forget the message, the next update sends new one */
+void telegram_live_reset(void *live);
+
+void telegram_live_free(void *live);
+
+#endif /* TELEGRAM_LIVE_H */
@@ -0,0 +1,103 @@
+#ifndef TELEGRAM_MEM_H
+#define TELEGRAM_MEM_H
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/** Set to 0 to map the allocator hooks directly on malloc/free without accounting */
+#define TELEGRAM_MEM_ACCOUNTING (1)
+
+/**
+* Route cJSON allocations through the hooks as well, off by default: cJSON hooks are global for the application.
+* Enable only if nothing uses cJSON before telegram_init. Blocks have no header, so with the default allocator
+* trees of other cJSON users stay valid for free(). Without it TELEGRAM_MEM_JSON stays 0: parsed updates are
+* cJSON trees and likely the largest consumer, enable it while looking for the source of OOM.
+*/
+#define TELEGRAM_MEM_HOOK_CJSON (0)
+
+/** Subsystem an allocation belongs to */
+typedef enum
+{
+	TELEGRAM_MEM_CORE,  /** Contexts, tasks, caches */
+	TELEGRAM_MEM_PARSE, /** Parsed updates, telegram_parse_* nodes */
+	TELEGRAM_MEM_MAKE,  /** Generated request payloads, telegram_make_* */
+	TELEGRAM_MEM_IO,    /** Transfer buffers and responses */
+	TELEGRAM_MEM_JSON,  /** cJSON trees, only with TELEGRAM_MEM_HOOK_CJSON */
+	TELEGRAM_MEM_TAG_COUNT
+} telegram_mem_tag_t;
+
+/**
+* Allocations of one subsystem. Blocks carry no tag, the subsystem is known from telegram_free_tag,
+* so memory returned by the API and released with telegram_free stays in current of its tag.
+*/
+typedef struct
+{
+	uint32_t allocated; /** Bytes requested since boot */
+	uint32_t count;     /** Number of allocations since boot */
+	uint32_t failed;    /** Number of failed allocations */
+	uint32_t current;   /** Bytes allocated now, 0 if the allocator has no size function */
+	uint32_t peak;      /** High-water mark of current */
+	uint32_t live;      /** Number of live allocations */
+} telegram_mem_stats_t;
+
+/** Live memory of the whole library */
+typedef struct
+{
+	uint32_t current; /** Bytes allocated now, 0 if the allocator has no size function */
+	uint32_t peak;    /** High-water mark of current */
+	uint32_t count;   /** Number of live allocations */
+} telegram_mem_usage_t;
+
+typedef void *(*telegram_malloc_fn_t)(size_t size);
+typedef void (*telegram_free_fn_t)(void *ptr);
+/** Usable size of the allocated block */
+typedef size_t (*telegram_size_fn_t)(void *ptr);
+
+/**
+* @brief Replace underlying allocator once, before the first allocation of the library
+*
+* @param malloc_fn allocation function, NULL - malloc
+* @param free_fn free function, NULL - free
+* @param size_fn optional block size function for live usage accounting
+*
+* @return false if the allocator was already set or memory was already allocated
+*/
+bool telegram_mem_set_hooks(telegram_malloc_fn_t malloc_fn, telegram_free_fn_t free_fn, telegram_size_fn_t size_fn);
+
+/**
+* @brief Install cJSON hooks if TELEGRAM_MEM_HOOK_CJSON is enabled, called by telegram_init
+*/
+void telegram_mem_init(void);
+
+void *telegram_malloc(telegram_mem_tag_t tag, size_t size);
+void *telegram_calloc(telegram_mem_tag_t tag, size_t num, size_t size);
+char *telegram_strdup(telegram_mem_tag_t tag, const char *str);
+
+/**
+* @brief Free memory allocated by the library, including memory returned by the API.
+* With the default allocator memory returned by the API may be released with free() as well.
+* Only the totals of the library are updated, see telegram_free_tag.
+*/
+void telegram_free(void *ptr);
+
+/**
+* @brief Free memory allocated with the tag, releases it in the accounting of the subsystem as well
+*
+* @param tag tag of the allocation
+* @param ptr memory to free, may be NULL
+*/
+void telegram_free_tag(telegram_mem_tag_t tag, void *ptr);
+
+/**
+* @brief Get accounting of the subsystem
+*
+* @param tag subsystem
+* @param stats where to store the values
+*
+* @return none
+*/
+void telegram_mem_get_stats(telegram_mem_tag_t tag, telegram_mem_stats_t *stats);
+
+void telegram_mem_get_usage(telegram_mem_usage_t *usage);
+
+#endif /* TELEGRAM_MEM_H */
@@ -3,7 +3,9 @@
 */
 #ifndef TELEGRAM_PARSE
 #define TELEGRAM_PARSE
+#include <stdint.h>
 #include <stdbool.h>
+#include "telegram_schema.h"
 
 #define TELEGRAM_SERVER 		"https://api.telegram.org"
 
@@ -25,20 +27,15 @@ typedef enum
 	TELEGRAM_SEND_FILE,
 	TELEGRAM_SEND_PHOTO,
 	TELEGRAM_ANSWER_QUERY,
+	TELEGRAM_SET_WEBHOOK,
+	TELEGRAM_DELETE_WEBHOOK,
+	TELEGRAM_EDIT_MESSAGE_TEXT,
+	TELEGRAM_EDIT_MESSAGE_MARKUP,
+	TELEGRAM_SEND_MEDIA_GROUP,
+	TELEGRAM_METHOD_COUNT
 } telegram_method_t;
 
-struct telegram_chat_message;
-
-/** This object represents a Telegram user or bot */
-typedef struct
-{
-	telegram_int_t id;             /** Unique identifier for this user or bot */
-	bool is_bot;                   /** True, if this user is a bot */    
-	const char *first_name;        /** User‘s or bot’s first name */
-	const char *last_name;         /** Opt. User‘s or bot’s last name */
-	const char *username;          /** Opt. User‘s or bot’s username */
-	const char *language_code;     /** Opt. IETF language tag of the user's language */
-} telegram_user_t;
+typedef struct telegram_chat_message telegram_chat_message_t;
 
 /** Type of the chat possible values */
 typedef enum
@@ -51,75 +48,70 @@ typedef enum
 	TELEGRAM_CHAT_TYPE_COUNT
 } telegram_chat_type_t;
 
+/** This object represents a Telegram user or bot */
+typedef struct
+{
+	TELEGRAM_SCHEMA_BODY(TELEGRAM_SCHEMA_USER, telegram_user_t)
+} telegram_user_t;
+
 /** This object represents a chat. */
 typedef struct
 {
-	telegram_int_t id; /** 	Unique identifier for this chat. */
-	const char *title; /**  Opt. Title of the chat  */ 
-	telegram_chat_type_t type; /** Type of the chat */
-	struct telegram_chat_message  *pinned_message; /** Opt. Pinned message, for supergroups and channel chats */
+	TELEGRAM_SCHEMA_BODY(TELEGRAM_SCHEMA_CHAT, telegram_chat_t)
 } telegram_chat_t;
 
 /** This object represents one size of a photo or a file / sticker thumbnail. */
 typedef struct
 {
-	const char *id; /** Unique file identifier */
-	telegram_int_t width; /** Photo width */
-	telegram_int_t height; /** Photo height */
-	telegram_int_t file_size; /** Opt. file size */
+	TELEGRAM_SCHEMA_BODY(TELEGRAM_SCHEMA_PHOTOSIZE, telegram_photosize_t)
 } telegram_photosize_t;
 
 /** This object represents a general file */
 typedef struct
 {
-	const char *id; /** Unique file identifier */
-	telegram_photosize_t *thumb; /** Opt.  Document thumbnail as defined by sender */
-	const char *name; /** Opt. Original filename as defined by sender */
-	const char *mime_type; /** Opt. MIME type of the file as defined by sender */
-	telegram_int_t file_size; /** Opt. File size */
+	TELEGRAM_SCHEMA_BODY(TELEGRAM_SCHEMA_DOCUMENT, telegram_document_t)
 } telegram_document_t; 
 
+/** This object represents a point on the map */
+typedef struct
+{
+	TELEGRAM_SCHEMA_BODY(TELEGRAM_SCHEMA_LOCATION, telegram_location_t)
+} telegram_location_t;
+
+/** This object represents a phone contact */
+typedef struct
+{
+	TELEGRAM_SCHEMA_BODY(TELEGRAM_SCHEMA_CONTACT, telegram_contact_t)
+} telegram_contact_t;
+
 /** This object represents a message. */
-typedef struct telegram_chat_message
+struct telegram_chat_message
 {
-	telegram_int_t   id;        /** Unique message identifier inside this chat */
-	telegram_user_t  *from;     /** NULL in case of channel posts */
-	telegram_int_t   timestamp; /** Unix timestamp of the message */
-	telegram_chat_t  *chat;     /** Conversation the message belongs to */
-	telegram_user_t  *forward_from; /** Opt. For forwarded messages, sender of the original message */
-	telegram_chat_t  *forward_from_chat; /** Opt. For forwarded messages, chat of the original message */
-	telegram_int_t   forward_from_message_id; /** Opt. For messages forwarded from channels, identifier of the original message in the channel */
-	const char       *forward_signature; /** Opt. For messages forwarded from channels, signature of the post author if present*/
-	telegram_int_t   forward_date; /** Opt. For forwarded messages, date the original message was sent in Unix time*/
-	struct telegram_chat_message *reply_to_message; /** Opt. For replies, the original message. Note that the Message object in this field will not contain further reply_to_message fields even if it itself is a reply.*/
-	telegram_int_t   edit_date; /** Opt.  Date the message was last edited in Unix time */
-	const char       *media_group_id; /** Opt. The unique identifier of a media message group this message belongs to */
-	const char       *author_signature; /** Opt. Signature of the post author for messages in channels */
-	const char       *text;     /** Opt. Text of the message */
-	const char       *caption;  /** Optional. Caption for the animation, audio, document, photo, video or voice, 0-1024 characters */
-	telegram_document_t *file; /** Opt. General file */
-} telegram_chat_message_t;
+	TELEGRAM_SCHEMA_BODY(TELEGRAM_SCHEMA_MESSAGE, telegram_chat_message_t)
+};
 
 /** This object represents an incoming callback query from a callback button in an inline keyboard. */
 typedef struct
 {
-	const char                   *id;         /** Unique identifier for this query */
-	telegram_user_t              *from;       /** Sender */
-	const char      			 *data;       /** Opt. Data associated with the callback button. */
-	telegram_chat_message_t      *message;    /** Opt. Message that was send to user */
+	TELEGRAM_SCHEMA_BODY(TELEGRAM_SCHEMA_CALLBACK, telegram_chat_callback_t)
 } telegram_chat_callback_t;
 
 /** This object represents an incoming update. */
 typedef struct
 {
-	telegram_int_t               id;                   /** The update‘s unique identifier. */
-	telegram_chat_message_t      *message;             /** Opt. New incoming message */
-	telegram_chat_message_t      *edited_message;      /** Opt. New version of a message that is known to the bot and was edited */
-	telegram_chat_message_t      *channel_post;        /** Opt. Message that was send to user */
-	telegram_chat_message_t		 *edited_channel_post; /** Opt. New version of a channel post that is known to the bot and was edited */
-	telegram_chat_callback_t     *callback_query;      /** New incoming callback query */
+	TELEGRAM_SCHEMA_BODY(TELEGRAM_SCHEMA_UPDATE, telegram_update_t)
 } telegram_update_t;
 
+TELEGRAM_SCHEMA_BITS(TELEGRAM_SCHEMA_USER, telegram_user_t)
+TELEGRAM_SCHEMA_BITS(TELEGRAM_SCHEMA_CHAT, telegram_chat_t)
+TELEGRAM_SCHEMA_BITS(TELEGRAM_SCHEMA_PHOTOSIZE, telegram_photosize_t)
+TELEGRAM_SCHEMA_BITS(TELEGRAM_SCHEMA_DOCUMENT, telegram_document_t)
+TELEGRAM_SCHEMA_BITS(TELEGRAM_SCHEMA_LOCATION, telegram_location_t)
+TELEGRAM_SCHEMA_BITS(TELEGRAM_SCHEMA_CONTACT, telegram_contact_t)
+TELEGRAM_SCHEMA_BITS(TELEGRAM_SCHEMA_MESSAGE, telegram_chat_message_t)
+TELEGRAM_SCHEMA_BITS(TELEGRAM_SCHEMA_CALLBACK, telegram_chat_callback_t)
+TELEGRAM_SCHEMA_BITS(TELEGRAM_SCHEMA_UPDATE, telegram_update_t)
+
 /** Callback on single message parser */
 typedef void(*telegram_on_msg_cb_t)(void *teleCtx, telegram_update_t *info);
 
@@ -205,9 +197,20 @@ typedef struct
 */
 void telegram_parse_messages(void *teleCtx, const char *buffer, telegram_on_msg_cb_t cb);
 
+/**
+* @brief Parse single update object, as it is pushed to a webhook
+* All allocated memory will be freed internaly
+* @param teleCtx pointer on internal telegram structure, used as argument in callback
+* @param buffer string with JSON update object
+* @param cb callback to call on the update
+*
+* @return none
+*/
+void telegram_parse_update_object(void *teleCtx, const char *buffer, telegram_on_msg_cb_t cb);
+
 /**
 * @brief Parse telegram_kbrd_t into JSON object
-* Memory should be free with free function
+* Memory should be freed with telegram_free function
 *
 * @param kbrd pointer on C structure that is described keyboard
 *
@@ -227,7 +230,7 @@ telegram_chat_message_t *telegram_get_message(telegram_update_t *src);
 
 /**
 * @brief Parse getFile answer and return file_path
-* Memory should be freed
+* Memory should be freed with telegram_free function
 *
 * @param buffer where search for a file_path
 *
@@ -235,6 +238,24 @@ telegram_chat_message_t *telegram_get_message(telegram_update_t *src);
 */
 char *telegram_parse_file_path(const char *buffer);
 
+/**
+* @brief Parse sendMessage or editMessageText answer and return message_id of the sent message
+*
+* @param buffer where search for a message_id
+*
+* @return message_id or -1 - no id found
+*/
+telegram_int_t telegram_parse_message_id(const char *buffer);
+
+/**
+* @brief Parse parameters.retry_after of the failed request answer (429 Too Many Requests)
+*
+* @param buffer where search for a retry_after
+*
+* @return seconds to wait or 0 - not found
+*/
+uint32_t telegram_parse_retry_after(const char *buffer);
+
 /**
 * @brief Get chat id or user id from the telegram_chat_message_t structure
 *
@@ -274,6 +295,19 @@ telegram_int_t telegram_get_user_id_update(telegram_update_t *src);
 */
 char *telegram_make_message(telegram_int_t chat_id, const char *message, telegram_kbrd_t *kbrd);
 
+/**
+* @brief Generate editMessageText or editMessageReplyMarkup parameters
+*
+* @param chat_id id of chat
+* @param message_id id of the message to edit
+* @param message new text of the message, NULL - edit reply markup only
+* @param kbrd optional keyboard object, only inline keyboard can be used
+*
+* @return NULL or parameters
+*/
+char *telegram_make_edit_message(telegram_int_t chat_id, telegram_int_t message_id, const char *message, 
+	telegram_kbrd_t *kbrd);
+
 /**
 * @brief Generate answer query
 *
@@ -288,6 +322,28 @@ char *telegram_make_message(telegram_int_t chat_id, const char *message, telegra
 char *telegram_make_answer_query(const char *cid, const char *text, bool show_alert, const char *url, 
 	telegram_int_t cache_time);
 
+/**
+* @brief Generate webhook response body that calls the method inline
+* Memory should be freed with telegram_free function
+*
+* @param method method to call, only methods with JSON parameters are supported
+* @param payload JSON object with parameters of the method, e.g. result of telegram_make_message
+*
+* @return NULL or response body
+*/
+char *telegram_make_inline_reply(telegram_method_t method, const char *payload);
+
+/**
+* @brief Generate setWebhook parameters
+*
+* @param url https url to send updates to
+* @param max_connections optional max number of simultaneous connections, 0 - default
+* @param secret_token optional secret to be sent in X-Telegram-Bot-Api-Secret-Token header
+*
+* @return NULL or parameters
+*/
+char *telegram_make_webhook(const char *url, uint32_t max_connections, const char *secret_token);
+
 /**
 * @brief Generates https REST API method path
 *
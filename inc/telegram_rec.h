@@ -0,0 +1,144 @@
+/**
+* Compact update record: flat copy of the telegram_update_t without pointers.
+* Numbers are stored in narrow types, strings are stored in one buffer at the end of the record
+* and referenced by offsets, so the record can be copied or queued with one memcpy of telegram_rec_size bytes.
+*/
+#ifndef TELEGRAM_REC_H
+#define TELEGRAM_REC_H
+#include <stdint.h>
+#include <stdbool.h>
+#include "telegram_parse.h"
+
+/** Max size of the record with strings, offsets are 16 bit */
+#define TELEGRAM_REC_MAX_SIZE (UINT16_MAX)
+
+/** String slots of the record: X(slot name) */
+#define TELEGRAM_REC_STRINGS(X) \
+	X(TEXT)           /** Text of the message */ \
+	X(CAPTION)        /** Caption of the media */ \
+	X(FROM_NAME)      /** First name of the sender */ \
+	X(FROM_USERNAME)  /** Username of the sender */ \
+	X(FROM_LANG)      /** Language code of the sender */ \
+	X(CHAT_TITLE)     /** Title of the chat */ \
+	X(CHAT_USERNAME)  /** Username of the chat */ \
+	X(FILE_ID)        /** Document file_id or file_id of the largest photo */ \
+	X(FILE_NAME)      /** Document file name */ \
+	X(MIME_TYPE)      /** Document MIME type */ \
+	X(MEDIA_GROUP_ID) /** Media group of the message */ \
+	X(CB_ID)          /** Callback query identifier */ \
+	X(CB_DATA)        /** Callback query data */
+
+#define TELEGRAM_REC_STR_ENUM(name) TELEGRAM_REC_STR_##name,
+typedef enum
+{
+	TELEGRAM_REC_STRINGS(TELEGRAM_REC_STR_ENUM)
+	TELEGRAM_REC_STR_COUNT
+} telegram_rec_str_t;
+#undef TELEGRAM_REC_STR_ENUM
+
+/** Which field of the update the record was made from */
+typedef enum
+{
+	TELEGRAM_REC_KIND_NONE,
+	TELEGRAM_REC_KIND_MESSAGE,
+	TELEGRAM_REC_KIND_EDITED_MESSAGE,
+	TELEGRAM_REC_KIND_CHANNEL_POST,
+	TELEGRAM_REC_KIND_EDITED_CHANNEL_POST,
+	TELEGRAM_REC_KIND_CALLBACK_QUERY,
+	TELEGRAM_REC_KIND_COUNT
+} telegram_rec_kind_t;
+
+/** Presence bits of the numeric fields */
+#define TELEGRAM_REC_HAS_MESSAGE  (1U << 0) /** message_id, date, chat fields */
+#define TELEGRAM_REC_HAS_FROM     (1U << 1) /** from_id, is_bot */
+#define TELEGRAM_REC_HAS_REPLY    (1U << 2) /** reply_to_message_id */
+#define TELEGRAM_REC_HAS_FORWARD  (1U << 3) /** forward_from_id */
+#define TELEGRAM_REC_HAS_EDIT     (1U << 4) /** edit_date */
+#define TELEGRAM_REC_HAS_FILE     (1U << 5) /** Document, file_size */
+#define TELEGRAM_REC_HAS_PHOTO    (1U << 6) /** Photo, file_size of the largest size */
+#define TELEGRAM_REC_HAS_LOCATION (1U << 7) /** latitude, longitude */
+#define TELEGRAM_REC_IS_BOT       (1U << 8) /** Sender is a bot */
+
+/** Layout is internal, use accessors. Record must be 8 byte aligned */
+typedef struct
+{
+	int64_t chat_id;
+	int64_t from_id;
+	int64_t forward_from_id;
+	uint32_t update_id;
+	uint32_t message_id;
+	uint32_t date;
+	uint32_t edit_date;
+	uint32_t reply_to_message_id;
+	uint32_t file_size;
+	float latitude;
+	float longitude;
+	uint16_t size;                         /** Size of the record with strings */
+	uint16_t flags;                        /** TELEGRAM_REC_HAS_* */
+	uint16_t str[TELEGRAM_REC_STR_COUNT];  /** Offsets in strs, 0 - absent */
+	uint8_t kind;                          /** telegram_rec_kind_t */
+	uint8_t chat_type;                     /** telegram_chat_type_t */
+	char strs[];                           /** strs[0] is reserved */
+} telegram_rec_t;
+
+/**
+* @brief Get size of the record for the update
+*
+* @return size in bytes or 0 if the update does not fit TELEGRAM_REC_MAX_SIZE
+*/
+uint32_t telegram_rec_size_for(const telegram_update_t *upd);
+
+/**
+* @brief Flatten update to the caller buffer
+*
+* @param upd parsed update
+* @param buf 8 byte aligned buffer
+* @param buf_size size of the buffer
+*
+* @return size of the record or 0 if the buffer is too small
+*/
+uint32_t telegram_rec_pack(const telegram_update_t *upd, void *buf, uint32_t buf_size);
+
+/**
+* @brief Flatten update to the allocated record, free with telegram_free
+*/
+telegram_rec_t *telegram_rec_from_update(const telegram_update_t *upd);
+
+/**
+* @brief Copy record to the allocated buffer, free with telegram_free
+*/
+telegram_rec_t *telegram_rec_copy(const telegram_rec_t *rec);
+
+/**
+* @brief Validate record from untrusted storage: size and string offsets
+*
+* @param buf record data
+* @param len number of bytes available
+*
+* @return true if the record can be read with accessors
+*/
+bool telegram_rec_check(const void *buf, uint32_t len);
+
+/** Size of the record in bytes, amount to copy */
+uint32_t telegram_rec_size(const telegram_rec_t *rec);
+
+/** String of the slot or NULL if absent */
+const char *telegram_rec_get_str(const telegram_rec_t *rec, telegram_rec_str_t slot);
+
+/** Check TELEGRAM_REC_HAS_* bits, true only if all bits are set */
+bool telegram_rec_has(const telegram_rec_t *rec, uint16_t flags);
+
+telegram_rec_kind_t telegram_rec_get_kind(const telegram_rec_t *rec);
+uint32_t telegram_rec_get_update_id(const telegram_rec_t *rec);
+uint32_t telegram_rec_get_message_id(const telegram_rec_t *rec);
+uint32_t telegram_rec_get_date(const telegram_rec_t *rec);
+uint32_t telegram_rec_get_edit_date(const telegram_rec_t *rec);
+uint32_t telegram_rec_get_reply_to(const telegram_rec_t *rec);
+uint32_t telegram_rec_get_file_size(const telegram_rec_t *rec);
+int64_t telegram_rec_get_chat_id(const telegram_rec_t *rec);
+telegram_chat_type_t telegram_rec_get_chat_type(const telegram_rec_t *rec);
+int64_t telegram_rec_get_from_id(const telegram_rec_t *rec);
+int64_t telegram_rec_get_forward_from_id(const telegram_rec_t *rec);
+bool telegram_rec_get_location(const telegram_rec_t *rec, float *latitude, float *longitude);
+
+#endif /* TELEGRAM_REC_H */
@@ -0,0 +1,54 @@
+/**
+* Classifier of the Bot API answers. Only top-level fields and "parameters" are scanned in place,
+* no cJSON tree is built and "result" is not parsed, successful answers stop at "ok".
+*/
+#ifndef TELEGRAM_RESPONSE_H
+#define TELEGRAM_RESPONSE_H
+#include <stdint.h>
+#include <stdbool.h>
+#include "telegram_parse.h"
+
+/** Size of the description buffer, longer descriptions are truncated */
+#define TELEGRAM_RESPONSE_DESC_LEN (64U)
+
+/** Error class of the answer, see telegram_response_classify */
+typedef enum
+{
+	TELEGRAM_RESPONSE_OK,
+	TELEGRAM_RESPONSE_INVALID,        /** No answer or not a Bot API answer */
+	TELEGRAM_RESPONSE_FLOOD,          /** 429, wait retry_after */
+	TELEGRAM_RESPONSE_MIGRATED,       /** Group became supergroup, use migrate_to_chat_id */
+	TELEGRAM_RESPONSE_FORBIDDEN,      /** 403, bot was blocked by the user or kicked from the chat */
+	TELEGRAM_RESPONSE_CHAT_NOT_FOUND, /** 400, chat does not exist or was deleted */
+	TELEGRAM_RESPONSE_BAD_REQUEST,    /** Other 400 */
+	TELEGRAM_RESPONSE_UNAUTHORIZED,   /** 401, bad token */
+	TELEGRAM_RESPONSE_SERVER,         /** 5xx */
+	TELEGRAM_RESPONSE_OTHER,
+} telegram_response_class_t;
+
+/** Decoded answer status */
+typedef struct
+{
+	bool ok;
+	int32_t error_code;                          /** 0 if not present */
+	uint32_t retry_after;                        /** parameters.retry_after, seconds or 0 */
+	telegram_int_t migrate_to_chat_id;           /** parameters.migrate_to_chat_id or 0 */
+	char description[TELEGRAM_RESPONSE_DESC_LEN];
+} telegram_response_t;
+
+/**
+* @brief Decode status fields of the answer, nothing is allocated
+*
+* @param buffer answer body, may be NULL
+* @param resp where to store the fields, zeroed first
+*
+* @return false if the buffer is not a JSON object
+*/
+bool telegram_response_parse(const char *buffer, telegram_response_t *resp);
+
+/**
+* @brief Get error class of the decoded answer
+*/
+telegram_response_class_t telegram_response_classify(const telegram_response_t *resp);
+
+#endif /* TELEGRAM_RESPONSE_H */
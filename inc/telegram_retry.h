@@ -0,0 +1,37 @@
+#ifndef TELEGRAM_RETRY_H
+#define TELEGRAM_RETRY_H
+#include <stdint.h>
+#include <stdbool.h>
+#include "telegram_parse.h"
+#include "telegram_io.h"
+
+/** Attempts of one request including the first one, 1 disables retries */
+#define TELEGRAM_RETRY_ATTEMPTS (4U)
+/** Backoff before the second attempt, doubled for every next one */
+#define TELEGRAM_RETRY_BASE_MS (500U)
+/** Backoff cap, 429 with longer retry_after is not retried */
+#define TELEGRAM_RETRY_MAX_MS (30000U)
+
+/**
+* @brief Methods which can be repeated without visible side effects
+*/
+bool telegram_retry_is_idempotent(telegram_method_t method);
+
+/**
+* @brief Decide whether failed request should be repeated.
+* Connect and send failures are always retried: the request was not complete, so it was not processed.
+* Timeouts and 5xx are retried only for idempotent methods, as the request may have been delivered.
+* 429 is retried after retry_after.
+*
+* @param method method of the request
+* @param attempt number of the failed attempt, starting from 1
+* @param info result of the failed attempt
+* @param retry_after retry_after from the response, seconds
+* @param delay_ms where to store delay before the next attempt, jittered exponential backoff
+*
+* @return true if the request should be repeated
+*/
+bool telegram_retry_next(telegram_method_t method, uint32_t attempt, const telegram_io_info_t *info, 
+	uint32_t retry_after, uint32_t *delay_ms);
+
+#endif /* TELEGRAM_RETRY_H */
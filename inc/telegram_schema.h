@@ -0,0 +1,125 @@
+/**
+* Field tables of the Bot API types, one row per field:
+* X(type, kind, field name, JSON key, type of the nested object or _)
+* Kinds: INT, FLOAT, BOOL, STR, CHAT_TYPE, OBJ - nested object, ARR - array of nested objects with <name>_count.
+* Structures, presence bits, parsers and freers are generated from the tables, a type may have up to 32 fields.
+*/
+#ifndef TELEGRAM_SCHEMA_H
+#define TELEGRAM_SCHEMA_H
+
+#define TELEGRAM_SCHEMA_USER(X, T) \
+	X(T, INT,       id,            "id",            _) /** Unique identifier for this user or bot */ \
+	X(T, STR,       first_name,    "first_name",    _) /** User‘s or bot’s first name */ \
+	X(T, STR,       last_name,     "last_name",     _) /** Opt. User‘s or bot’s last name */ \
+	X(T, STR,       username,      "username",      _) /** Opt. User‘s or bot’s username */ \
+	X(T, STR,       language_code, "language_code", _) /** Opt. IETF language tag of the user's language */ \
+	X(T, BOOL,      is_bot,        "is_bot",        _) /** True, if this user is a bot */
+
+#define TELEGRAM_SCHEMA_CHAT(X, T) \
+	X(T, INT,       id,             "id",             _) /** Unique identifier for this chat */ \
+	X(T, STR,       title,          "title",          _) /** Opt. Title of the chat */ \
+	X(T, STR,       username,       "username",       _) /** Opt. Username, for private chats, supergroups and channels */ \
+	X(T, OBJ,       pinned_message, "pinned_message", telegram_chat_message_t) /** Opt. Pinned message */ \
+	X(T, CHAT_TYPE, type,           "type",           _) /** Type of the chat */
+
+#define TELEGRAM_SCHEMA_PHOTOSIZE(X, T) \
+	X(T, INT,       width,          "width",          _) /** Photo width */ \
+	X(T, INT,       height,         "height",         _) /** Photo height */ \
+	X(T, INT,       file_size,      "file_size",      _) /** Opt. File size */ \
+	X(T, STR,       id,             "file_id",        _) /** Unique file identifier */
+
+#define TELEGRAM_SCHEMA_DOCUMENT(X, T) \
+	X(T, INT,       file_size,      "file_size",      _) /** Opt. File size */ \
+	X(T, STR,       id,             "file_id",        _) /** Unique file identifier */ \
+	X(T, OBJ,       thumb,          "thumb",          telegram_photosize_t) /** Opt. Document thumbnail */ \
+	X(T, STR,       name,           "file_name",      _) /** Opt. Original filename as defined by sender */ \
+	X(T, STR,       mime_type,      "mime_type",      _) /** Opt. MIME type of the file as defined by sender */
+
+#define TELEGRAM_SCHEMA_LOCATION(X, T) \
+	X(T, FLOAT,     longitude,           "longitude",           _) /** Longitude as defined by sender */ \
+	X(T, FLOAT,     latitude,            "latitude",            _) /** Latitude as defined by sender */ \
+	X(T, FLOAT,     horizontal_accuracy, "horizontal_accuracy", _) /** Opt. Radius of uncertainty, meters */
+
+#define TELEGRAM_SCHEMA_CONTACT(X, T) \
+	X(T, INT,       user_id,        "user_id",        _) /** Opt. Contact's user identifier in Telegram */ \
+	X(T, STR,       phone_number,   "phone_number",   _) /** Contact's phone number */ \
+	X(T, STR,       first_name,     "first_name",     _) /** Contact's first name */ \
+	X(T, STR,       last_name,      "last_name",      _) /** Opt. Contact's last name */ \
+	X(T, STR,       vcard,          "vcard",          _) /** Opt. Additional data about the contact in the form of a vCard */
+
+#define TELEGRAM_SCHEMA_MESSAGE(X, T) \
+	X(T, INT,       id,                      "message_id",              _) /** Unique message identifier inside this chat */ \
+	X(T, INT,       timestamp,               "date",                    _) /** Unix timestamp of the message */ \
+	X(T, INT,       forward_from_message_id, "forward_from_message_id", _) /** Opt. Identifier of the original message in the channel */ \
+	X(T, INT,       forward_date,            "forward_date",            _) /** Opt. Date the original message was sent */ \
+	X(T, INT,       edit_date,               "edit_date",               _) /** Opt. Date the message was last edited */ \
+	X(T, OBJ,       from,                    "from",                    telegram_user_t) /** NULL in case of channel posts */ \
+	X(T, OBJ,       chat,                    "chat",                    telegram_chat_t) /** Conversation the message belongs to */ \
+	X(T, OBJ,       forward_from,            "forward_from",            telegram_user_t) /** Opt. Sender of the original message */ \
+	X(T, OBJ,       forward_from_chat,       "forward_from_chat",       telegram_chat_t) /** Opt. Chat of the original message */ \
+	X(T, STR,       forward_signature,       "forward_signature",       _) /** Opt. Signature of the original post author */ \
+	X(T, OBJ,       reply_to_message,        "reply_to_message",        telegram_chat_message_t) /** Opt. For replies, the original message */ \
+	X(T, STR,       media_group_id,          "media_group_id",          _) /** Opt. Media message group this message belongs to */ \
+	X(T, STR,       author_signature,        "author_signature",        _) /** Opt. Signature of the post author in channels */ \
+	X(T, STR,       text,                    "text",                    _) /** Opt. Text of the message */ \
+	X(T, STR,       caption,                 "caption",                 _) /** Opt. Caption of the media, 0-1024 characters */ \
+	X(T, OBJ,       file,                    "document",                telegram_document_t) /** Opt. General file */ \
+	X(T, ARR,       photo,                   "photo",                   telegram_photosize_t) /** Opt. Available sizes of the photo */ \
+	X(T, OBJ,       location,                "location",                telegram_location_t) /** Opt. Shared location */ \
+	X(T, OBJ,       contact,                 "contact",                 telegram_contact_t) /** Opt. Shared contact */
+
+#define TELEGRAM_SCHEMA_CALLBACK(X, T) \
+	X(T, STR,       id,             "id",             _) /** Unique identifier for this query */ \
+	X(T, OBJ,       from,           "from",           telegram_user_t) /** Sender */ \
+	X(T, STR,       data,           "data",           _) /** Opt. Data associated with the callback button */ \
+	X(T, OBJ,       message,        "message",        telegram_chat_message_t) /** Opt. Message with the button */
+
+#define TELEGRAM_SCHEMA_UPDATE(X, T) \
+	X(T, INT,       id,                  "update_id",           _) /** The update‘s unique identifier */ \
+	X(T, OBJ,       message,             "message",             telegram_chat_message_t) /** Opt. New incoming message */ \
+	X(T, OBJ,       edited_message,      "edited_message",      telegram_chat_message_t) /** Opt. Edited message */ \
+	X(T, OBJ,       channel_post,        "channel_post",        telegram_chat_message_t) /** Opt. New channel post */ \
+	X(T, OBJ,       edited_channel_post, "edited_channel_post", telegram_chat_message_t) /** Opt. Edited channel post */ \
+	X(T, OBJ,       callback_query,      "callback_query",      telegram_chat_callback_t) /** Opt. New incoming callback query */
+
+/** Field declarations grouped by alignment: 8 byte numbers, then pointers and enums, then the presence mask and bools */
+#define TELEGRAM_DECL8(T, kind, name, key, sub) TELEGRAM_DECL8_##kind(name, sub)
+#define TELEGRAM_DECL8_INT(name, sub) telegram_int_t name;
+#define TELEGRAM_DECL8_FLOAT(name, sub) double name;
+#define TELEGRAM_DECL8_BOOL(name, sub)
+#define TELEGRAM_DECL8_STR(name, sub)
+#define TELEGRAM_DECL8_CHAT_TYPE(name, sub)
+#define TELEGRAM_DECL8_OBJ(name, sub)
+#define TELEGRAM_DECL8_ARR(name, sub)
+
+#define TELEGRAM_DECL4(T, kind, name, key, sub) TELEGRAM_DECL4_##kind(name, sub)
+#define TELEGRAM_DECL4_INT(name, sub)
+#define TELEGRAM_DECL4_FLOAT(name, sub)
+#define TELEGRAM_DECL4_BOOL(name, sub)
+#define TELEGRAM_DECL4_STR(name, sub) const char *name;
+#define TELEGRAM_DECL4_CHAT_TYPE(name, sub) telegram_chat_type_t name;
+#define TELEGRAM_DECL4_OBJ(name, sub) sub *name;
+#define TELEGRAM_DECL4_ARR(name, sub) sub *name; uint32_t name##_count;
+
+#define TELEGRAM_DECL1(T, kind, name, key, sub) TELEGRAM_DECL1_##kind(name, sub)
+#define TELEGRAM_DECL1_INT(name, sub)
+#define TELEGRAM_DECL1_FLOAT(name, sub)
+#define TELEGRAM_DECL1_BOOL(name, sub) bool name;
+#define TELEGRAM_DECL1_STR(name, sub)
+#define TELEGRAM_DECL1_CHAT_TYPE(name, sub)
+#define TELEGRAM_DECL1_OBJ(name, sub)
+#define TELEGRAM_DECL1_ARR(name, sub)
+
+#define TELEGRAM_SCHEMA_BODY(LIST, T) \
+	LIST(TELEGRAM_DECL8, T) \
+	LIST(TELEGRAM_DECL4, T) \
+	uint32_t present; /** Bit per field, set if the field was in the JSON object, see TELEGRAM_HAS */ \
+	LIST(TELEGRAM_DECL1, T)
+
+#define TELEGRAM_SCHEMA_BIT(T, kind, name, key, sub) TELEGRAM_F_##T##_##name,
+#define TELEGRAM_SCHEMA_BITS(LIST, T) enum { LIST(TELEGRAM_SCHEMA_BIT, T) TELEGRAM_F_##T##_COUNT };
+
+/** Check presence of the optional field, e.g. TELEGRAM_HAS(msg, telegram_chat_message_t, location) */
+#define TELEGRAM_HAS(obj, T, name) (((obj) != NULL) && ((obj)->present & (1UL << TELEGRAM_F_##T##_##name)))
+
+#endif /* TELEGRAM_SCHEMA_H */
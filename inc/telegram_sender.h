@@ -0,0 +1,62 @@
+#ifndef TELEGRAM_SENDER_H
+#define TELEGRAM_SENDER_H
+#include <stdint.h>
+#include <stdbool.h>
+#include "telegram_parse.h"
+#include "telegram_io.h"
+#include "telegram_response.h"
+
+#define TELEGRAM_SENDER_QUEUE_LEN (8U)
+#define TELEGRAM_SENDER_TASK_STACK (5120U)
+
+/** Outcome of the asynchronous request */
+typedef struct
+{
+	bool ok;                          /** Request succeeded */
+	int status;                       /** HTTP status code, 0 if no response was received */
+	int err;                          /** esp_err_t of the failed step or 0 */
+	telegram_method_t method;         /** Method of the request */
+	telegram_chat_message_t *message; /** Sent or edited message if returned, valid only inside the callback */
+	telegram_response_t api;          /** Decoded status of the answer, see telegram_response_classify */
+} telegram_send_result_t;
+
+/** Called from the sender task when the request is completed */
+typedef void(*telegram_send_done_cb_t)(void *teleCtx_ptr, void *ctx, const telegram_send_result_t *res);
+
+/**
+ Executes request, response should be freed with telegram_free, api receives the decoded status.
+ chat_id is the target chat of the request or 0.
+*/
+typedef bool(*telegram_sender_exec_t)(void *owner, telegram_method_t method, telegram_int_t chat_id, 
+	const char *payload, char **response, telegram_io_info_t *info, telegram_response_t *api);
+
+/**
+* @brief Start sender task which executes queued requests in order
+*
+* @param queue_len max number of not yet executed requests, 0 - TELEGRAM_SENDER_QUEUE_LEN
+* @param exec function to execute the request
+* @param owner bot handle, passed to exec and completion callbacks
+*
+* @return NULL or sender handle
+*/
+void *telegram_sender_init(uint32_t queue_len, telegram_sender_exec_t exec, void *owner);
+
+/**
+* @brief Queue request, payload is owned by the sender afterwards, even on failure
+*
+* @param chat_id target chat passed to exec, 0 - not a chat request
+* @param cb optional completion callback
+*
+* @return false if the queue is full
+*/
+bool telegram_sender_push(void *sender, telegram_method_t method, telegram_int_t chat_id, char *payload, 
+	telegram_send_done_cb_t cb, void *ctx);
+
+/**
+* @brief Execute already queued requests and stop the sender.
+* If called from a completion callback (sender task), queued requests are dropped without callbacks
+* and the task exits after the callback returns.
+*/
+void telegram_sender_stop(void *sender);
+
+#endif /* TELEGRAM_SENDER_H */
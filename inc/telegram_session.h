@@ -0,0 +1,88 @@
+#ifndef TELEGRAM_SESSION_H
+#define TELEGRAM_SESSION_H
+#include <stdint.h>
+#include <stdbool.h>
+
+#define TELEGRAM_SESSION_CAPACITY  (32U)
+#define TELEGRAM_SESSION_DATA_SIZE (64U)
+
+/**
+* Called when a session is created, fill data from persistent storage
+* @return false if nothing is stored, data stays zeroed
+*/
+typedef bool(*telegram_session_load_t)(void *ctx, int64_t id, void *data, uint32_t size);
+
+/** Called to write dirty session to persistent storage: on eviction, expiry, flush and free */
+typedef void(*telegram_session_save_t)(void *ctx, int64_t id, const void *data, uint32_t size);
+
+typedef struct
+{
+	uint32_t capacity;            /** Max number of sessions, least recently used is evicted, 0 - TELEGRAM_SESSION_CAPACITY */
+	uint32_t data_size;           /** Size of the user state of the session, 0 - TELEGRAM_SESSION_DATA_SIZE */
+	uint32_t ttl_sec;             /** Session not used for ttl_sec is dropped, 0 - never */
+	telegram_session_load_t load; /** Opt. */
+	telegram_session_save_t save; /** Opt. */
+	void *ctx;                    /** Argument of load and save */
+} telegram_session_cfg_t;
+
+typedef struct
+{
+	uint32_t count;     /** Sessions in the store */
+	uint32_t hits;      /** Lookups of existing sessions */
+	uint32_t misses;    /** Lookups that created or did not find a session */
+	uint32_t evictions; /** Sessions dropped because the store was full */
+	uint32_t expired;   /** Sessions dropped by ttl */
+} telegram_session_stats_t;
+
+/**
+* @brief Create session store: fixed slab of sessions indexed by open addressing hash of 64-bit id.
+* Nothing is allocated after init. Store is not thread safe, use it from the dispatch task.
+*
+* @param cfg configuration, NULL - defaults without persistence
+*
+* @return NULL or store handle
+*/
+void *telegram_session_init(const telegram_session_cfg_t *cfg);
+
+/**
+* @brief Find session, O(1)
+* Pointer stays valid until the session is removed or evicted,
+* evicted is the least recently used session, so capacity - 1 other sessions may be fetched safely.
+*
+* @param id user or chat id
+* @param create create zeroed (or loaded) session if not found
+*
+* @return NULL or data_size bytes of the session state, 8 byte aligned
+*/
+void *telegram_session_get(void *store, int64_t id, bool create);
+
+/**
+* @brief Mark session data as changed, it will be passed to save callback
+*
+* @param data pointer returned by telegram_session_get
+*/
+void telegram_session_mark_dirty(void *store, void *data);
+
+/**
+* @brief Drop session without saving
+*/
+void telegram_session_remove(void *store, int64_t id);
+
+/**
+* @brief Drop sessions expired by ttl
+*/
+void telegram_session_expire(void *store);
+
+/**
+* @brief Save all dirty sessions
+*/
+void telegram_session_flush(void *store);
+
+void telegram_session_get_stats(void *store, telegram_session_stats_t *stats);
+
+/**
+* @brief Save dirty sessions and free the store
+*/
+void telegram_session_free(void *store);
+
+#endif /* TELEGRAM_SESSION_H */
@@ -0,0 +1,99 @@
+/**
+* Binary snapshot of updates for store and forward: header with magic, version and CRC followed by telegram_rec_t records.
+* Snapshot is position independent, it can be written to queues, NVS, flash or files as is and read in place.
+*
+* Records are a lossy digest of the update, not the update itself. Kept fields:
+* - update_id and the kind of the update: message, edited message, channel post, edited post or callback query
+* - message: message_id, date, edit_date, text, caption, media_group_id
+* - chat: id, type, title, username
+* - sender (the query sender for callback queries): id, is_bot, first_name, username, language_code
+* - reply_to_message: message_id only
+* - forward_from: user id only
+* - document: file_id, file_name, mime_type, file_size
+* - photo: file_id and file_size of the largest size only
+* - location: latitude and longitude narrowed to float
+* - callback query: id and data
+* Everything else is dropped, in particular contact, forward_from_chat, forward dates and signatures,
+* author_signature, pinned_message, last names, location.horizontal_accuracy, document thumb, other photo sizes
+* and the content of reply_to_message. Keep the JSON of the update if it has to be reproduced exactly.
+*/
+#ifndef TELEGRAM_SNAP_H
+#define TELEGRAM_SNAP_H
+#include <stdint.h>
+#include <stdbool.h>
+#include "telegram_parse.h"
+#include "telegram_rec.h"
+
+#define TELEGRAM_SNAP_MAGIC   (0x50534754U) /** "TGSP" */
+#define TELEGRAM_SNAP_VERSION (1U)
+
+/** Snapshot header, records follow it, buffer must be 8 byte aligned */
+typedef struct
+{
+	uint32_t magic;    /** TELEGRAM_SNAP_MAGIC */
+	uint16_t version;  /** TELEGRAM_SNAP_VERSION */
+	uint16_t rec_hdr;  /** sizeof(telegram_rec_t) of the writer, guards layout changes */
+	uint32_t size;     /** Size of the snapshot with the header */
+	uint32_t count;    /** Number of records */
+	uint32_t crc;      /** CRC-32 of the records */
+	uint32_t reserved;
+} telegram_snap_t;
+
+/**
+* @brief Start empty snapshot in the buffer
+*
+* @param buf 8 byte aligned buffer
+* @param buf_size size of the buffer, at least sizeof(telegram_snap_t)
+*
+* @return NULL or snapshot
+*/
+telegram_snap_t *telegram_snap_init(void *buf, uint32_t buf_size);
+
+/**
+* @brief Append update to the snapshot
+*
+* @param snap snapshot started by telegram_snap_init
+* @param buf_size size of the snapshot buffer
+* @param upd parsed update, can be freed right after the call
+*
+* @return false if the buffer is too small
+*/
+bool telegram_snap_add(telegram_snap_t *snap, uint32_t buf_size, const telegram_update_t *upd);
+
+/**
+* @brief Append already flattened record
+*
+* @return false if the buffer is too small
+*/
+bool telegram_snap_add_rec(telegram_snap_t *snap, uint32_t buf_size, const telegram_rec_t *rec);
+
+/**
+* @brief Make allocated snapshot with one update, free with telegram_free
+*/
+telegram_snap_t *telegram_snap_from_update(const telegram_update_t *upd);
+
+/** Bytes to store or copy */
+uint32_t telegram_snap_size(const telegram_snap_t *snap);
+
+uint32_t telegram_snap_count(const telegram_snap_t *snap);
+
+/**
+* @brief Validate snapshot read from storage: magic, version, layout, sizes, CRC and string offsets of records
+*
+* @param buf 8 byte aligned data
+* @param len number of bytes available
+*
+* @return NULL if data is not a valid snapshot or snapshot to read in place
+*/
+const telegram_snap_t *telegram_snap_check(const void *buf, uint32_t len);
+
+/**
+* @brief Iterate records of the checked snapshot
+*
+* @param prev NULL to get the first record
+*
+* @return next record or NULL
+*/
+const telegram_rec_t *telegram_snap_next(const telegram_snap_t *snap, const telegram_rec_t *prev);
+
+#endif /* TELEGRAM_SNAP_H */
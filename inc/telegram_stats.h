@@ -0,0 +1,60 @@
+#ifndef TELEGRAM_STATS_H
+#define TELEGRAM_STATS_H
+#include <stdint.h>
+#include <stdbool.h>
+#include "telegram_parse.h"
+#include "telegram_io.h"
+
+/** Set to 0 to compile out collecting of the statistics */
+#define TELEGRAM_STATS_ENABLE (1)
+
+/** Bucket 0 counts samples below 1 ms, bucket N counts samples in [2^(N-1), 2^N) ms, last bucket is open ended */
+#define TELEGRAM_STATS_HIST_BUCKETS (16U)
+
+/** Latency histogram, log2 buckets in milliseconds */
+typedef struct
+{
+	uint32_t buckets[TELEGRAM_STATS_HIST_BUCKETS];
+	uint32_t count;  /** Number of samples */
+	uint64_t sum_us; /** Sum of all samples, to calculate average */
+	uint32_t max_us; /** Worst sample */
+} telegram_stats_hist_t;
+
+/** Counters of a single REST API method */
+typedef struct
+{
+	uint32_t requests;  /** Number of requests made */
+	uint32_t errors;    /** Requests failed on transport level or with non 2xx status */
+	uint64_t bytes_out; /** Request body bytes */
+	uint64_t bytes_in;  /** Response body bytes */
+	telegram_stats_hist_t connect;    /** DNS, TCP connect and TLS handshake */
+	telegram_stats_hist_t first_byte; /** Time to the response headers */
+	telegram_stats_hist_t total;      /** Whole request */
+} telegram_method_stats_t;
+
+typedef struct
+{
+	telegram_method_stats_t methods[TELEGRAM_METHOD_COUNT]; /** Indexed by telegram_method_t */
+	telegram_stats_hist_t parse;      /** JSON parse time per update, callback time excluded */
+	telegram_stats_hist_t dispatch;   /** Time spent in the user callback per update */
+	telegram_stats_hist_t mutex_wait; /** Time spent waiting for the core mutex */
+} telegram_stats_t;
+
+/**
+* @brief Add sample to histogram
+*
+* @param hist histogram to update
+* @param us sample in microseconds
+*/
+void telegram_stats_sample(telegram_stats_hist_t *hist, int64_t us);
+
+/**
+* @brief Account finished request
+*
+* @param stats statistics to update
+* @param method REST API method of the request
+* @param info details of the request reported by the io layer
+*/
+void telegram_stats_request(telegram_stats_t *stats, telegram_method_t method, const telegram_io_info_t *info);
+
+#endif /* TELEGRAM_STATS_H */
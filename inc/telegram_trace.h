@@ -0,0 +1,48 @@
+#ifndef TELEGRAM_TRACE_H
+#define TELEGRAM_TRACE_H
+#include <stdint.h>
+
+/** Set to 1 to enable trace events, when 0 all trace points compile to nothing */
+#define TELEGRAM_TRACE_ENABLE (0)
+
+/** Request lifecycle points */
+typedef enum
+{
+	TELEGRAM_TRACE_POLL_START,       /** getUpdates request started */
+	TELEGRAM_TRACE_HEADERS,          /** Response headers received, arg - HTTP status */
+	TELEGRAM_TRACE_BODY,             /** Response body bytes received, arg - number of bytes */
+	TELEGRAM_TRACE_PARSE_START,      /** JSON parsing started */
+	TELEGRAM_TRACE_PARSE_END,        /** JSON parsing and dispatching finished, arg - number of updates */
+	TELEGRAM_TRACE_DISPATCH_START,   /** User callback is called */
+	TELEGRAM_TRACE_DISPATCH_END,     /** User callback returned */
+	TELEGRAM_TRACE_SEND_ENQUEUED,    /** Outgoing request accepted by the library, arg - telegram_method_t */
+	TELEGRAM_TRACE_SEND_DONE,        /** Request finished, arg - HTTP status or 0 */
+	TELEGRAM_TRACE_MUTEX_ACQUIRED,   /** Core mutex taken */
+	TELEGRAM_TRACE_MUTEX_RELEASED,   /** Core mutex given */
+	TELEGRAM_TRACE_EVT_COUNT
+} telegram_trace_evt_t;
+
+/**
+* Called synchronously from the task that hits the trace point, should be short and must not call the library
+*
+* @param evt trace point
+* @param req_id id of the request the event belongs to
+* @param timestamp_us monotonic time, esp_timer_get_time()
+* @param arg event specific value
+*/
+typedef void(*telegram_trace_cb_t)(telegram_trace_evt_t evt, uint32_t req_id, int64_t timestamp_us, uint32_t arg);
+
+#if TELEGRAM_TRACE_ENABLE == 1
+void telegram_trace_set_cb(telegram_trace_cb_t cb);
+uint32_t telegram_trace_new_id(void);
+void telegram_trace_emit(telegram_trace_evt_t evt, uint32_t req_id, uint32_t arg);
+
+#define TELEGRAM_TRACE(evt, req_id, arg) telegram_trace_emit((evt), (req_id), (uint32_t)(arg))
+#define TELEGRAM_TRACE_NEW_ID() telegram_trace_new_id()
+#else
+#define telegram_trace_set_cb(cb)
+#define TELEGRAM_TRACE(evt, req_id, arg)
+#define TELEGRAM_TRACE_NEW_ID() (0U)
+#endif
+
+#endif /* TELEGRAM_TRACE_H */
@@ -0,0 +1,49 @@
+#ifndef TELEGRAM_WEBHOOK_H
+#define TELEGRAM_WEBHOOK_H
+#include <stdint.h>
+#include <stddef.h>
+
+/** Set to 1 to serve the webhook over TLS with esp_https_server, requires certificate and key in the config */
+#define TELEGRAM_WEBHOOK_HTTPS (0)
+
+#define TELEGRAM_WEBHOOK_DEFAULT_PATH "/telegram"
+#define TELEGRAM_WEBHOOK_SECRET_HDR "X-Telegram-Bot-Api-Secret-Token"
+#define TELEGRAM_WEBHOOK_SECRET_MAX_LEN (256U)
+/** The server task runs the message callback, which may send requests over TLS */
+#define TELEGRAM_WEBHOOK_TASK_STACK (5120U)
+
+/** Webhook receive mode settings */
+typedef struct
+{
+	const char *url;            /** Public https url Telegram posts updates to, e.g. behind a reverse proxy */
+	uint16_t port;              /** Local port of the embedded server */
+	const char *path;           /** Opt. Local uri, TELEGRAM_WEBHOOK_DEFAULT_PATH if NULL */
+	const char *secret_token;   /** Opt. Secret Telegram sends in every request, requests without it are rejected */
+	uint32_t max_connections;   /** Opt. Max simultaneous connections Telegram opens, 0 - Telegram default */
+	const uint8_t *cert_pem;    /** Server certificate, TELEGRAM_WEBHOOK_HTTPS only */
+	size_t cert_len;
+	const uint8_t *key_pem;     /** Server private key, TELEGRAM_WEBHOOK_HTTPS only */
+	size_t key_len;
+	uint32_t stack_size;        /** Opt. Stack of the server task, 0 - TELEGRAM_WEBHOOK_TASK_STACK */
+} telegram_webhook_cfg_t;
+
+/**
+ Called from the server task with body of the pushed update.
+ May return JSON body of the response (a method call answered inline), memory is freed by the webhook.
+*/
+typedef char *(*telegram_webhook_on_update_t)(void *ctx, const char *buffer);
+
+/**
+* @brief Start embedded server that accepts pushed updates
+*
+* @param cfg webhook settings, url is not used by the server
+* @param on_update callback on every received update
+* @param ctx argument of the callback
+*
+* @return NULL or webhook handle
+*/
+void *telegram_webhook_init(const telegram_webhook_cfg_t *cfg, telegram_webhook_on_update_t on_update, void *ctx);
+
+void telegram_webhook_stop(void *webhook);
+
+#endif /* TELEGRAM_WEBHOOK_H */
@@ -1,12 +1,28 @@
 #include <string.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <unistd.h>
 #include <esp_log.h>
+#include <esp_timer.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/semphr.h>
+#include <freertos/task.h>
 #include "telegram.h"
 #include "telegram_io.h"
 #include "telegram_getter.h"
+#include "telegram_cache.h"
+#include "telegram_stats.h"
+#include "telegram_mem.h"
+#include "telegram_trace.h"
+#include "telegram_webhook.h"
+#include "telegram_coalesce.h"
+#include "telegram_retry.h"
+#include "telegram_sender.h"
+#include "telegram_session.h"
+#include "telegram_ack.h"
+#include "telegram_lane.h"
+#include "telegram_response.h"
+#include "telegram_deadchat.h"
 
 #define TELEGRAM_DEBUG 0
 
@@ -16,6 +32,9 @@ static const char *TAG="telegram_core";
 #define TELEGRAM_BOUNDARY "--"TELEGRAM_BOUNDARY_HDR
 #define TELEGRAM_BOUNDARY_CONTENT_FMT TELEGRAM_BOUNDARY"\r\nContent-Disposition: form-data; name="
 #define TELEGRAM_BOUNDARY_FTR "\r\n"TELEGRAM_BOUNDARY"--\r\n"
+#define TELEGRAM_MEDIA_ITEM_FMT "{\"type\": \"%s\", \"media\": \"attach://file%u\""
+#define TELEGRAM_MEDIA_CAPTION_FMT ", \"caption\": \"%s\""
+#define TELEGRAM_MEDIA_FILE_FMT "%s"TELEGRAM_BOUNDARY_CONTENT_FMT"\"file%u\"; filename=\"%s\"\r\nContent-Type: application/octet-stream\r\n\r\n"
 
 typedef struct 
 {
@@ -31,49 +50,204 @@ const telegram_io_header_t jsonHeaders[] =
 	{NULL, NULL}
 };
 
+static const telegram_io_header_t multipartHeaders[] = 
+{
+	{"Content-Type", "multipart/form-data; boundary="TELEGRAM_BOUNDARY_HDR}, 
+	{NULL, NULL}
+};
+
+/** 
+ Connection and the lock serializing requests over it. When the lock is released it is handed over to a waiting
+ request of the most urgent class, so interactive requests queued behind a transfer go before bulk ones.
+*/
+typedef struct
+{
+	void *io_ctx;
+	portMUX_TYPE lock;
+	bool busy;
+	uint32_t waiting[TELEGRAM_LANE_COUNT];       /** Number of waiting requests of each class */
+	SemaphoreHandle_t wake[TELEGRAM_LANE_COUNT]; /** Given to the waiters of the class the lock is handed over to */
+} telegram_lane_ctx_t;
+
+/** Resources a bot may share with other bots of the same multiplexer */
 typedef struct
+{
+	telegram_lane_ctx_t poll; /** getUpdates and everything else if lanes are disabled, ordered by class */
+#if TELEGRAM_LANES_ENABLE == 1
+	telegram_lane_ctx_t lanes[TELEGRAM_LANE_COUNT];
+#endif
+	portMUX_TYPE stats_lock;
+	telegram_stats_t stats;
+} telegram_shared_t;
+
+struct telegram_mux;
+
+typedef struct telegram_ctx
 {
     char *token;	
 	void *getter;
-	void *io_ctx;
+	void *webhook;
+	telegram_shared_t *shared;
+	struct telegram_mux *mux;
+	struct telegram_ctx *next;
+	uint32_t refs;               /** Mux bots: held by the poller while the bot is polled, under list_lock */
+	bool removed;                /** Mux bots: stopped, the last reference frees the context */
 	telegram_on_msg_cb_t on_msg_cb;
 	telegram_int_t last_update_id;
 	uint32_t max_messages;
-	SemaphoreHandle_t sem;
+	void *file_cache;
+	int64_t dispatch_us;
+	uint32_t dispatch_count;
+	uint32_t poll_req_id;
+	TaskHandle_t reply_task;
+	char *inline_reply;
+	void *coalesce;
+	void *sender;
+	void *sessions;
+	SemaphoreHandle_t sessions_lock; /** Recursive, held while updates are dispatched and while the store is replaced */
+	void *dead_chats;
+	void *ack_sender;            /** Task sending callback query acknowledgements over the interactive lane */
+	telegram_ack_policy_t ack_policy;
+	void *ack_policy_ctx;
+	portMUX_TYPE ack_lock;
+	telegram_ack_history_t acked;
+	uint8_t method_lane[TELEGRAM_METHOD_COUNT]; /** telegram_lane_t of each method */
 } telegram_ctx_t;
 
-static void telegram_wait_mutex_func(telegram_ctx_t *ctx, char *func_name)
+typedef struct telegram_mux
+{
+	telegram_shared_t shared;
+	void *getter;
+	SemaphoreHandle_t list_lock;
+	telegram_ctx_t *bots;
+} telegram_mux_t;
+
+static void telegram_stats_account(telegram_ctx_t *ctx, telegram_method_t method, const telegram_io_info_t *info)
 {
-	while (!xSemaphoreTake(ctx->sem, portMAX_DELAY))
+#if TELEGRAM_STATS_ENABLE == 1
+	portENTER_CRITICAL(&ctx->shared->stats_lock);
+	telegram_stats_request(&ctx->shared->stats, method, info);
+	portEXIT_CRITICAL(&ctx->shared->stats_lock);
+#endif
+}
+
+static void telegram_stats_account_sample(telegram_ctx_t *ctx, telegram_stats_hist_t *hist, int64_t us)
+{
+#if TELEGRAM_STATS_ENABLE == 1
+	portENTER_CRITICAL(&ctx->shared->stats_lock);
+	telegram_stats_sample(hist, us);
+	portEXIT_CRITICAL(&ctx->shared->stats_lock);
+#endif
+}
+
+static telegram_lane_ctx_t *telegram_lane_get(telegram_ctx_t *ctx, telegram_lane_t lane)
+{
+#if TELEGRAM_LANES_ENABLE == 1
+	return &ctx->shared->lanes[lane];
+#else
+	return &ctx->shared->poll;
+#endif
+}
+
+static void telegram_wait_mutex_func(telegram_ctx_t *ctx, telegram_lane_ctx_t *lane, telegram_lane_t prio, 
+	uint32_t req_id, char *func_name)
+{
+	bool wait;
+	int64_t start = esp_timer_get_time();
+
+	portENTER_CRITICAL(&lane->lock);
+	wait = lane->busy;
+	if (wait)
+	{
+		lane->waiting[prio]++;
+	} else
+	{
+		lane->busy = true;
+	}
+	portEXIT_CRITICAL(&lane->lock);
+
+	/* The lock is handed over by telegram_give_mutex_func, busy stays set */
+	while (wait && !xSemaphoreTake(lane->wake[prio], portMAX_DELAY))
 	{
 		ESP_LOGW(TAG, "Mutex wait error! %s", func_name);
 	}		
+
+	TELEGRAM_TRACE(TELEGRAM_TRACE_MUTEX_ACQUIRED, req_id, 0);
+	telegram_stats_account_sample(ctx, &ctx->shared->stats.mutex_wait, esp_timer_get_time() - start);
 }
 
-static void telegram_give_mutex_func(telegram_ctx_t *ctx)
+static void telegram_give_mutex_func(telegram_ctx_t *ctx, telegram_lane_ctx_t *lane, uint32_t req_id)
 {
-	xSemaphoreGive(ctx->sem);
+	uint32_t i;
+
+	TELEGRAM_TRACE(TELEGRAM_TRACE_MUTEX_RELEASED, req_id, 0);
+	portENTER_CRITICAL(&lane->lock);
+	for (i = 0; (i < TELEGRAM_LANE_COUNT) && (lane->waiting[i] == 0); i++);
+	if (i < TELEGRAM_LANE_COUNT)
+	{
+		lane->waiting[i]--;
+	} else
+	{
+		lane->busy = false;
+	}
+	portEXIT_CRITICAL(&lane->lock);
+
+	if (i < TELEGRAM_LANE_COUNT)
+	{
+		xSemaphoreGive(lane->wake[i]);
+	}
 }
 
 #if TELGRAM_DEBUG == 1
-#define telegram_wait_mutex(x) { \
+#define telegram_wait_sem(x, lane_ctx, prio, id) { \
 	ESP_LOGI(TAG, "Taking mutex %s", __func__); \
-	telegram_wait_mutex_func(x, (char *)__func__); \
+	telegram_wait_mutex_func(x, lane_ctx, prio, id, (char *)__func__); \
 }
-#define telegram_give_mutex(x) { \
+#define telegram_give_sem(x, lane_ctx, id) { \
 	ESP_LOGI(TAG, "Give mutex %s", __func__); \
-	telegram_give_mutex_func(x); \
+	telegram_give_mutex_func(x, lane_ctx, id); \
 }
 
 #else 
-#define telegram_wait_mutex(x) telegram_wait_mutex_func(x, (char *)__func__);
-#define telegram_give_mutex(x) telegram_give_mutex_func(x); 
+#define telegram_wait_sem(x, lane_ctx, prio, id) telegram_wait_mutex_func(x, lane_ctx, prio, id, (char *)__func__);
+#define telegram_give_sem(x, lane_ctx, id) telegram_give_mutex_func(x, lane_ctx, id); 
 #endif
 
+/** getUpdates waits for the poll connection as a normal request */
+#define telegram_wait_mutex(x, id) telegram_wait_sem(x, &(x)->shared->poll, TELEGRAM_LANE_NORMAL, id)
+#define telegram_give_mutex(x, id) telegram_give_sem(x, &(x)->shared->poll, id)
+#define telegram_wait_lane(x, lane, id) telegram_wait_sem(x, telegram_lane_get(x, lane), lane, id)
+#define telegram_give_lane(x, lane, id) telegram_give_sem(x, telegram_lane_get(x, lane), id)
+
+
+static void telegram_auto_ack(telegram_ctx_t *teleCtx, telegram_update_t *upd);
+
+/** Message of any kind the update carries, used to find the chat it came from */
+static telegram_chat_message_t *telegram_update_message(telegram_update_t *upd)
+{
+	if (upd->edited_message != NULL)
+	{
+		return upd->edited_message;
+	}
+
+	if (upd->edited_channel_post != NULL)
+	{
+		return upd->edited_channel_post;
+	}
+
+	if (upd->callback_query != NULL)
+	{
+		return upd->callback_query->message;
+	}
+
+	return telegram_get_message(upd);
+}
 
 static void telegram_process_message_int_cb(void *hnd, telegram_update_t *upd)
 {
+	int64_t start;
 	telegram_ctx_t *teleCtx = NULL;
+	telegram_chat_message_t *msg = NULL;
 
 	if ((hnd == NULL) || (upd == NULL))
 	{
@@ -83,7 +257,50 @@ static void telegram_process_message_int_cb(void *hnd, telegram_update_t *upd)
 
 	teleCtx = (telegram_ctx_t *)hnd;
  	teleCtx->last_update_id = upd->id;
+	start = esp_timer_get_time();
+	TELEGRAM_TRACE(TELEGRAM_TRACE_DISPATCH_START, teleCtx->poll_req_id, 0);
+	msg = telegram_update_message(upd);
+	if ((teleCtx->dead_chats != NULL) && (msg != NULL))
+	{
+		/* The chat wrote to the bot, edited a message or pressed a button, so it is reachable again */
+		telegram_deadchat_remove(teleCtx->dead_chats, telegram_get_chat_id(msg));
+	}
+
+	telegram_auto_ack(teleCtx, upd);
  	teleCtx->on_msg_cb(teleCtx, upd);
+	TELEGRAM_TRACE(TELEGRAM_TRACE_DISPATCH_END, teleCtx->poll_req_id, 0);
+	start = esp_timer_get_time() - start;
+	teleCtx->dispatch_us += start;
+	teleCtx->dispatch_count++;
+	telegram_stats_account_sample(teleCtx, &teleCtx->shared->stats.dispatch, start);
+}
+
+static void telegram_dispatch(telegram_ctx_t *teleCtx, const char *buffer, uint32_t req_id, bool single_update)
+{
+	int64_t parse_us;
+
+	teleCtx->poll_req_id = req_id;
+	teleCtx->dispatch_us = 0;
+	teleCtx->dispatch_count = 0;
+	xSemaphoreTakeRecursive(teleCtx->sessions_lock, portMAX_DELAY);
+	parse_us = esp_timer_get_time();
+	TELEGRAM_TRACE(TELEGRAM_TRACE_PARSE_START, req_id, 0);
+	if (single_update)
+	{
+		telegram_parse_update_object(teleCtx, buffer, telegram_process_message_int_cb);
+	} else
+	{
+		telegram_parse_messages(teleCtx, buffer, telegram_process_message_int_cb);
+	}
+	TELEGRAM_TRACE(TELEGRAM_TRACE_PARSE_END, req_id, teleCtx->dispatch_count);
+	parse_us = esp_timer_get_time() - parse_us - teleCtx->dispatch_us;
+	if (teleCtx->dispatch_count)
+	{
+		telegram_stats_account_sample(teleCtx, &teleCtx->shared->stats.parse, parse_us / teleCtx->dispatch_count);
+	}
+
+	telegram_session_expire(teleCtx->sessions);
+	xSemaphoreGiveRecursive(teleCtx->sessions_lock);
 }
 
 static void telegram_getMessages(void *ctx)
@@ -98,6 +315,8 @@ static void telegram_getMessages(void *ctx)
 #endif
 	char *buffer = NULL;
 	char *path = NULL;
+	uint32_t req_id = TELEGRAM_TRACE_NEW_ID();
+	telegram_io_info_t info = {.req_id = req_id};
 	telegram_ctx_t *teleCtx = (telegram_ctx_t *)ctx;
 
 	if (!ctx)
@@ -106,7 +325,8 @@ static void telegram_getMessages(void *ctx)
 		return;
 	}
 
-	telegram_wait_mutex(teleCtx);
+	TELEGRAM_TRACE(TELEGRAM_TRACE_POLL_START, req_id, 0);
+	telegram_wait_mutex(teleCtx, req_id);
 
 	path = telegram_make_method_path(TELEGRAM_GET_UPDATES, teleCtx->token, teleCtx->max_messages, 
 		(teleCtx->last_update_id?(teleCtx->last_update_id + 1):0), NULL);
@@ -114,292 +334,1236 @@ static void telegram_getMessages(void *ctx)
 	if (!path)
 	{
 		ESP_LOGE(TAG, "No mem!");
-		telegram_give_mutex(teleCtx);
+		telegram_give_mutex(teleCtx, req_id);
 		return;
 	}
 
 #if TELEGRAM_LONG_POLLING == 1
-	buffer = telegram_io_get_ctx(&teleCtx->io_ctx, path, (telegram_io_header_t *)sendHeaders);
+	buffer = telegram_io_get_ctx(&teleCtx->shared->poll.io_ctx, path, (telegram_io_header_t *)sendHeaders, &info);
 #else
-	buffer = telegram_io_get_ctx(&teleCtx->io_ctx, path, NULL);
+	buffer = telegram_io_get_ctx(&teleCtx->shared->poll.io_ctx, path, NULL, &info);
 #endif
- 	free(path);
+ 	telegram_free_tag(TELEGRAM_MEM_MAKE, path);
+	telegram_stats_account(teleCtx, TELEGRAM_GET_UPDATES, &info);
+	/* Handlers and the ack task send over the same connection, they must not wait for the dispatch */
+ 	telegram_give_mutex(teleCtx, req_id);
  	if (buffer != NULL)
  	{
- 		telegram_parse_messages(teleCtx, buffer, telegram_process_message_int_cb);
- 		free(buffer);
+		telegram_dispatch(teleCtx, buffer, req_id, false);
+ 		telegram_free_tag(TELEGRAM_MEM_IO, buffer);
  	}
-
- 	telegram_give_mutex(teleCtx);
 }
 
-void telegram_stop(void *teleCtx_ptr)
+/**
+ Sends JSON request (payload) or multipart request (parts), returns response body if the request succeeded 
+ and response is requested. Failed attempts are repeated according to telegram_retry_next, the mutex is released 
+ during backoff. Multipart requests are repeated only if all parts are in memory, producers can not be replayed.
+ The request waits for the connection of the lane as a request of that class.
+ api is optional, it receives the decoded status of the last answer.
+*/
+static bool telegram_send_request_io(telegram_ctx_t *teleCtx, telegram_lane_t lane, telegram_method_t method, const char *payload, const telegram_io_part_t *parts, uint32_t count, 
+	char **response, telegram_io_info_t *result, telegram_response_t *api)
 {
-	telegram_ctx_t *teleCtx = (telegram_ctx_t *)teleCtx_ptr;
-
-	if (teleCtx_ptr == NULL)
+	char *path = NULL;
+	char *buffer = NULL;
+	bool replayable = true;
+	uint32_t i;
+	uint32_t attempt = 0;
+	uint32_t delay_ms = 0;
+	uint32_t req_id = TELEGRAM_TRACE_NEW_ID();
+	telegram_io_info_t info = {.req_id = req_id};
+	telegram_response_t resp = {0};
+	telegram_lane_ctx_t *lane_ctx = telegram_lane_get(teleCtx, lane);
+
+	for (i = 0; (parts != NULL) && (i < count); i++)
 	{
-		return;
+		replayable = replayable && ((parts[i].data != NULL) || (parts[i].len == 0));
 	}
 
-	telegram_getter_stop(teleCtx->getter);
-	telegram_io_free_ctx(&teleCtx->io_ctx);
-	free(teleCtx->token);
-	free(teleCtx);
-}
-
-void *telegram_init(const char *token, uint32_t max_messages, telegram_on_msg_cb_t on_msg_cb)
-{
-	telegram_ctx_t *teleCtx = NULL;
-
-	if (on_msg_cb == NULL)
+	TELEGRAM_TRACE(TELEGRAM_TRACE_SEND_ENQUEUED, req_id, method);
+	path = telegram_make_method_path(method, teleCtx->token, 0, 0, NULL);
+	if (path == NULL)
 	{
-		return NULL;
-	} 
+		ESP_LOGE(TAG, "No mem!");
+		if (api)
+		{
+			*api = resp;
+		}
+		return false;
+	}
 
-	teleCtx = calloc(1, sizeof(telegram_ctx_t));
-	if (teleCtx != NULL)
+	while (true)
 	{
-		teleCtx->max_messages = max_messages;
-
-		if (teleCtx->max_messages == 0)
+		attempt++;
+		telegram_wait_lane(teleCtx, lane, req_id);
+		if (parts != NULL)
 		{
-			teleCtx->max_messages = TELEGRAM_DEFAULT_MESSAGE_LIMIT;
+			buffer = telegram_io_send_parts(&lane_ctx->io_ctx, path, (telegram_io_header_t *)multipartHeaders, parts, count, 
+				&info);
+		} else
+		{
+			buffer = telegram_io_send_ctx(&lane_ctx->io_ctx, path, payload, (telegram_io_header_t *)jsonHeaders, &info);
 		}
 
-		vSemaphoreCreateBinary(teleCtx->sem);
+		telegram_stats_account(teleCtx, method, &info);
+		telegram_give_lane(teleCtx, lane, req_id);
 
-		teleCtx->token = strdup(token);
-		teleCtx->on_msg_cb = on_msg_cb;
-		teleCtx->getter = telegram_getter_init(telegram_getMessages, teleCtx);
+		if ((telegram_io_classify(&info) == TELEGRAM_IO_OK) || !replayable)
+		{
+			break;
+		}
 
-		if (!teleCtx->getter)
+		telegram_response_parse(buffer, &resp);
+		if (!telegram_retry_next(method, attempt, &info, resp.retry_after, &delay_ms))
 		{
-			ESP_LOGE(TAG, "Failed to init getter");
-			free(teleCtx);
-			return NULL;
-		} 
-	}
+			break;
+		}
 
-	return teleCtx;
-}
+		telegram_free_tag(TELEGRAM_MEM_IO, buffer);
+		buffer = NULL;
+		vTaskDelay(delay_ms / portTICK_PERIOD_MS);
+	}
 
-static void telegram_send_message(void *teleCtx_ptr, telegram_int_t chat_id, const char *message, 
-	telegram_kbrd_t *kbrd)
-{
-	char *path = NULL;
-	char *payload = NULL;
-	telegram_ctx_t *teleCtx = (telegram_ctx_t *)teleCtx_ptr;
-	if (!teleCtx)
+	telegram_free_tag(TELEGRAM_MEM_MAKE, path);
+	if (result)
 	{
-		return;
+		*result = info;
 	}
 
-	telegram_wait_mutex(teleCtx);
+	if ((info.err != 0) || (info.status != 200))
+	{
+		ESP_LOGE(TAG, "Method %d failed: status %d err %d %s", method, info.status, info.err, resp.description);
+		telegram_free_tag(TELEGRAM_MEM_IO, buffer);
+		if (api)
+		{
+			*api = resp;
+		}
+		return false;
+	}
 
-	path = telegram_make_method_path(TELEGRAM_SEND_MESSAGE, teleCtx->token, 0, 0, NULL);
-	if (path == NULL)
+	if (api)
 	{
-		telegram_give_mutex(teleCtx);
-		return;
+		/* 200 is returned only with "ok": true, no need to scan the answer */
+		memset(api, 0, sizeof(telegram_response_t));
+		api->ok = true;
 	}
 
-	payload = telegram_make_message(chat_id, message, kbrd);
-	if (payload == NULL)
+	if (response)
 	{
-		free(path);
-		telegram_give_mutex(teleCtx);
-		return;
+		*response = buffer;
+	} else
+	{
+		telegram_free_tag(TELEGRAM_MEM_IO, buffer);
 	}
 
-	ESP_LOGI(TAG, "Send message: %s %s", path, payload);
-	telegram_io_send(path, payload, (telegram_io_header_t *)jsonHeaders); 
-	free(path);
-	free(payload);
-	telegram_give_mutex(teleCtx);
+	return true;
 }
 
-void telegram_kbrd(void *teleCtx_ptr, telegram_int_t chat_id, const char *message, telegram_kbrd_t *kbrd)
-{	
-	telegram_send_message(teleCtx_ptr, chat_id, message, kbrd);
+static bool telegram_send_request_lane(telegram_ctx_t *teleCtx, telegram_lane_t lane, telegram_method_t method, 
+	const char *payload, char **response, telegram_io_info_t *result, telegram_response_t *api)
+{
+	return telegram_send_request_io(teleCtx, lane, method, payload, NULL, 0, response, result, api);
 }
 
-void telegram_send_text_message(void *teleCtx_ptr, telegram_int_t chat_id, const char *message)
+static bool telegram_send_request_api(telegram_ctx_t *teleCtx, telegram_method_t method, const char *payload, 
+	char **response, telegram_io_info_t *result, telegram_response_t *api)
 {
-	telegram_send_message(teleCtx_ptr, chat_id, message, NULL);
+	return telegram_send_request_lane(teleCtx, (telegram_lane_t)teleCtx->method_lane[method], method, payload, 
+		response, result, api);
 }
 
-void telegram_send_text(void *teleCtx_ptr, telegram_int_t chat_id, telegram_kbrd_t *kbrd, const char *fmt, ...)
+static bool telegram_send_request_resp(telegram_ctx_t *teleCtx, telegram_method_t method, const char *payload, 
+	char **response, telegram_io_info_t *result)
 {
-	char *str;
-	size_t len;
-	va_list ptr;
+	return telegram_send_request_api(teleCtx, method, payload, response, result, NULL);
+}
 
-	va_start(ptr, fmt);
-	len = vsnprintf(NULL, 0, fmt, ptr) + 1;
-	str = malloc(len);
+/** Returns true and fills api if the chat is known to fail permanently */
+static bool telegram_chat_is_dead(telegram_ctx_t *teleCtx, telegram_int_t chat_id, telegram_response_t *api)
+{
+	int32_t error_code = telegram_deadchat_check(teleCtx->dead_chats, chat_id);
 
-	if (str != NULL)
-	{
-		vsprintf(str, fmt, ptr);
-		telegram_send_message(teleCtx_ptr, chat_id, str, kbrd);
-		free(str);
-	} else
+	if (error_code == 0)
 	{
-		ESP_LOGE(TAG, "No mem!");
+		return false;
 	}
 
-	va_end(ptr);
+	ESP_LOGD(TAG, "Chat %.0f is dead, request suppressed", chat_id);
+	memset(api, 0, sizeof(telegram_response_t));
+	api->error_code = error_code;
+	strncpy(api->description, "Suppressed: dead chat", sizeof(api->description) - 1);
+	return true;
 }
 
-char *telegram_get_file_path(void *teleCtx_ptr, const char *file_id)
+/** Request addressed to the chat: fails fast for dead chats and records new permanent failures */
+static bool telegram_send_chat_request(telegram_ctx_t *teleCtx, telegram_lane_t lane, telegram_int_t chat_id, 
+	telegram_method_t method, const char *payload, char **response, telegram_io_info_t *result, telegram_response_t *api)
 {
-	char *buffer = NULL;
-	char *ret = NULL;
-	char *path = NULL;
-	telegram_ctx_t *teleCtx = (telegram_ctx_t *)teleCtx_ptr;
+	bool res;
+	telegram_response_t resp = {0};
 
-	if (teleCtx == NULL)
+	if (telegram_chat_is_dead(teleCtx, chat_id, &resp))
 	{
-		ESP_LOGE(TAG, "Send message: Null argument");
-		return NULL;
+		res = false;
+	} else
+	{
+		res = telegram_send_request_lane(teleCtx, lane, method, payload, response, result, &resp);
+		if (!res && (teleCtx->dead_chats != NULL) && telegram_deadchat_is_permanent(&resp))
+		{
+			telegram_deadchat_add(teleCtx->dead_chats, chat_id, resp.error_code);
+		}
 	}
 
-	telegram_wait_mutex(teleCtx);
-	path = telegram_make_method_path(TELEGRAM_GET_FILE_PATH, teleCtx->token, 0, 0, file_id);
-	if (path == NULL)
+	if (api)
 	{
-		telegram_give_mutex(teleCtx);
-		return NULL;
+		*api = resp;
 	}
 
-    ESP_LOGI(TAG, "Send getFile: %s", path);
-	buffer = telegram_io_get(path, NULL);
-	free(path);
- 	if (buffer != NULL)
- 	{
- 		char *file_path = telegram_parse_file_path(buffer);
- 		free(buffer);
+	return res;
+}
 
- 		if (file_path != NULL)
- 		{
-	 		ret = telegram_make_method_path(TELEGRAM_GET_FILE, teleCtx->token, 0, 0, file_path);
-			free(file_path);
-		}
- 	}
- 	telegram_give_mutex(teleCtx);
-	return ret;
+static bool telegram_send_chat(telegram_ctx_t *teleCtx, telegram_int_t chat_id, telegram_method_t method, 
+	const char *payload, char **response)
+{
+	return telegram_send_chat_request(teleCtx, (telegram_lane_t)teleCtx->method_lane[method], chat_id, method, 
+		payload, response, NULL, NULL);
 }
 
-static uint32_t telegram_send_file_cb(void *ctx, uint8_t *buf, uint32_t max_size, uint32_t offset)
+static bool telegram_send_request(telegram_ctx_t *teleCtx, telegram_method_t method, const char *payload)
 {
-	uint32_t write_size = 0;
-	telegram_send_data_e_t *hnd = (telegram_send_data_e_t *)ctx;
-	telegram_write_data_evt_t evt = {.buf = buf, .pice_size = max_size, .offset = offset };
+	return telegram_send_request_resp(teleCtx, method, payload, NULL, NULL);
+}
 
-	evt.total_size = hnd->total_len;
-	if (max_size > hnd->total_len)
-	{
-		evt.pice_size -= strlen(TELEGRAM_BOUNDARY_FTR);
-	}
+/** 
+ Returns false if the query was already answered. visible - the answer shows text, an alert or opens a URL, 
+ dropping it is reported as a warning: the handler answered a query which was acknowledged automatically
+*/
+static bool telegram_ack_first(telegram_ctx_t *teleCtx, const char *cid, bool visible)
+{
+	bool res;
 
-	write_size = hnd->user_cb(TELEGRAM_READ_DATA, hnd->teleCtx, hnd->user_ctx, &evt);
-	if (write_size > evt.pice_size)
+	portENTER_CRITICAL(&teleCtx->ack_lock);
+	res = telegram_ack_history_add(&teleCtx->acked, cid);
+	portEXIT_CRITICAL(&teleCtx->ack_lock);
+	if (!res && visible)
 	{
-		ESP_LOGE(TAG, "write_size > size_to_send");
-		hnd->user_cb(TELEGRAM_ERR, hnd->teleCtx, hnd->user_ctx, NULL);
-		return 0;
-	}
-
-	hnd->total_len -= write_size;
-	if (evt.pice_size != max_size)
+		ESP_LOGW(TAG, "Answer of %s dropped, the query was already answered. Return false from the ack policy "
+			"to answer it from the handler", cid);
+	} else if (!res)
 	{
-		sprintf((char *)&buf[write_size], "%s", TELEGRAM_BOUNDARY_FTR);
-		write_size += strlen(TELEGRAM_BOUNDARY_FTR);
+		ESP_LOGD(TAG, "Duplicate answer of %s suppressed", cid);
 	}
 
-	return write_size;
+	return res;
 }
 
-static void parse_response_result(void *teleCtx, telegram_update_t *info)
+/** Answer of cid was not sent, the handler may still answer it */
+static void telegram_ack_forget(telegram_ctx_t *teleCtx, const char *cid)
 {
-	telegram_send_data_e_t *hnd = (telegram_send_data_e_t *)teleCtx;
-
-	hnd->user_cb(TELEGRAM_RESPONSE, hnd->teleCtx, hnd->user_ctx, info);
+	portENTER_CRITICAL(&teleCtx->ack_lock);
+	telegram_ack_history_remove(&teleCtx->acked, cid);
+	portEXIT_CRITICAL(&teleCtx->ack_lock);
 }
 
-static bool telegram_io_get_file_cb(void *ctx, uint8_t *buf, int size, int total_len)
+/** Forgets the query of the failed queued answer, its id is the first value of the payload */
+static void telegram_ack_failed(telegram_ctx_t *teleCtx, telegram_method_t method, const char *payload)
 {
-	telegram_write_data_evt_t evt = {.buf = buf, .pice_size = (uint32_t)size, 
-		.total_size = (uint32_t)total_len};
-	telegram_send_data_e_t *hnd = (telegram_send_data_e_t *)ctx;
+	char cid[TELEGRAM_ACK_ID_MAX_LEN + 1];
+	const char *start = NULL;
+	const char *end = NULL;
 
-	if ((size < 0) || (total_len == 0) || (buf == NULL))
+	if ((method != TELEGRAM_ANSWER_QUERY) || (payload == NULL) || ((start = strstr(payload, ": \"")) == NULL))
 	{
-		hnd->user_cb(TELEGRAM_ERR, hnd->teleCtx, hnd->user_ctx, NULL);
-		return false;
+		return;
 	}
 
-	if (0 == hnd->user_cb(TELEGRAM_WRITE_DATA, hnd->teleCtx, hnd->user_ctx, &evt))
+	start += strlen(": \"");
+	end = strchr(start, '"');
+	if ((end == NULL) || ((end - start) > TELEGRAM_ACK_ID_MAX_LEN))
 	{
-		return false;
+		return;
 	}
 
-	return true;
+	memcpy(cid, start, end - start);
+	cid[end - start] = '\0';
+	telegram_ack_forget(teleCtx, cid);
 }
 
-void telegram_send_file_full(void *teleCtx_ptr, telegram_int_t chat_id, char *caption, char *filename, uint32_t total_len,
-	void *ctx, telegram_evt_cb_t cb, telegram_file_type_t file_type)
+static bool telegram_sender_exec(void *owner, telegram_method_t method, telegram_int_t chat_id, 
+	const char *payload, char **response, telegram_io_info_t *info, telegram_response_t *api)
 {
-	const telegram_io_header_t sendHeaders[] = 
-	{
-		{"Content-Type", "multipart/form-data; boundary="TELEGRAM_BOUNDARY_HDR}, 
-		{NULL, NULL}
-	};
+	telegram_ctx_t *teleCtx = (telegram_ctx_t *)owner;
 
-	char *path = NULL;
-	char *overhead = NULL;
-	char *response = NULL;
-	telegram_ctx_t *teleCtx = (telegram_ctx_t *)teleCtx_ptr;
-	telegram_send_data_e_t *ctx_e = NULL;
+	bool res;
 
-	if ((teleCtx_ptr == NULL) || (cb == NULL) || (total_len == 0) || (filename == NULL))
+	if (chat_id != 0)
 	{
-		ESP_LOGE(TAG, "Send file: Wrong argument");
-		return;	
+		return telegram_send_chat_request(teleCtx, (telegram_lane_t)teleCtx->method_lane[method], chat_id, method, 
+			payload, response, info, api);
 	}
 
-	telegram_wait_mutex(teleCtx);
-	switch(file_type)
+	res = telegram_send_request_api(teleCtx, method, payload, response, info, api);
+	if (!res)
 	{
-		case TELEGRAM_PHOTO:
-			path = telegram_make_method_path(TELEGRAM_SEND_PHOTO, teleCtx->token, 0, 0, NULL);
-			break;
+		telegram_ack_failed(teleCtx, method, payload);
+	}
 
-		default:
-			path = telegram_make_method_path(TELEGRAM_SEND_FILE, teleCtx->token, 0, 0, NULL);
-			break;
+	return res;
+}
+
+static bool telegram_ack_exec(void *owner, telegram_method_t method, telegram_int_t chat_id, 
+	const char *payload, char **response, telegram_io_info_t *info, telegram_response_t *api)
+{
+	bool res = telegram_send_request_lane((telegram_ctx_t *)owner, TELEGRAM_LANE_INTERACTIVE, method, payload, 
+		response, info, api);
+
+	if (!res)
+	{
+		telegram_ack_failed((telegram_ctx_t *)owner, method, payload);
 	}
 
-	if (path == NULL)
+	return res;
+}
+
+static void telegram_auto_ack(telegram_ctx_t *teleCtx, telegram_update_t *upd)
+{
+	telegram_ack_t ack = {0};
+	telegram_chat_callback_t *query = upd->callback_query;
+
+	if ((teleCtx->ack_sender == NULL) || (query == NULL) || (query->id == NULL))
 	{
-		ESP_LOGE(TAG, "No mem (1)!");
-		telegram_give_mutex(teleCtx);
 		return;
 	}
 
-	overhead = calloc(sizeof(char), ((caption!=NULL)?strlen(caption):0) + strlen(filename) + TELEGRAM_INT_MAX_VAL_LENGTH 
-		+ 3 * strlen(TELEGRAM_BOUNDARY_CONTENT_FMT) + 2 * strlen(TELEGRAM_BOUNDARY"\r\n") + strlen(TELEGRAM_BOUNDARY_FTR));
-	if (overhead == NULL)
+	if ((teleCtx->ack_policy != NULL) && !teleCtx->ack_policy(teleCtx, query, &ack, teleCtx->ack_policy_ctx))
 	{
-		ESP_LOGE(TAG, "No mem (2)!");
-		free(path);
-		telegram_give_mutex(teleCtx);
 		return;
 	}
 
-	sprintf(overhead, TELEGRAM_BOUNDARY_CONTENT_FMT"\"chat_id\"\r\n\r\n%.0f\r\n", chat_id);
-	if (caption)
+	if (!telegram_ack_first(teleCtx, query->id, false))
+	{
+		return;
+	}
+
+	if (!telegram_sender_push(teleCtx->ack_sender, TELEGRAM_ANSWER_QUERY, 0, 
+		telegram_make_answer_query(query->id, ack.text, ack.show_alert, ack.url, ack.cache_time), NULL, NULL))
+	{
+		ESP_LOGW(TAG, "Ack queue is full");
+		telegram_ack_forget(teleCtx, query->id);
+	}
+}
+
+static char *telegram_webhook_on_update(void *ctx, const char *buffer)
+{
+	char *reply = NULL;
+	telegram_ctx_t *teleCtx = (telegram_ctx_t *)ctx;
+
+	teleCtx->inline_reply = NULL;
+	teleCtx->reply_task = xTaskGetCurrentTaskHandle();
+	telegram_dispatch(teleCtx, buffer, TELEGRAM_TRACE_NEW_ID(), true);
+	teleCtx->reply_task = NULL;
+
+	reply = teleCtx->inline_reply;
+	teleCtx->inline_reply = NULL;
+	return reply;
+}
+
+static void telegram_lane_free(telegram_lane_ctx_t *lane)
+{
+	uint32_t i;
+
+	telegram_io_free_ctx(&lane->io_ctx);
+	for (i = 0; i < TELEGRAM_LANE_COUNT; i++)
+	{
+		if (lane->wake[i])
+		{
+			vSemaphoreDelete(lane->wake[i]);
+			lane->wake[i] = NULL;
+		}
+	}
+}
+
+static bool telegram_lane_init(telegram_lane_ctx_t *lane)
+{
+	uint32_t i;
+
+	lane->lock = (portMUX_TYPE)portMUX_INITIALIZER_UNLOCKED;
+	for (i = 0; i < TELEGRAM_LANE_COUNT; i++)
+	{
+		lane->wake[i] = xSemaphoreCreateBinary();
+		if (lane->wake[i] == NULL)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static void telegram_shared_free(telegram_shared_t *shared)
+{
+	uint32_t i;
+
+	telegram_lane_free(&shared->poll);
+#if TELEGRAM_LANES_ENABLE == 1
+	for (i = 0; i < TELEGRAM_LANE_COUNT; i++)
+	{
+		telegram_lane_free(&shared->lanes[i]);
+	}
+#else
+	(void)i;
+#endif
+}
+
+static bool telegram_shared_init(telegram_shared_t *shared)
+{
+	uint32_t i;
+	bool res = telegram_lane_init(&shared->poll);
+
+	shared->stats_lock = (portMUX_TYPE)portMUX_INITIALIZER_UNLOCKED;
+#if TELEGRAM_LANES_ENABLE == 1
+	for (i = 0; i < TELEGRAM_LANE_COUNT; i++)
+	{
+		res = res && telegram_lane_init(&shared->lanes[i]);
+	}
+#else
+	(void)i;
+#endif
+	return res;
+}
+
+static void telegram_ctx_free(telegram_ctx_t *teleCtx)
+{
+	telegram_coalesce_stop(teleCtx->coalesce);
+	telegram_sender_stop(teleCtx->sender);
+	telegram_sender_stop(teleCtx->ack_sender);
+	if ((teleCtx->mux == NULL) && (teleCtx->shared != NULL))
+	{
+		telegram_shared_free(teleCtx->shared);
+		telegram_free_tag(TELEGRAM_MEM_CORE, teleCtx->shared);
+	}
+
+	telegram_cache_free(teleCtx->file_cache);
+	telegram_session_free(teleCtx->sessions);
+	if (teleCtx->sessions_lock != NULL)
+	{
+		vSemaphoreDelete(teleCtx->sessions_lock);
+	}
+
+	telegram_deadchat_free(teleCtx->dead_chats);
+	telegram_free_tag(TELEGRAM_MEM_CORE, teleCtx->token);
+	telegram_free_tag(TELEGRAM_MEM_CORE, teleCtx);
+}
+
+static telegram_ctx_t *telegram_ctx_create(const char *token, uint32_t max_messages, telegram_on_msg_cb_t on_msg_cb,
+	telegram_mux_t *mux)
+{
+	telegram_ctx_t *teleCtx = NULL;
+	uint32_t i;
+
+	if ((on_msg_cb == NULL) || (token == NULL))
+	{
+		return NULL;
+	} 
+
+	telegram_mem_init();
+	teleCtx = telegram_calloc(TELEGRAM_MEM_CORE, 1, sizeof(telegram_ctx_t));
+	if (teleCtx == NULL)
+	{
+		return NULL;
+	}
+
+	teleCtx->max_messages = max_messages;
+	if (teleCtx->max_messages == 0)
+	{
+		teleCtx->max_messages = TELEGRAM_DEFAULT_MESSAGE_LIMIT;
+	}
+
+	teleCtx->ack_lock = (portMUX_TYPE)portMUX_INITIALIZER_UNLOCKED;
+	for (i = 0; i < TELEGRAM_METHOD_COUNT; i++)
+	{
+		teleCtx->method_lane[i] = (uint8_t)telegram_lane_default((telegram_method_t)i);
+	}
+
+	teleCtx->mux = mux;
+	if (mux != NULL)
+	{
+		teleCtx->shared = &mux->shared;
+	} else
+	{
+		teleCtx->shared = telegram_calloc(TELEGRAM_MEM_CORE, 1, sizeof(telegram_shared_t));
+		if ((teleCtx->shared == NULL) || !telegram_shared_init(teleCtx->shared))
+		{
+			ESP_LOGE(TAG, "No mem!");
+			telegram_ctx_free(teleCtx);
+			return NULL;
+		}
+	}
+
+	teleCtx->token = telegram_strdup(TELEGRAM_MEM_CORE, token);
+	teleCtx->on_msg_cb = on_msg_cb;
+	teleCtx->sessions_lock = xSemaphoreCreateRecursiveMutex();
+	if ((teleCtx->token == NULL) || (teleCtx->sessions_lock == NULL))
+	{
+		ESP_LOGE(TAG, "No mem!");
+		telegram_ctx_free(teleCtx);
+		return NULL;
+	}
+
+	return teleCtx;
+}
+
+void telegram_stop(void *teleCtx_ptr)
+{
+	bool free_now;
+	telegram_ctx_t **bot = NULL;
+	telegram_ctx_t *teleCtx = (telegram_ctx_t *)teleCtx_ptr;
+
+	if (teleCtx_ptr == NULL)
+	{
+		return;
+	}
+
+	if (teleCtx->mux != NULL)
+	{
+		xSemaphoreTake(teleCtx->mux->list_lock, portMAX_DELAY);
+		for (bot = &teleCtx->mux->bots; *bot != NULL; bot = &(*bot)->next)
+		{
+			if (*bot == teleCtx)
+			{
+				*bot = teleCtx->next;
+				break;
+			}
+		}
+		xSemaphoreGive(teleCtx->mux->list_lock);
+	}
+
+	telegram_getter_stop(teleCtx->getter);
+	if (teleCtx->webhook)
+	{
+		telegram_webhook_stop(teleCtx->webhook);
+		if (!telegram_send_request(teleCtx, TELEGRAM_DELETE_WEBHOOK, "{}"))
+		{
+			ESP_LOGW(TAG, "deleteWebhook failed");
+		}
+	}
+
+	if (teleCtx->mux != NULL)
+	{
+		/* May be called from the message callback of the bot, the poller frees it then */
+		xSemaphoreTake(teleCtx->mux->list_lock, portMAX_DELAY);
+		teleCtx->removed = true;
+		free_now = (teleCtx->refs == 0);
+		xSemaphoreGive(teleCtx->mux->list_lock);
+		if (!free_now)
+		{
+			return;
+		}
+	}
+
+	telegram_ctx_free(teleCtx);
+}
+
+void *telegram_init(const char *token, uint32_t max_messages, telegram_on_msg_cb_t on_msg_cb)
+{
+	telegram_ctx_t *teleCtx = telegram_ctx_create(token, max_messages, on_msg_cb, NULL);
+
+	if (teleCtx != NULL)
+	{
+		teleCtx->getter = telegram_getter_init(telegram_getMessages, teleCtx);
+
+		if (!teleCtx->getter)
+		{
+			ESP_LOGE(TAG, "Failed to init getter");
+			telegram_ctx_free(teleCtx);
+			return NULL;
+		} 
+	}
+
+	return teleCtx;
+}
+
+/**
+ The list lock is not held while a bot is polled, so handlers may add and stop bots.
+ Bots are taken by position, a bot added or removed meanwhile may be skipped or polled twice in this round.
+*/
+static void telegram_mux_poll(void *ctx)
+{
+	telegram_ctx_t *bot = NULL;
+	telegram_mux_t *mux = (telegram_mux_t *)ctx;
+	uint32_t pos = 0;
+	uint32_t i;
+	bool release;
+
+	while (true)
+	{
+		xSemaphoreTake(mux->list_lock, portMAX_DELAY);
+		for (i = 0, bot = mux->bots; (bot != NULL) && (i < pos); i++)
+		{
+			bot = bot->next;
+		}
+
+		if (bot != NULL)
+		{
+			bot->refs++;
+		}
+		xSemaphoreGive(mux->list_lock);
+
+		if (bot == NULL)
+		{
+			break;
+		}
+
+		telegram_getMessages(bot);
+
+		xSemaphoreTake(mux->list_lock, portMAX_DELAY);
+		bot->refs--;
+		release = bot->removed && (bot->refs == 0);
+		xSemaphoreGive(mux->list_lock);
+		if (release)
+		{
+			telegram_ctx_free(bot);
+		} else
+		{
+			pos++;
+		}
+	}
+}
+
+void *telegram_mux_init(void)
+{
+	telegram_mux_t *mux = NULL;
+
+	telegram_mem_init();
+	mux = telegram_calloc(TELEGRAM_MEM_CORE, 1, sizeof(telegram_mux_t));
+	if (mux == NULL)
+	{
+		return NULL;
+	}
+
+	mux->list_lock = xSemaphoreCreateMutex();
+	if ((mux->list_lock == NULL) || !telegram_shared_init(&mux->shared))
+	{
+		ESP_LOGE(TAG, "No mem!");
+		telegram_mux_stop(mux);
+		return NULL;
+	}
+
+	mux->getter = telegram_getter_init(telegram_mux_poll, mux);
+	if (!mux->getter)
+	{
+		ESP_LOGE(TAG, "Failed to init getter");
+		telegram_mux_stop(mux);
+		return NULL;
+	}
+
+	return mux;
+}
+
+void *telegram_mux_add(void *mux_ptr, const char *token, uint32_t max_messages, telegram_on_msg_cb_t on_msg_cb)
+{
+	telegram_mux_t *mux = (telegram_mux_t *)mux_ptr;
+	telegram_ctx_t *teleCtx = NULL;
+
+	if (mux_ptr == NULL)
+	{
+		return NULL;
+	}
+
+	teleCtx = telegram_ctx_create(token, max_messages, on_msg_cb, mux);
+	if (teleCtx != NULL)
+	{
+		xSemaphoreTake(mux->list_lock, portMAX_DELAY);
+		teleCtx->next = mux->bots;
+		mux->bots = teleCtx;
+		xSemaphoreGive(mux->list_lock);
+	}
+
+	return teleCtx;
+}
+
+void telegram_mux_stop(void *mux_ptr)
+{
+	telegram_ctx_t *bot = NULL;
+	telegram_mux_t *mux = (telegram_mux_t *)mux_ptr;
+
+	if (mux_ptr == NULL)
+	{
+		return;
+	}
+
+	telegram_getter_stop(mux->getter);
+	while (mux->bots != NULL)
+	{
+		bot = mux->bots;
+		mux->bots = bot->next;
+		telegram_ctx_free(bot);
+	}
+
+	telegram_shared_free(&mux->shared);
+	if (mux->list_lock)
+	{
+		vSemaphoreDelete(mux->list_lock);
+	}
+	telegram_free_tag(TELEGRAM_MEM_CORE, mux);
+}
+
+void *telegram_init_webhook(const char *token, const telegram_webhook_cfg_t *cfg, telegram_on_msg_cb_t on_msg_cb)
+{
+	char *payload = NULL;
+	telegram_ctx_t *teleCtx = NULL;
+
+	if ((cfg == NULL) || (cfg->url == NULL))
+	{
+		ESP_LOGE(TAG, "Webhook url is required");
+		return NULL;
+	}
+
+	teleCtx = telegram_ctx_create(token, 0, on_msg_cb, NULL);
+	if (teleCtx == NULL)
+	{
+		return NULL;
+	}
+
+	teleCtx->webhook = telegram_webhook_init(cfg, telegram_webhook_on_update, teleCtx);
+	if (!teleCtx->webhook)
+	{
+		ESP_LOGE(TAG, "Failed to init webhook");
+		telegram_ctx_free(teleCtx);
+		return NULL;
+	}
+
+	payload = telegram_make_webhook(cfg->url, cfg->max_connections, cfg->secret_token);
+	if ((payload == NULL) || !telegram_send_request(teleCtx, TELEGRAM_SET_WEBHOOK, payload))
+	{
+		ESP_LOGE(TAG, "setWebhook failed");
+		telegram_free_tag(TELEGRAM_MEM_MAKE, payload);
+		telegram_webhook_stop(teleCtx->webhook);
+		telegram_ctx_free(teleCtx);
+		return NULL;
+	}
+
+	telegram_free_tag(TELEGRAM_MEM_MAKE, payload);
+	return teleCtx;
+}
+
+static void telegram_send_message_now(void *teleCtx_ptr, telegram_int_t chat_id, const char *message, 
+	telegram_kbrd_t *kbrd)
+{
+	char *payload = NULL;
+	telegram_ctx_t *teleCtx = (telegram_ctx_t *)teleCtx_ptr;
+	if (!teleCtx)
+	{
+		return;
+	}
+
+	payload = telegram_make_message(chat_id, message, kbrd);
+	if (payload == NULL)
+	{
+		ESP_LOGE(TAG, "No mem!");
+		return;
+	}
+
+	ESP_LOGD(TAG, "Send message: %s", payload);
+	telegram_send_chat(teleCtx, chat_id, TELEGRAM_SEND_MESSAGE, payload, NULL);
+	telegram_free_tag(TELEGRAM_MEM_MAKE, payload);
+}
+
+static void telegram_coalesce_flush_cb(void *ctx, telegram_int_t chat_id, const char *text)
+{
+	telegram_send_message_now(ctx, chat_id, text, NULL);
+}
+
+static void telegram_send_message(void *teleCtx_ptr, telegram_int_t chat_id, const char *message, 
+	telegram_kbrd_t *kbrd)
+{
+	telegram_ctx_t *teleCtx = (telegram_ctx_t *)teleCtx_ptr;
+	if (!teleCtx)
+	{
+		return;
+	}
+
+	if (teleCtx->coalesce != NULL)
+	{
+		if ((kbrd == NULL) && telegram_coalesce_push(teleCtx->coalesce, chat_id, message))
+		{
+			return;
+		}
+
+		/* Keep order: pending texts go before the message that can not be merged */
+		telegram_coalesce_flush(teleCtx->coalesce);
+	}
+
+	telegram_send_message_now(teleCtx_ptr, chat_id, message, kbrd);
+}
+
+void telegram_set_coalescing(void *teleCtx_ptr, uint32_t window_ms)
+{
+	telegram_ctx_t *teleCtx = (telegram_ctx_t *)teleCtx_ptr;
+	if (!teleCtx)
+	{
+		return;
+	}
+
+	telegram_coalesce_stop(teleCtx->coalesce);
+	teleCtx->coalesce = NULL;
+	if (window_ms != 0)
+	{
+		teleCtx->coalesce = telegram_coalesce_init(window_ms, telegram_coalesce_flush_cb, teleCtx);
+		if (teleCtx->coalesce == NULL)
+		{
+			ESP_LOGE(TAG, "Failed to init coalescing");
+		}
+	}
+}
+
+bool telegram_set_dead_chats(void *teleCtx_ptr, uint32_t capacity, uint32_t ttl_sec)
+{
+	telegram_ctx_t *teleCtx = (telegram_ctx_t *)teleCtx_ptr;
+	if (!teleCtx)
+	{
+		return false;
+	}
+
+	telegram_deadchat_free(teleCtx->dead_chats);
+	teleCtx->dead_chats = NULL;
+	if (capacity != 0)
+	{
+		teleCtx->dead_chats = telegram_deadchat_init(capacity, (ttl_sec != 0) ? ttl_sec : TELEGRAM_DEADCHAT_TTL_SEC);
+		if (teleCtx->dead_chats == NULL)
+		{
+			ESP_LOGE(TAG, "Failed to init dead chats");
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void telegram_clear_dead_chat(void *teleCtx_ptr, telegram_int_t chat_id)
+{
+	telegram_ctx_t *teleCtx = (telegram_ctx_t *)teleCtx_ptr;
+	if (!teleCtx)
+	{
+		return;
+	}
+
+	if (chat_id == 0)
+	{
+		telegram_deadchat_clear(teleCtx->dead_chats);
+	} else
+	{
+		telegram_deadchat_remove(teleCtx->dead_chats, chat_id);
+	}
+}
+
+void telegram_get_dead_chat_stats(void *teleCtx_ptr, telegram_deadchat_stats_t *stats)
+{
+	telegram_ctx_t *teleCtx = (telegram_ctx_t *)teleCtx_ptr;
+
+	if ((teleCtx_ptr == NULL) || (stats == NULL))
+	{
+		ESP_LOGE(TAG, "NULL argument");
+		return;
+	}
+
+	telegram_deadchat_get_stats(teleCtx->dead_chats, stats);
+}
+
+bool telegram_set_sessions(void *teleCtx_ptr, const telegram_session_cfg_t *cfg)
+{
+	void *sessions = NULL;
+	telegram_ctx_t *teleCtx = (telegram_ctx_t *)teleCtx_ptr;
+	if (!teleCtx)
+	{
+		return false;
+	}
+
+	if (cfg != NULL)
+	{
+		sessions = telegram_session_init(cfg);
+		if (sessions == NULL)
+		{
+			ESP_LOGE(TAG, "Failed to init sessions");
+		}
+	}
+
+	/* The poll task expires the store after each batch, it is swapped between batches */
+	xSemaphoreTakeRecursive(teleCtx->sessions_lock, portMAX_DELAY);
+	telegram_session_free(teleCtx->sessions);
+	teleCtx->sessions = sessions;
+	xSemaphoreGiveRecursive(teleCtx->sessions_lock);
+
+	return ((cfg == NULL) || (sessions != NULL));
+}
+
+void *telegram_get_session_store(void *teleCtx_ptr)
+{
+	telegram_ctx_t *teleCtx = (telegram_ctx_t *)teleCtx_ptr;
+
+	return (teleCtx != NULL) ? teleCtx->sessions : NULL;
+}
+
+void *telegram_get_session(void *teleCtx_ptr, telegram_update_t *upd)
+{
+	telegram_int_t id;
+	telegram_ctx_t *teleCtx = (telegram_ctx_t *)teleCtx_ptr;
+
+	if ((teleCtx == NULL) || (upd == NULL))
+	{
+		return NULL;
+	}
+
+	id = telegram_get_user_id_update(upd);
+	if (id == -1)
+	{
+		id = telegram_get_chat_id(telegram_get_message(upd));
+	}
+
+	if (id == -1)
+	{
+		return NULL;
+	}
+
+	return telegram_session_get(teleCtx->sessions, (int64_t)id, true);
+}
+
+telegram_int_t telegram_send_message_get_id(void *teleCtx_ptr, telegram_int_t chat_id, const char *message, 
+	telegram_kbrd_t *kbrd)
+{
+	char *payload = NULL;
+	char *response = NULL;
+	telegram_int_t message_id = -1;
+	telegram_ctx_t *teleCtx = (telegram_ctx_t *)teleCtx_ptr;
+	if (!teleCtx)
+	{
+		return -1;
+	}
+
+	telegram_coalesce_flush(teleCtx->coalesce);
+	payload = telegram_make_message(chat_id, message, kbrd);
+	if (payload == NULL)
+	{
+		ESP_LOGE(TAG, "No mem!");
+		return -1;
+	}
+
+	if (telegram_send_chat(teleCtx, chat_id, TELEGRAM_SEND_MESSAGE, payload, &response))
+	{
+		message_id = telegram_parse_message_id(response);
+		telegram_free_tag(TELEGRAM_MEM_IO, response);
+	}
+
+	telegram_free_tag(TELEGRAM_MEM_MAKE, payload);
+	return message_id;
+}
+
+bool telegram_send_message_lane(void *teleCtx_ptr, telegram_int_t chat_id, const char *message, 
+	telegram_kbrd_t *kbrd, telegram_lane_t lane)
+{
+	char *payload = NULL;
+	bool res;
+	telegram_ctx_t *teleCtx = (telegram_ctx_t *)teleCtx_ptr;
+	if (!teleCtx || (lane >= TELEGRAM_LANE_COUNT))
+	{
+		return false;
+	}
+
+	payload = telegram_make_message(chat_id, message, kbrd);
+	if (payload == NULL)
+	{
+		ESP_LOGE(TAG, "No mem!");
+		return false;
+	}
+
+	res = telegram_send_chat_request(teleCtx, lane, chat_id, TELEGRAM_SEND_MESSAGE, payload, NULL, NULL, NULL);
+	telegram_free_tag(TELEGRAM_MEM_MAKE, payload);
+	return res;
+}
+
+bool telegram_edit_message(void *teleCtx_ptr, telegram_int_t chat_id, telegram_int_t message_id, 
+	const char *message, telegram_kbrd_t *kbrd)
+{
+	bool res = false;
+	char *payload = NULL;
+	telegram_ctx_t *teleCtx = (telegram_ctx_t *)teleCtx_ptr;
+	if (!teleCtx)
+	{
+		return false;
+	}
+
+	payload = telegram_make_edit_message(chat_id, message_id, message, kbrd);
+	if (payload == NULL)
+	{
+		ESP_LOGE(TAG, "No mem!");
+		return false;
+	}
+
+	res = telegram_send_chat(teleCtx, chat_id, (message != NULL)?TELEGRAM_EDIT_MESSAGE_TEXT:TELEGRAM_EDIT_MESSAGE_MARKUP, 
+		payload, NULL);
+	telegram_free_tag(TELEGRAM_MEM_MAKE, payload);
+	return res;
+}
+
+bool telegram_start_async(void *teleCtx_ptr, uint32_t queue_len)
+{
+	telegram_ctx_t *teleCtx = (telegram_ctx_t *)teleCtx_ptr;
+	if (!teleCtx)
+	{
+		return false;
+	}
+
+	if (teleCtx->sender == NULL)
+	{
+		teleCtx->sender = telegram_sender_init(queue_len, telegram_sender_exec, teleCtx);
+	}
+
+	return (teleCtx->sender != NULL);
+}
+
+static bool telegram_push_async(telegram_ctx_t *teleCtx, telegram_method_t method, telegram_int_t chat_id, 
+	char *payload, telegram_send_done_cb_t cb, void *ctx)
+{
+	if (payload == NULL)
+	{
+		ESP_LOGE(TAG, "No mem!");
+		return false;
+	}
+
+	if (teleCtx->sender == NULL)
+	{
+		ESP_LOGE(TAG, "Async sender is not started");
+		telegram_free_tag(TELEGRAM_MEM_MAKE, payload);
+		return false;
+	}
+
+	return telegram_sender_push(teleCtx->sender, method, chat_id, payload, cb, ctx);
+}
+
+bool telegram_send_message_async(void *teleCtx_ptr, telegram_int_t chat_id, const char *message, 
+	telegram_kbrd_t *kbrd, telegram_send_done_cb_t cb, void *ctx)
+{
+	telegram_ctx_t *teleCtx = (telegram_ctx_t *)teleCtx_ptr;
+	if (!teleCtx)
+	{
+		return false;
+	}
+
+	return telegram_push_async(teleCtx, TELEGRAM_SEND_MESSAGE, chat_id, telegram_make_message(chat_id, message, kbrd), 
+		cb, ctx);
+}
+
+bool telegram_edit_message_async(void *teleCtx_ptr, telegram_int_t chat_id, telegram_int_t message_id, 
+	const char *message, telegram_kbrd_t *kbrd, telegram_send_done_cb_t cb, void *ctx)
+{
+	telegram_ctx_t *teleCtx = (telegram_ctx_t *)teleCtx_ptr;
+	if (!teleCtx)
+	{
+		return false;
+	}
+
+	return telegram_push_async(teleCtx, (message != NULL)?TELEGRAM_EDIT_MESSAGE_TEXT:TELEGRAM_EDIT_MESSAGE_MARKUP, 
+		chat_id, telegram_make_edit_message(chat_id, message_id, message, kbrd), cb, ctx);
+}
+
+bool telegram_request_async(void *teleCtx_ptr, telegram_method_t method, telegram_int_t chat_id, char *payload, 
+	telegram_send_done_cb_t cb, void *ctx)
+{
+	telegram_ctx_t *teleCtx = (telegram_ctx_t *)teleCtx_ptr;
+	if (!teleCtx)
+	{
+		telegram_free_tag(TELEGRAM_MEM_MAKE, payload);
+		return false;
+	}
+
+	return telegram_push_async(teleCtx, method, chat_id, payload, cb, ctx);
+}
+
+bool telegram_answer_cb_query_async(void *teleCtx_ptr, const char *cid, const char *text, 
+	bool show_alert, const char *url, telegram_int_t cache_time, telegram_send_done_cb_t cb, void *ctx)
+{
+	telegram_ctx_t *teleCtx = (telegram_ctx_t *)teleCtx_ptr;
+	if ((teleCtx == NULL) || (cid == NULL))
+	{
+		return false;
+	}
+
+	if (!telegram_ack_first(teleCtx, cid, (text != NULL) || show_alert || (url != NULL)))
+	{
+		return true;
+	}
+
+	if (!telegram_push_async(teleCtx, TELEGRAM_ANSWER_QUERY, 0, 
+		telegram_make_answer_query(cid, text, show_alert, url, cache_time), cb, ctx))
+	{
+		telegram_ack_forget(teleCtx, cid);
+		return false;
+	}
+
+	return true;
+}
+
+void telegram_kbrd(void *teleCtx_ptr, telegram_int_t chat_id, const char *message, telegram_kbrd_t *kbrd)
+{	
+	telegram_send_message(teleCtx_ptr, chat_id, message, kbrd);
+}
+
+void telegram_send_text_message(void *teleCtx_ptr, telegram_int_t chat_id, const char *message)
+{
+	telegram_send_message(teleCtx_ptr, chat_id, message, NULL);
+}
+
+void telegram_send_text(void *teleCtx_ptr, telegram_int_t chat_id, telegram_kbrd_t *kbrd, const char *fmt, ...)
+{
+	char *str;
+	size_t len;
+	va_list ptr;
+
+	va_start(ptr, fmt);
+	len = vsnprintf(NULL, 0, fmt, ptr) + 1;
+	str = telegram_malloc(TELEGRAM_MEM_CORE, len);
+
+	if (str != NULL)
+	{
+		vsprintf(str, fmt, ptr);
+		telegram_send_message(teleCtx_ptr, chat_id, str, kbrd);
+		telegram_free_tag(TELEGRAM_MEM_CORE, str);
+	} else
+	{
+		ESP_LOGE(TAG, "No mem!");
+	}
+
+	va_end(ptr);
+}
+
+char *telegram_get_file_path(void *teleCtx_ptr, const char *file_id)
+{
+	char *buffer = NULL;
+	char *ret = NULL;
+	char *path = NULL;
+	uint32_t req_id = TELEGRAM_TRACE_NEW_ID();
+	telegram_io_info_t info = {.req_id = req_id};
+	telegram_ctx_t *teleCtx = (telegram_ctx_t *)teleCtx_ptr;
+
+	if (teleCtx == NULL)
+	{
+		ESP_LOGE(TAG, "Send message: Null argument");
+		return NULL;
+	}
+
+	telegram_wait_lane(teleCtx, TELEGRAM_LANE_NORMAL, req_id);
+	if (teleCtx->file_cache == NULL)
+	{
+		teleCtx->file_cache = telegram_cache_init(TELEGRAM_FILE_CACHE_SIZE, TELEGRAM_FILE_CACHE_TTL_SEC);
+	}
+
+	ret = telegram_cache_get(teleCtx->file_cache, file_id);
+	if (ret != NULL)
+	{
+		telegram_give_lane(teleCtx, TELEGRAM_LANE_NORMAL, req_id);
+		return ret;
+	}
+
+	path = telegram_make_method_path(TELEGRAM_GET_FILE_PATH, teleCtx->token, 0, 0, file_id);
+	if (path == NULL)
+	{
+		telegram_give_lane(teleCtx, TELEGRAM_LANE_NORMAL, req_id);
+		return NULL;
+	}
+
+    ESP_LOGD(TAG, "Send getFile: %s", path);
+	buffer = telegram_io_get(path, NULL, &info);
+	telegram_free_tag(TELEGRAM_MEM_MAKE, path);
+	telegram_stats_account(teleCtx, TELEGRAM_GET_FILE_PATH, &info);
+ 	if (buffer != NULL)
+ 	{
+ 		char *file_path = telegram_parse_file_path(buffer);
+ 		telegram_free_tag(TELEGRAM_MEM_IO, buffer);
+
+ 		if (file_path != NULL)
+ 		{
+	 		ret = telegram_make_method_path(TELEGRAM_GET_FILE, teleCtx->token, 0, 0, file_path);
+			telegram_cache_put(teleCtx->file_cache, file_id, ret);
+			telegram_free_tag(TELEGRAM_MEM_PARSE, file_path);
+		}
+ 	}
+ 	telegram_give_lane(teleCtx, TELEGRAM_LANE_NORMAL, req_id);
+	return ret;
+}
+
+static uint32_t telegram_send_file_cb(void *ctx, uint8_t *buf, uint32_t max_size, uint32_t offset)
+{
+	uint32_t write_size = 0;
+	telegram_send_data_e_t *hnd = (telegram_send_data_e_t *)ctx;
+	telegram_write_data_evt_t evt = {.buf = buf, .pice_size = max_size, .offset = offset };
+
+	evt.total_size = hnd->total_len;
+	if (max_size > hnd->total_len)
+	{
+		evt.pice_size -= strlen(TELEGRAM_BOUNDARY_FTR);
+	}
+
+	write_size = hnd->user_cb(TELEGRAM_READ_DATA, hnd->teleCtx, hnd->user_ctx, &evt);
+	if (write_size > evt.pice_size)
+	{
+		ESP_LOGE(TAG, "write_size > size_to_send");
+		hnd->user_cb(TELEGRAM_ERR, hnd->teleCtx, hnd->user_ctx, NULL);
+		return 0;
+	}
+
+	hnd->total_len -= write_size;
+	if (evt.pice_size != max_size)
+	{
+		sprintf((char *)&buf[write_size], "%s", TELEGRAM_BOUNDARY_FTR);
+		write_size += strlen(TELEGRAM_BOUNDARY_FTR);
+	}
+
+	return write_size;
+}
+
+static void parse_response_result(void *teleCtx, telegram_update_t *info)
+{
+	telegram_send_data_e_t *hnd = (telegram_send_data_e_t *)teleCtx;
+
+	hnd->user_cb(TELEGRAM_RESPONSE, hnd->teleCtx, hnd->user_ctx, info);
+}
+
+static bool telegram_io_get_file_cb(void *ctx, uint8_t *buf, int size, uint32_t offset, int total_len)
+{
+	telegram_write_data_evt_t evt = {.buf = buf, .pice_size = (uint32_t)size, 
+		.total_size = (uint32_t)total_len, .offset = offset};
+	telegram_send_data_e_t *hnd = (telegram_send_data_e_t *)ctx;
+
+	/* total_len is 0 if the server did not send the length */
+	if ((size < 0) || (buf == NULL))
+	{
+		evt.pice_size = 0;
+		hnd->user_cb(TELEGRAM_ERR, hnd->teleCtx, hnd->user_ctx, &evt);
+		return false;
+	}
+
+	if (0 == hnd->user_cb(TELEGRAM_WRITE_DATA, hnd->teleCtx, hnd->user_ctx, &evt))
+	{
+		return false;
+	}
+
+	return true;
+}
+
+static char *telegram_make_file_preamble(telegram_int_t chat_id, const char *caption, const char *filename, 
+	telegram_file_type_t file_type)
+{
+	char *overhead = NULL;
+
+	overhead = telegram_calloc(TELEGRAM_MEM_CORE, sizeof(char), ((caption!=NULL)?strlen(caption):0) + strlen(filename) + TELEGRAM_INT_MAX_VAL_LENGTH 
+		+ 3 * strlen(TELEGRAM_BOUNDARY_CONTENT_FMT) + 2 * strlen(TELEGRAM_BOUNDARY"\r\n") + strlen(TELEGRAM_BOUNDARY_FTR));
+	if (overhead == NULL)
+	{
+		return NULL;
+	}
+
+	sprintf(overhead, TELEGRAM_BOUNDARY_CONTENT_FMT"\"chat_id\"\r\n\r\n%.0f\r\n", chat_id);
+	if (caption)
 	{
 		sprintf(&overhead[strlen(overhead)], TELEGRAM_BOUNDARY_CONTENT_FMT"\"caption\"\r\n\r\n%s\r\n", caption);
 	}
@@ -407,25 +1571,73 @@ void telegram_send_file_full(void *teleCtx_ptr, telegram_int_t chat_id, char *ca
 
 	switch(file_type)
 	{
-		case TELEGRAM_PHOTO: 
-			sprintf(&overhead[strlen(overhead)], TELEGRAM_BOUNDARY_CONTENT_FMT"\"photo\"");
+		case TELEGRAM_PHOTO: 
+			sprintf(&overhead[strlen(overhead)], TELEGRAM_BOUNDARY_CONTENT_FMT"\"photo\"");
+			break;
+
+		default:
+			sprintf(&overhead[strlen(overhead)], TELEGRAM_BOUNDARY_CONTENT_FMT"\"document\"");
+			break;
+	}
+
+	sprintf(&overhead[strlen(overhead)], "; filename=\"%s\"\r\nContent-Type: application/octet-stream\r\n\r\n", filename);
+	return overhead;
+}
+
+void telegram_send_file_full(void *teleCtx_ptr, telegram_int_t chat_id, char *caption, char *filename, uint32_t total_len,
+	void *ctx, telegram_evt_cb_t cb, telegram_file_type_t file_type)
+{
+	char *path = NULL;
+	char *overhead = NULL;
+	char *response = NULL;
+	uint32_t req_id = TELEGRAM_TRACE_NEW_ID();
+	telegram_io_info_t info = {.req_id = req_id};
+	telegram_ctx_t *teleCtx = (telegram_ctx_t *)teleCtx_ptr;
+	telegram_send_data_e_t *ctx_e = NULL;
+
+	if ((teleCtx_ptr == NULL) || (cb == NULL) || (total_len == 0) || (filename == NULL))
+	{
+		ESP_LOGE(TAG, "Send file: Wrong argument");
+		return;	
+	}
+
+	TELEGRAM_TRACE(TELEGRAM_TRACE_SEND_ENQUEUED, req_id, (file_type == TELEGRAM_PHOTO)?TELEGRAM_SEND_PHOTO:TELEGRAM_SEND_FILE);
+	telegram_wait_lane(teleCtx, TELEGRAM_LANE_BULK, req_id);
+	switch(file_type)
+	{
+		case TELEGRAM_PHOTO:
+			path = telegram_make_method_path(TELEGRAM_SEND_PHOTO, teleCtx->token, 0, 0, NULL);
 			break;
 
 		default:
-			sprintf(&overhead[strlen(overhead)], TELEGRAM_BOUNDARY_CONTENT_FMT"\"document\"");
+			path = telegram_make_method_path(TELEGRAM_SEND_FILE, teleCtx->token, 0, 0, NULL);
 			break;
 	}
 
-	sprintf(&overhead[strlen(overhead)], "; filename=\"%s\"\r\nContent-Type: application/octet-stream\r\n\r\n", filename);
+	if (path == NULL)
+	{
+		ESP_LOGE(TAG, "No mem (1)!");
+		telegram_give_lane(teleCtx, TELEGRAM_LANE_BULK, req_id);
+		return;
+	}
+
+	overhead = telegram_make_file_preamble(chat_id, caption, filename, file_type);
+	if (overhead == NULL)
+	{
+		ESP_LOGE(TAG, "No mem (2)!");
+		telegram_free_tag(TELEGRAM_MEM_MAKE, path);
+		telegram_give_lane(teleCtx, TELEGRAM_LANE_BULK, req_id);
+		return;
+	}
 
-	ctx_e = calloc(1, sizeof(telegram_send_data_e_t));
+	ctx_e = telegram_calloc(TELEGRAM_MEM_CORE, 1, sizeof(telegram_send_data_e_t));
 	if (!ctx_e)
 	{
 		ESP_LOGE(TAG, "No mem!(3)");
-		free(response);
-		free(overhead);
-		free(path);
-		telegram_give_mutex(teleCtx);
+		telegram_free_tag(TELEGRAM_MEM_IO, response);
+		telegram_free_tag(TELEGRAM_MEM_CORE, overhead);
+		telegram_free_tag(TELEGRAM_MEM_MAKE, path);
+		telegram_give_lane(teleCtx, TELEGRAM_LANE_BULK, req_id);
 		return;
 	}
 
@@ -435,20 +1647,230 @@ void telegram_send_file_full(void *teleCtx_ptr, telegram_int_t chat_id, char *ca
 	ctx_e->total_len = total_len;
 
 	total_len += strlen(TELEGRAM_BOUNDARY_FTR);
-	response = telegram_io_send_big(path, total_len, (telegram_io_header_t *)sendHeaders, overhead, 
-		ctx_e, telegram_send_file_cb);
+	response = telegram_io_send_big(path, total_len, (telegram_io_header_t *)multipartHeaders, overhead, 
+		ctx_e, telegram_send_file_cb, &info);
+	telegram_stats_account(teleCtx, (file_type == TELEGRAM_PHOTO)?TELEGRAM_SEND_PHOTO:TELEGRAM_SEND_FILE, &info);
 
-	free(overhead);
-	free(path);
+	telegram_free_tag(TELEGRAM_MEM_CORE, overhead);
+	telegram_free_tag(TELEGRAM_MEM_MAKE, path);
 	if (response)
 	{
 		telegram_parse_messages(ctx_e, response, parse_response_result);
-		free(response);
+		telegram_free_tag(TELEGRAM_MEM_IO, response);
 	}
 
 	cb(TELEGRAM_END, ctx_e->teleCtx, ctx_e->user_ctx, NULL);
-	free(ctx_e);
-	telegram_give_mutex(teleCtx);
+	telegram_free_tag(TELEGRAM_MEM_CORE, ctx_e);
+	telegram_give_lane(teleCtx, TELEGRAM_LANE_BULK, req_id);
+}
+
+/** Sends multipart request made of parts over the lane of the method */
+static bool telegram_send_multipart(telegram_ctx_t *teleCtx, telegram_method_t method, 
+	const telegram_io_part_t *parts, uint32_t count)
+{
+	return telegram_send_request_io(teleCtx, (telegram_lane_t)teleCtx->method_lane[method], method, NULL, parts, count, 
+		NULL, NULL, NULL);
+}
+
+bool telegram_send_file_iov(void *teleCtx_ptr, telegram_int_t chat_id, const char *caption, const char *filename,
+	const telegram_io_part_t *iov, uint32_t count, telegram_file_type_t file_type)
+{
+	bool res = false;
+	char *overhead = NULL;
+	telegram_io_part_t *parts = NULL;
+	telegram_ctx_t *teleCtx = (telegram_ctx_t *)teleCtx_ptr;
+
+	if ((teleCtx_ptr == NULL) || (filename == NULL) || (iov == NULL) || (count == 0))
+	{
+		ESP_LOGE(TAG, "Send file: Wrong argument");
+		return false;	
+	}
+
+	overhead = telegram_make_file_preamble(chat_id, caption, filename, file_type);
+	parts = telegram_calloc(TELEGRAM_MEM_CORE, count + 2, sizeof(telegram_io_part_t));
+	if ((overhead == NULL) || (parts == NULL))
+	{
+		ESP_LOGE(TAG, "No mem!");
+		telegram_free_tag(TELEGRAM_MEM_CORE, overhead);
+		telegram_free_tag(TELEGRAM_MEM_CORE, parts);
+		return false;
+	}
+
+	parts[0].data = (const uint8_t *)overhead;
+	parts[0].len = strlen(overhead);
+	memcpy(&parts[1], iov, count * sizeof(telegram_io_part_t));
+	parts[count + 1].data = (const uint8_t *)TELEGRAM_BOUNDARY_FTR;
+	parts[count + 1].len = strlen(TELEGRAM_BOUNDARY_FTR);
+
+	res = telegram_send_multipart(teleCtx, (file_type == TELEGRAM_PHOTO)?TELEGRAM_SEND_PHOTO:TELEGRAM_SEND_FILE, 
+		parts, count + 2);
+	telegram_free_tag(TELEGRAM_MEM_CORE, parts);
+	telegram_free_tag(TELEGRAM_MEM_CORE, overhead);
+	return res;
+}
+
+/** chat_id and media fields of sendMediaGroup, media items refer to the file parts by attach://fileN */
+static char *telegram_make_media_preamble(telegram_int_t chat_id, const telegram_media_t *media, uint32_t count)
+{
+	uint32_t i;
+	size_t size = 2 * strlen(TELEGRAM_BOUNDARY_CONTENT_FMT) + TELEGRAM_INT_MAX_VAL_LENGTH + 32;
+	char *str = NULL;
+
+	for (i = 0; i < count; i++)
+	{
+		size += strlen(TELEGRAM_MEDIA_ITEM_FMT) + strlen("document") + TELEGRAM_INT_MAX_VAL_LENGTH + 2;
+		if (media[i].caption)
+		{
+			size += strlen(TELEGRAM_MEDIA_CAPTION_FMT) + strlen(media[i].caption);
+		}
+	}
+
+	str = telegram_calloc(TELEGRAM_MEM_CORE, sizeof(char), size);
+	if (str == NULL)
+	{
+		return NULL;
+	}
+
+	size = sprintf(str, TELEGRAM_BOUNDARY_CONTENT_FMT"\"chat_id\"\r\n\r\n%.0f\r\n", chat_id);
+	size += sprintf(&str[size], TELEGRAM_BOUNDARY_CONTENT_FMT"\"media\"\r\n\r\n[");
+	for (i = 0; i < count; i++)
+	{
+		size += sprintf(&str[size], "%s"TELEGRAM_MEDIA_ITEM_FMT, i?", ":"", 
+			(media[i].type == TELEGRAM_PHOTO)?"photo":"document", i);
+		if (media[i].caption)
+		{
+			size += sprintf(&str[size], TELEGRAM_MEDIA_CAPTION_FMT, media[i].caption);
+		}
+
+		size += sprintf(&str[size], "}");
+	}
+
+	sprintf(&str[size], "]\r\n");
+	return str;
+}
+
+bool telegram_send_media_group(void *teleCtx_ptr, telegram_int_t chat_id, const telegram_media_t *media, uint32_t count)
+{
+	bool res = false;
+	uint32_t i;
+	uint32_t part_count = 2 * count + 2;
+	char *preamble = NULL;
+	telegram_io_part_t *parts = NULL;
+	telegram_ctx_t *teleCtx = (telegram_ctx_t *)teleCtx_ptr;
+
+	if ((teleCtx_ptr == NULL) || (media == NULL) || (count < TELEGRAM_MEDIA_GROUP_MIN) || (count > TELEGRAM_MEDIA_GROUP_MAX))
+	{
+		ESP_LOGE(TAG, "Send media group: Wrong argument");
+		return false;	
+	}
+
+	for (i = 0; i < count; i++)
+	{
+		if (media[i].filename == NULL)
+		{
+			ESP_LOGE(TAG, "Send media group: no filename of %u", i);
+			return false;
+		}
+	}
+
+	preamble = telegram_make_media_preamble(chat_id, media, count);
+	parts = telegram_calloc(TELEGRAM_MEM_CORE, part_count, sizeof(telegram_io_part_t));
+	if ((preamble == NULL) || (parts == NULL))
+	{
+		ESP_LOGE(TAG, "No mem!");
+		telegram_free_tag(TELEGRAM_MEM_CORE, preamble);
+		telegram_free_tag(TELEGRAM_MEM_CORE, parts);
+		return false;
+	}
+
+	parts[0].data = (const uint8_t *)preamble;
+	parts[0].len = strlen(preamble);
+	for (i = 0; i < count; i++)
+	{
+		char *hdr = telegram_calloc(TELEGRAM_MEM_CORE, sizeof(char), strlen(TELEGRAM_MEDIA_FILE_FMT) 
+			+ TELEGRAM_INT_MAX_VAL_LENGTH + strlen(media[i].filename) + 1);
+		if (hdr == NULL)
+		{
+			ESP_LOGE(TAG, "No mem!");
+			break;
+		}
+
+		/* File data is not terminated by new line, it goes before the next boundary */
+		sprintf(hdr, TELEGRAM_MEDIA_FILE_FMT, i?"\r\n":"", i, media[i].filename);
+		parts[2 * i + 1].data = (const uint8_t *)hdr;
+		parts[2 * i + 1].len = strlen(hdr);
+		parts[2 * i + 2] = media[i].data;
+	}
+
+	if (i == count)
+	{
+		parts[part_count - 1].data = (const uint8_t *)TELEGRAM_BOUNDARY_FTR;
+		parts[part_count - 1].len = strlen(TELEGRAM_BOUNDARY_FTR);
+		res = telegram_send_multipart(teleCtx, TELEGRAM_SEND_MEDIA_GROUP, parts, part_count);
+	}
+
+	for (i = 0; i < count; i++)
+	{
+		telegram_free_tag(TELEGRAM_MEM_CORE, (void *)parts[2 * i + 1].data);
+	}
+
+	telegram_free_tag(TELEGRAM_MEM_CORE, parts);
+	telegram_free_tag(TELEGRAM_MEM_CORE, preamble);
+	return res;
+}
+
+bool telegram_send_file_mem(void *teleCtx_ptr, telegram_int_t chat_id, const char *caption, const char *filename,
+	const uint8_t *data, uint32_t len, telegram_file_type_t file_type)
+{
+	telegram_io_part_t part = {.data = data, .len = len};
+
+	if ((data == NULL) || (len == 0))
+	{
+		ESP_LOGE(TAG, "Send file: Wrong argument");
+		return false;
+	}
+
+	return telegram_send_file_iov(teleCtx_ptr, chat_id, caption, filename, &part, 1, file_type);
+}
+
+typedef struct
+{
+	int fd;
+	off_t start; /** Position of the first byte, -1 if the descriptor is not seekable */
+} telegram_send_fd_t;
+
+/** Reads the part at offset, so the result does not depend on how the producer is called */
+static uint32_t telegram_send_fd_cb(void *ctx, uint8_t *buf, uint32_t max_size, uint32_t offset)
+{
+	ssize_t size;
+	telegram_send_fd_t *fd_ctx = (telegram_send_fd_t *)ctx;
+
+	if ((fd_ctx->start >= 0) && (lseek(fd_ctx->fd, fd_ctx->start + offset, SEEK_SET) < 0))
+	{
+		return 0;
+	}
+
+	size = read(fd_ctx->fd, buf, max_size);
+
+	return (size < 0)?0:(uint32_t)size;
+}
+
+bool telegram_send_file_fd(void *teleCtx_ptr, telegram_int_t chat_id, const char *caption, const char *filename,
+	int fd, uint32_t len, telegram_file_type_t file_type)
+{
+	telegram_send_fd_t fd_ctx = {.fd = fd, .start = -1};
+	telegram_io_part_t part = {.len = len, .cb = telegram_send_fd_cb, .ctx = &fd_ctx};
+
+	if ((fd < 0) || (len == 0))
+	{
+		ESP_LOGE(TAG, "Send file: Wrong argument");
+		return false;
+	}
+
+	/* Pipes and sockets are read as is */
+	fd_ctx.start = lseek(fd, 0, SEEK_CUR);
+
+	return telegram_send_file_iov(teleCtx_ptr, chat_id, caption, filename, &part, 1, file_type);
 }
 
 void telegram_send_file(void *teleCtx_ptr, telegram_int_t chat_id, char *caption, char *filename, uint32_t total_len,
@@ -458,9 +1880,12 @@ void telegram_send_file(void *teleCtx_ptr, telegram_int_t chat_id, char *caption
 }
 
 
-void telegram_get_file(void *teleCtx_ptr, const char *file_id, void *ctx, telegram_evt_cb_t cb)
+void telegram_get_file_from(void *teleCtx_ptr, const char *file_id, uint32_t offset, void *ctx, telegram_evt_cb_t cb)
 {
 	char *file_path = NULL;
+	bool res;
+	uint32_t req_id = TELEGRAM_TRACE_NEW_ID();
+	telegram_io_info_t info = {.req_id = req_id};
 	telegram_send_data_e_t ctx_e = {.teleCtx = teleCtx_ptr, .user_ctx = ctx, .user_cb = cb, };
 
 	if ((teleCtx_ptr == NULL) || (cb == NULL))
@@ -470,26 +1895,58 @@ void telegram_get_file(void *teleCtx_ptr, const char *file_id, void *ctx, telegr
 	}
 	
 	file_path = telegram_get_file_path(teleCtx_ptr, file_id);
-	telegram_wait_mutex((telegram_ctx_t *)teleCtx_ptr);
 	if (file_path == NULL)
 	{
-		telegram_give_mutex((telegram_ctx_t *)teleCtx_ptr);
 		ctx_e.user_cb(TELEGRAM_ERR, ctx_e.teleCtx, ctx_e.user_ctx, NULL);
 		ESP_LOGE(TAG, "Fail to get file path");
 	} else
 	{
-		telegram_io_read_file(file_path, &ctx_e, telegram_io_get_file_cb);
-		free(file_path);
-		telegram_give_mutex((telegram_ctx_t *)teleCtx_ptr);
+		telegram_wait_lane((telegram_ctx_t *)teleCtx_ptr, TELEGRAM_LANE_BULK, req_id);
+		res = telegram_io_read_file(file_path, offset, &ctx_e, telegram_io_get_file_cb, &info);
+		telegram_stats_account((telegram_ctx_t *)teleCtx_ptr, TELEGRAM_GET_FILE, &info);
+		telegram_free_tag(TELEGRAM_MEM_MAKE, file_path);
+		telegram_give_lane((telegram_ctx_t *)teleCtx_ptr, TELEGRAM_LANE_BULK, req_id);
+		if (!res)
+		{
+			/* Link may be expired, next attempt should resolve it again. The cache is guarded by the normal lane */
+			telegram_wait_lane((telegram_ctx_t *)teleCtx_ptr, TELEGRAM_LANE_NORMAL, req_id);
+			telegram_cache_remove(((telegram_ctx_t *)teleCtx_ptr)->file_cache, file_id);
+			telegram_give_lane((telegram_ctx_t *)teleCtx_ptr, TELEGRAM_LANE_NORMAL, req_id);
+		}
+
 		ctx_e.user_cb(TELEGRAM_END, ctx_e.teleCtx, ctx_e.user_ctx, NULL);
 	}
 }
 
-void telegram_answer_cb_query(void *teleCtx_ptr, const char *cid, const char *text, 
+void telegram_get_file(void *teleCtx_ptr, const char *file_id, void *ctx, telegram_evt_cb_t cb)
+{
+	telegram_get_file_from(teleCtx_ptr, file_id, 0, ctx, cb);
+}
+
+static void telegram_answer_cb_query_int(telegram_ctx_t *teleCtx, const char *cid, const char *text, 
 	bool show_alert, const char *url, telegram_int_t cache_time)
 {
-	char *path = NULL;
 	char *str = NULL;
+
+	str = telegram_make_answer_query(cid, text, show_alert, url, cache_time);	
+	if (str == NULL)
+	{
+		ESP_LOGE(TAG, "No memory!(1)");
+		telegram_ack_forget(teleCtx, cid);
+		return;
+	}
+
+	if (!telegram_send_request(teleCtx, TELEGRAM_ANSWER_QUERY, str))
+	{
+		telegram_ack_forget(teleCtx, cid);
+	}
+
+	telegram_free_tag(TELEGRAM_MEM_MAKE, str);
+}
+
+void telegram_answer_cb_query(void *teleCtx_ptr, const char *cid, const char *text, 
+	bool show_alert, const char *url, telegram_int_t cache_time)
+{
 	telegram_ctx_t *teleCtx = (telegram_ctx_t *)teleCtx_ptr;
 
 	if ((teleCtx_ptr == NULL) || (cid == NULL))
@@ -497,27 +1954,177 @@ void telegram_answer_cb_query(void *teleCtx_ptr, const char *cid, const char *te
 		ESP_LOGE(TAG, "NULL argument");
 		return;
 	}
-	
-	telegram_wait_mutex(teleCtx);
-	str = telegram_make_answer_query(cid, text, show_alert, url, cache_time);	
-	if (str == NULL)
+
+	if (telegram_ack_first(teleCtx, cid, (text != NULL) || show_alert || (url != NULL)))
 	{
-		ESP_LOGE(TAG, "No memory!(1)");
-		telegram_give_mutex(teleCtx);
+		telegram_answer_cb_query_int(teleCtx, cid, text, show_alert, url, cache_time);
+	}
+}
+
+bool telegram_set_auto_ack(void *teleCtx_ptr, bool enable, telegram_ack_policy_t policy, void *ctx)
+{
+	telegram_ctx_t *teleCtx = (telegram_ctx_t *)teleCtx_ptr;
+
+	if (teleCtx_ptr == NULL)
+	{
+		return false;
+	}
+
+	teleCtx->ack_policy = policy;
+	teleCtx->ack_policy_ctx = ctx;
+	if (!enable)
+	{
+		telegram_sender_stop(teleCtx->ack_sender);
+		teleCtx->ack_sender = NULL;
+		return true;
+	}
+
+	if (teleCtx->ack_sender == NULL)
+	{
+		teleCtx->ack_sender = telegram_sender_init(TELEGRAM_ACK_QUEUE_LEN, telegram_ack_exec, teleCtx);
+	}
+
+	return (teleCtx->ack_sender != NULL);
+}
+
+bool telegram_set_method_lane(void *teleCtx_ptr, telegram_method_t method, telegram_lane_t lane)
+{
+	telegram_ctx_t *teleCtx = (telegram_ctx_t *)teleCtx_ptr;
+
+	if ((teleCtx_ptr == NULL) || (method >= TELEGRAM_METHOD_COUNT) || (lane >= TELEGRAM_LANE_COUNT))
+	{
+		return false;
+	}
+
+	teleCtx->method_lane[method] = (uint8_t)lane;
+	return true;
+}
+
+void telegram_get_file_cache_stats(void *teleCtx_ptr, telegram_cache_stats_t *stats)
+{
+	uint32_t req_id = TELEGRAM_TRACE_NEW_ID();
+	telegram_ctx_t *teleCtx = (telegram_ctx_t *)teleCtx_ptr;
+
+	if ((teleCtx_ptr == NULL) || (stats == NULL))
+	{
+		ESP_LOGE(TAG, "NULL argument");
 		return;
 	}
 
-	path = telegram_make_method_path(TELEGRAM_ANSWER_QUERY, teleCtx->token, 0, 0, NULL);
-	if (path == NULL)
+	telegram_wait_lane(teleCtx, TELEGRAM_LANE_NORMAL, req_id);
+	telegram_cache_get_stats(teleCtx->file_cache, stats);
+	telegram_give_lane(teleCtx, TELEGRAM_LANE_NORMAL, req_id);
+}
+
+/**
+ Copies src to dst, or clears dst if src is NULL, one method at a time: the lock masks interrupts,
+ the whole statistics are too large to be copied at once.
+*/
+static void telegram_stats_copy(telegram_ctx_t *teleCtx, telegram_stats_t *dst, const telegram_stats_t *src)
+{
+	uint32_t i;
+
+	for (i = 0; i < TELEGRAM_METHOD_COUNT; i++)
+	{
+		portENTER_CRITICAL(&teleCtx->shared->stats_lock);
+		if (src != NULL)
+		{
+			dst->methods[i] = src->methods[i];
+		} else
+		{
+			memset(&dst->methods[i], 0, sizeof(telegram_method_stats_t));
+		}
+		portEXIT_CRITICAL(&teleCtx->shared->stats_lock);
+	}
+
+	portENTER_CRITICAL(&teleCtx->shared->stats_lock);
+	if (src != NULL)
+	{
+		dst->parse = src->parse;
+		dst->dispatch = src->dispatch;
+		dst->mutex_wait = src->mutex_wait;
+	} else
+	{
+		memset(&dst->parse, 0, sizeof(telegram_stats_hist_t));
+		memset(&dst->dispatch, 0, sizeof(telegram_stats_hist_t));
+		memset(&dst->mutex_wait, 0, sizeof(telegram_stats_hist_t));
+	}
+	portEXIT_CRITICAL(&teleCtx->shared->stats_lock);
+}
+
+void telegram_get_stats(void *teleCtx_ptr, telegram_stats_t *stats)
+{
+	telegram_ctx_t *teleCtx = (telegram_ctx_t *)teleCtx_ptr;
+
+	if ((teleCtx_ptr == NULL) || (stats == NULL))
+	{
+		ESP_LOGE(TAG, "NULL argument");
+		return;
+	}
+
+	telegram_stats_copy(teleCtx, stats, &teleCtx->shared->stats);
+}
+
+void telegram_reset_stats(void *teleCtx_ptr)
+{
+	telegram_ctx_t *teleCtx = (telegram_ctx_t *)teleCtx_ptr;
+
+	if (teleCtx_ptr == NULL)
+	{
+		return;
+	}
+
+	telegram_stats_copy(teleCtx, &teleCtx->shared->stats, NULL);
+}
+
+bool telegram_webhook_reply(void *teleCtx_ptr, telegram_method_t method, const char *payload)
+{
+	telegram_ctx_t *teleCtx = (telegram_ctx_t *)teleCtx_ptr;
+
+	if ((teleCtx_ptr == NULL) || (payload == NULL))
+	{
+		return false;
+	}
+
+	/* Only one method can be answered inline and only from the webhook dispatch */
+	if ((teleCtx->reply_task == NULL) || (teleCtx->reply_task != xTaskGetCurrentTaskHandle()) 
+		|| (teleCtx->inline_reply != NULL))
+	{
+		return false;
+	}
+
+	teleCtx->inline_reply = telegram_make_inline_reply(method, payload);
+	return (teleCtx->inline_reply != NULL);
+}
+
+void telegram_reply_message(void *teleCtx_ptr, telegram_int_t chat_id, const char *message, telegram_kbrd_t *kbrd)
+{
+	char *payload = telegram_make_message(chat_id, message, kbrd);
+
+	if ((payload == NULL) || !telegram_webhook_reply(teleCtx_ptr, TELEGRAM_SEND_MESSAGE, payload))
+	{
+		telegram_send_message(teleCtx_ptr, chat_id, message, kbrd);
+	}
+
+	telegram_free_tag(TELEGRAM_MEM_MAKE, payload);
+}
+
+void telegram_reply_cb_query(void *teleCtx_ptr, const char *cid, const char *text, 
+	bool show_alert, const char *url, telegram_int_t cache_time)
+{
+	char *payload = NULL;
+
+	if ((teleCtx_ptr == NULL) || (cid == NULL) || !telegram_ack_first((telegram_ctx_t *)teleCtx_ptr, cid, 
+		(text != NULL) || show_alert || (url != NULL)))
 	{
-		free(str);
-		ESP_LOGE(TAG, "No memory!(2)");
-		telegram_give_mutex(teleCtx);
 		return;
 	}
 
-	telegram_io_send(path, str, (telegram_io_header_t *)jsonHeaders);
-	free(path);
-	free(str);
-	telegram_give_mutex(teleCtx);
+	payload = telegram_make_answer_query(cid, text, show_alert, url, cache_time);
+	if ((payload == NULL) || !telegram_webhook_reply(teleCtx_ptr, TELEGRAM_ANSWER_QUERY, payload))
+	{
+		telegram_answer_cb_query_int((telegram_ctx_t *)teleCtx_ptr, cid, text, show_alert, url, cache_time);
+	}
+
+	telegram_free_tag(TELEGRAM_MEM_MAKE, payload);
 }
\ No newline at end of file
@@ -0,0 +1,55 @@
+#include <string.h>
+#include "telegram_ack.h"
+#include "telegram_hash.h"
+
+static uint32_t telegram_ack_hash(const char *cid)
+{
+	uint32_t hash = telegram_hash_str(TELEGRAM_HASH_INIT, cid);
+
+	/* 0 marks empty entry */
+	return (hash != 0) ? hash : 1;
+}
+
+bool telegram_ack_history_add(telegram_ack_history_t *history, const char *cid)
+{
+	uint32_t hash;
+	uint32_t i;
+
+	if ((history == NULL) || (cid == NULL))
+	{
+		return true;
+	}
+
+	hash = telegram_ack_hash(cid);
+	for (i = 0; i < TELEGRAM_ACK_HISTORY; i++)
+	{
+		if (history->ids[i] == hash)
+		{
+			return false;
+		}
+	}
+
+	history->ids[history->pos] = hash;
+	history->pos = (history->pos + 1) % TELEGRAM_ACK_HISTORY;
+	return true;
+}
+
+void telegram_ack_history_remove(telegram_ack_history_t *history, const char *cid)
+{
+	uint32_t i;
+	uint32_t hash;
+
+	if ((history == NULL) || (cid == NULL))
+	{
+		return;
+	}
+
+	hash = telegram_ack_hash(cid);
+	for (i = 0; i < TELEGRAM_ACK_HISTORY; i++)
+	{
+		if (history->ids[i] == hash)
+		{
+			history->ids[i] = 0;
+		}
+	}
+}
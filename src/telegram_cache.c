@@ -0,0 +1,204 @@
+#include <string.h>
+#include <stdlib.h>
+#include <esp_timer.h>
+#include "telegram_cache.h"
+#include "telegram_mem.h"
+
+typedef struct
+{
+	char *key;
+	char *value;
+	int64_t expires;
+	uint32_t last_used;
+} telegram_cache_entry_t;
+
+typedef struct
+{
+	uint32_t size;
+	int64_t ttl;
+	uint32_t use_counter;
+	telegram_cache_stats_t stats;
+	telegram_cache_entry_t *entries;
+} telegram_cache_t;
+
+static void telegram_cache_drop(telegram_cache_entry_t *entry)
+{
+	telegram_free_tag(TELEGRAM_MEM_CORE, entry->key);
+	telegram_free_tag(TELEGRAM_MEM_CORE, entry->value);
+	memset(entry, 0, sizeof(telegram_cache_entry_t));
+}
+
+static telegram_cache_entry_t *telegram_cache_find(telegram_cache_t *cache, const char *key)
+{
+	uint32_t i;
+	int64_t now = esp_timer_get_time();
+
+	for (i = 0; i < cache->size; i++)
+	{
+		telegram_cache_entry_t *entry = &cache->entries[i];
+
+		if (entry->key == NULL)
+		{
+			continue;
+		}
+
+		if (entry->expires <= now)
+		{
+			telegram_cache_drop(entry);
+			continue;
+		}
+
+		if (!strcmp(entry->key, key))
+		{
+			return entry;
+		}
+	}
+
+	return NULL;
+}
+
+void *telegram_cache_init(uint32_t size, uint32_t ttl_sec)
+{
+	telegram_cache_t *cache = NULL;
+
+	if (size == 0)
+	{
+		return NULL;
+	}
+
+	cache = telegram_calloc(TELEGRAM_MEM_CORE, 1, sizeof(telegram_cache_t));
+	if (cache == NULL)
+	{
+		return NULL;
+	}
+
+	cache->entries = telegram_calloc(TELEGRAM_MEM_CORE, size, sizeof(telegram_cache_entry_t));
+	if (cache->entries == NULL)
+	{
+		telegram_free_tag(TELEGRAM_MEM_CORE, cache);
+		return NULL;
+	}
+
+	cache->size = size;
+	cache->ttl = (int64_t)ttl_sec * 1000000LL;
+	return cache;
+}
+
+char *telegram_cache_get(void *cache_ptr, const char *key)
+{
+	telegram_cache_t *cache = (telegram_cache_t *)cache_ptr;
+	telegram_cache_entry_t *entry = NULL;
+
+	if ((cache == NULL) || (key == NULL))
+	{
+		return NULL;
+	}
+
+	entry = telegram_cache_find(cache, key);
+	if (entry == NULL)
+	{
+		cache->stats.misses++;
+		return NULL;
+	}
+
+	cache->stats.hits++;
+	entry->last_used = ++cache->use_counter;
+	return telegram_strdup(TELEGRAM_MEM_CORE, entry->value);
+}
+
+void telegram_cache_put(void *cache_ptr, const char *key, const char *value)
+{
+	uint32_t i;
+	telegram_cache_t *cache = (telegram_cache_t *)cache_ptr;
+	telegram_cache_entry_t *entry = NULL;
+
+	if ((cache == NULL) || (key == NULL) || (value == NULL))
+	{
+		return;
+	}
+
+	entry = telegram_cache_find(cache, key);
+	if (entry == NULL)
+	{
+		entry = &cache->entries[0];
+		for (i = 0; i < cache->size; i++)
+		{
+			if (cache->entries[i].key == NULL)
+			{
+				entry = &cache->entries[i];
+				break;
+			}
+
+			if (cache->entries[i].last_used < entry->last_used)
+			{
+				entry = &cache->entries[i];
+			}
+		}
+	}
+
+	telegram_cache_drop(entry);
+	entry->key = telegram_strdup(TELEGRAM_MEM_CORE, key);
+	entry->value = telegram_strdup(TELEGRAM_MEM_CORE, value);
+	if ((entry->key == NULL) || (entry->value == NULL))
+	{
+		telegram_cache_drop(entry);
+		return;
+	}
+
+	entry->expires = esp_timer_get_time() + cache->ttl;
+	entry->last_used = ++cache->use_counter;
+}
+
+void telegram_cache_remove(void *cache_ptr, const char *key)
+{
+	telegram_cache_t *cache = (telegram_cache_t *)cache_ptr;
+	telegram_cache_entry_t *entry = NULL;
+
+	if ((cache == NULL) || (key == NULL))
+	{
+		return;
+	}
+
+	entry = telegram_cache_find(cache, key);
+	if (entry != NULL)
+	{
+		telegram_cache_drop(entry);
+	}
+}
+
+void telegram_cache_get_stats(void *cache_ptr, telegram_cache_stats_t *stats)
+{
+	telegram_cache_t *cache = (telegram_cache_t *)cache_ptr;
+
+	if (stats == NULL)
+	{
+		return;
+	}
+
+	if (cache == NULL)
+	{
+		memset(stats, 0, sizeof(telegram_cache_stats_t));
+		return;
+	}
+
+	*stats = cache->stats;
+}
+
+void telegram_cache_free(void *cache_ptr)
+{
+	uint32_t i;
+	telegram_cache_t *cache = (telegram_cache_t *)cache_ptr;
+
+	if (cache == NULL)
+	{
+		return;
+	}
+
+	for (i = 0; i < cache->size; i++)
+	{
+		telegram_cache_drop(&cache->entries[i]);
+	}
+
+	telegram_free_tag(TELEGRAM_MEM_CORE, cache->entries);
+	telegram_free_tag(TELEGRAM_MEM_CORE, cache);
+}
@@ -0,0 +1,305 @@
+#include <string.h>
+#include <esp_log.h>
+#include "telegram_cbdata.h"
+#include "telegram_mem.h"
+#include "telegram_hash.h"
+
+#define TELEGRAM_CBDATA_SEP ':'
+/** Decoded bytes of the longest callback_data */
+#define TELEGRAM_CBDATA_BIN_MAX (TELEGRAM_CBDATA_MAX_LEN * 3U / 4U)
+#define TELEGRAM_CBDATA_ARGC_MASK (0x07U)
+#define TELEGRAM_CBDATA_TOKEN_SHIFT (3U)
+
+static const char *TAG="telegram_cbdata";
+
+static const char telegram_cbdata_alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+static uint8_t telegram_cbdata_check(const uint8_t *bin, uint32_t len)
+{
+	uint32_t hash = telegram_hash(TELEGRAM_HASH_INIT, bin, len);
+
+	return (uint8_t)(hash ^ (hash >> 8) ^ (hash >> 16) ^ (hash >> 24));
+}
+
+static int8_t telegram_cbdata_char_val(char c)
+{
+	if ((c >= 'A') && (c <= 'Z'))
+	{
+		return c - 'A';
+	}
+
+	if ((c >= 'a') && (c <= 'z'))
+	{
+		return c - 'a' + 26;
+	}
+
+	if ((c >= '0') && (c <= '9'))
+	{
+		return c - '0' + 52;
+	}
+
+	if (c == '-')
+	{
+		return 62;
+	}
+
+	if (c == '_')
+	{
+		return 63;
+	}
+
+	return -1;
+}
+
+/** Pack payload, returns number of bytes or 0 if it is too long */
+static uint32_t telegram_cbdata_pack(const telegram_cbdata_t *data, uint8_t *bin)
+{
+	uint32_t pos = 2;
+	uint32_t token_len = strnlen(data->token, TELEGRAM_CBDATA_TOKEN_MAX_LEN + 1);
+	uint64_t val;
+	uint32_t i;
+
+	if ((data->argc > TELEGRAM_CBDATA_MAX_ARGS) || (token_len > TELEGRAM_CBDATA_TOKEN_MAX_LEN))
+	{
+		return 0;
+	}
+
+	bin[0] = data->action;
+	bin[1] = (uint8_t)(data->argc | (token_len << TELEGRAM_CBDATA_TOKEN_SHIFT));
+	for (i = 0; i < data->argc; i++)
+	{
+		/* Zigzag: small negative values stay short */
+		val = ((uint64_t)data->args[i] << 1) ^ (uint64_t)(data->args[i] >> 63);
+		do
+		{
+			if (pos >= (TELEGRAM_CBDATA_BIN_MAX - 1))
+			{
+				return 0;
+			}
+
+			bin[pos++] = (uint8_t)((val & 0x7F) | ((val > 0x7F) ? 0x80 : 0));
+			val >>= 7;
+		} while (val != 0);
+	}
+
+	if ((pos + token_len) >= TELEGRAM_CBDATA_BIN_MAX)
+	{
+		return 0;
+	}
+
+	memcpy(&bin[pos], data->token, token_len);
+	pos += token_len;
+	bin[pos] = telegram_cbdata_check(bin, pos);
+	return pos + 1;
+}
+
+uint32_t telegram_cbdata_encode(const char *prefix, const telegram_cbdata_t *data, char *out, uint32_t out_size)
+{
+	uint8_t bin[TELEGRAM_CBDATA_BIN_MAX];
+	uint32_t bin_len;
+	uint32_t prefix_len = (prefix != NULL) ? strlen(prefix) : 0;
+	uint32_t len;
+	uint32_t pos = 0;
+	uint32_t acc;
+	uint32_t i;
+
+	if ((data == NULL) || (out == NULL))
+	{
+		return 0;
+	}
+
+	bin_len = telegram_cbdata_pack(data, bin);
+	if (bin_len == 0)
+	{
+		return 0;
+	}
+
+	len = (bin_len / 3) * 4 + ((bin_len % 3) ? ((bin_len % 3) + 1) : 0);
+	if (prefix_len != 0)
+	{
+		len += prefix_len + 1;
+	}
+
+	if ((len > TELEGRAM_CBDATA_MAX_LEN) || (len >= out_size))
+	{
+		return 0;
+	}
+
+	if (prefix_len != 0)
+	{
+		memcpy(out, prefix, prefix_len);
+		out[prefix_len] = TELEGRAM_CBDATA_SEP;
+		pos = prefix_len + 1;
+	}
+
+	for (i = 0; i < bin_len; i += 3)
+	{
+		acc = (uint32_t)bin[i] << 16;
+		acc |= ((i + 1) < bin_len) ? ((uint32_t)bin[i + 1] << 8) : 0;
+		acc |= ((i + 2) < bin_len) ? bin[i + 2] : 0;
+		out[pos++] = telegram_cbdata_alphabet[(acc >> 18) & 0x3F];
+		out[pos++] = telegram_cbdata_alphabet[(acc >> 12) & 0x3F];
+		if ((i + 1) < bin_len)
+		{
+			out[pos++] = telegram_cbdata_alphabet[(acc >> 6) & 0x3F];
+		}
+
+		if ((i + 2) < bin_len)
+		{
+			out[pos++] = telegram_cbdata_alphabet[acc & 0x3F];
+		}
+	}
+
+	out[pos] = '\0';
+	return pos;
+}
+
+bool telegram_cbdata_decode(const char *str, telegram_cbdata_t *data)
+{
+	uint8_t bin[TELEGRAM_CBDATA_BIN_MAX];
+	const char *sep = NULL;
+	uint32_t bin_len = 0;
+	uint32_t bits = 0;
+	uint32_t acc = 0;
+	uint32_t token_len;
+	uint32_t pos = 2;
+	uint32_t shift;
+	uint64_t val;
+	uint32_t i;
+	int8_t v;
+
+	if ((str == NULL) || (data == NULL))
+	{
+		return false;
+	}
+
+	sep = strchr(str, TELEGRAM_CBDATA_SEP);
+	if (sep != NULL)
+	{
+		str = sep + 1;
+	}
+
+	for (; *str != '\0'; str++)
+	{
+		v = telegram_cbdata_char_val(*str);
+		if ((v < 0) || (bin_len >= sizeof(bin)))
+		{
+			return false;
+		}
+
+		acc = (acc << 6) | (uint32_t)v;
+		bits += 6;
+		if (bits >= 8)
+		{
+			bits -= 8;
+			bin[bin_len++] = (uint8_t)(acc >> bits);
+		}
+	}
+
+	/* 1 leftover character or not zero padding bits is not a valid encoding */
+	if ((bits >= 6) || ((acc & ((1U << bits) - 1)) != 0) || (bin_len < 3))
+	{
+		return false;
+	}
+
+	if (telegram_cbdata_check(bin, bin_len - 1) != bin[bin_len - 1])
+	{
+		return false;
+	}
+
+	bin_len--;
+	memset(data, 0, sizeof(telegram_cbdata_t));
+	data->action = bin[0];
+	data->argc = bin[1] & TELEGRAM_CBDATA_ARGC_MASK;
+	token_len = bin[1] >> TELEGRAM_CBDATA_TOKEN_SHIFT;
+	if ((data->argc > TELEGRAM_CBDATA_MAX_ARGS) || (token_len > TELEGRAM_CBDATA_TOKEN_MAX_LEN))
+	{
+		return false;
+	}
+
+	for (i = 0; i < data->argc; i++)
+	{
+		val = 0;
+		shift = 0;
+		do
+		{
+			if ((pos >= bin_len) || (shift > 63))
+			{
+				return false;
+			}
+
+			val |= (uint64_t)(bin[pos] & 0x7F) << shift;
+			shift += 7;
+		} while (bin[pos++] & 0x80);
+
+		data->args[i] = (int64_t)((val >> 1) ^ (~(val & 1) + 1));
+	}
+
+	if ((pos + token_len) != bin_len)
+	{
+		return false;
+	}
+
+	memcpy(data->token, &bin[pos], token_len);
+	return true;
+}
+
+telegram_kbrd_t *telegram_cbdata_make_kbrd(const char *prefix, const telegram_cbdata_btn_t *btns, uint32_t count,
+	uint32_t per_row)
+{
+	telegram_kbrd_t *kbrd = NULL;
+	telegram_kbrd_inline_row_t *rows = NULL;
+	telegram_kbrd_inline_btn_t *btn = NULL;
+	uint32_t row_count;
+	uint32_t i;
+
+	if ((btns == NULL) || (count == 0))
+	{
+		return NULL;
+	}
+
+	if ((per_row == 0) || (per_row > count))
+	{
+		per_row = count;
+	}
+
+	/* Keyboard, rows with the terminating row, buttons with the terminating button of each row */
+	row_count = (count + per_row - 1) / per_row;
+	kbrd = telegram_calloc(TELEGRAM_MEM_MAKE, 1, sizeof(telegram_kbrd_t)
+		+ (row_count + 1) * sizeof(telegram_kbrd_inline_row_t) + (count + row_count) * sizeof(telegram_kbrd_inline_btn_t));
+	if (kbrd == NULL)
+	{
+		ESP_LOGE(TAG, "No mem!");
+		return NULL;
+	}
+
+	rows = (telegram_kbrd_inline_row_t *)&kbrd[1];
+	btn = (telegram_kbrd_inline_btn_t *)&rows[row_count + 1];
+	kbrd->type = TELEGRAM_KBRD_INLINE;
+	kbrd->kbrd.inl.rows = rows;
+	for (i = 0; i < count; i++)
+	{
+		if ((i % per_row) == 0)
+		{
+			if (i != 0)
+			{
+				btn++; /* Terminator of the previous row */
+			}
+
+			rows[i / per_row].buttons = btn;
+		}
+
+		if ((btns[i].text == NULL) || !telegram_cbdata_encode(prefix, &btns[i].data, btn->callback_data,
+			sizeof(btn->callback_data)))
+		{
+			ESP_LOGE(TAG, "Bad button %u", i);
+			telegram_free_tag(TELEGRAM_MEM_MAKE, kbrd);
+			return NULL;
+		}
+
+		btn->text = (char *)btns[i].text;
+		btn++;
+	}
+
+	return kbrd;
+}
@@ -0,0 +1,161 @@
+#include <string.h>
+#include <esp_log.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include "telegram_coalesce.h"
+#include "telegram_mem.h"
+
+static const char *TAG="telegram_coalesce";
+
+typedef struct
+{
+	SemaphoreHandle_t lock;
+	TaskHandle_t task;
+	TickType_t window;
+	telegram_coalesce_flush_t flush;
+	void *ctx;
+	telegram_int_t chat_id;
+	size_t len;
+	char buf[TELEGRAM_MESSAGE_MAX_LEN + 1];
+} telegram_coalesce_t;
+
+static void telegram_coalesce_flush_locked(telegram_coalesce_t *co)
+{
+	if (co->len == 0)
+	{
+		return;
+	}
+
+	co->flush(co->ctx, co->chat_id, co->buf);
+	co->len = 0;
+	co->buf[0] = '\0';
+}
+
+static void telegram_coalesce_task(void *param)
+{
+	telegram_coalesce_t *co = (telegram_coalesce_t *)param;
+
+	while (true)
+	{
+		ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+		vTaskDelay(co->window);
+		xSemaphoreTake(co->lock, portMAX_DELAY);
+		telegram_coalesce_flush_locked(co);
+		xSemaphoreGive(co->lock);
+	}
+}
+
+void *telegram_coalesce_init(uint32_t window_ms, telegram_coalesce_flush_t flush, void *ctx)
+{
+	telegram_coalesce_t *co = NULL;
+
+	if ((flush == NULL) || (window_ms == 0))
+	{
+		return NULL;
+	}
+
+	co = telegram_calloc(TELEGRAM_MEM_CORE, 1, sizeof(telegram_coalesce_t));
+	if (co == NULL)
+	{
+		return NULL;
+	}
+
+	co->window = window_ms / portTICK_PERIOD_MS;
+	co->flush = flush;
+	co->ctx = ctx;
+	co->lock = xSemaphoreCreateMutex();
+	if (co->lock == NULL)
+	{
+		telegram_free_tag(TELEGRAM_MEM_CORE, co);
+		return NULL;
+	}
+
+	if (xTaskCreate(&telegram_coalesce_task, "telegram_coalesce", TELEGRAM_COALESCE_TASK_STACK, co, 5, &co->task) != pdPASS)
+	{
+		ESP_LOGE(TAG, "Failed to create task");
+		vSemaphoreDelete(co->lock);
+		telegram_free_tag(TELEGRAM_MEM_CORE, co);
+		return NULL;
+	}
+
+	return co;
+}
+
+bool telegram_coalesce_push(void *coalesce, telegram_int_t chat_id, const char *text)
+{
+	size_t len;
+	bool start_window;
+	telegram_coalesce_t *co = (telegram_coalesce_t *)coalesce;
+
+	if ((co == NULL) || (text == NULL))
+	{
+		return false;
+	}
+
+	len = strlen(text);
+	if (len > TELEGRAM_MESSAGE_MAX_LEN)
+	{
+		telegram_coalesce_flush(co);
+		return false;
+	}
+
+	xSemaphoreTake(co->lock, portMAX_DELAY);
+	if ((co->len != 0) && ((co->chat_id != chat_id) 
+		|| ((co->len + strlen(TELEGRAM_COALESCE_SEPARATOR) + len) > TELEGRAM_MESSAGE_MAX_LEN)))
+	{
+		telegram_coalesce_flush_locked(co);
+	}
+
+	start_window = (co->len == 0);
+	if (!start_window)
+	{
+		strcpy(&co->buf[co->len], TELEGRAM_COALESCE_SEPARATOR);
+		co->len += strlen(TELEGRAM_COALESCE_SEPARATOR);
+	}
+
+	memcpy(&co->buf[co->len], text, len + 1);
+	co->len += len;
+	co->chat_id = chat_id;
+	xSemaphoreGive(co->lock);
+
+	if (start_window)
+	{
+		xTaskNotifyGive(co->task);
+	}
+
+	return true;
+}
+
+void telegram_coalesce_flush(void *coalesce)
+{
+	telegram_coalesce_t *co = (telegram_coalesce_t *)coalesce;
+
+	if (co == NULL)
+	{
+		return;
+	}
+
+	xSemaphoreTake(co->lock, portMAX_DELAY);
+	telegram_coalesce_flush_locked(co);
+	xSemaphoreGive(co->lock);
+}
+
+void telegram_coalesce_stop(void *coalesce)
+{
+	telegram_coalesce_t *co = (telegram_coalesce_t *)coalesce;
+
+	if (co == NULL)
+	{
+		return;
+	}
+
+	/* Task never holds the lock while waiting, it is safe to delete it with the lock taken */
+	xSemaphoreTake(co->lock, portMAX_DELAY);
+	vTaskDelete(co->task);
+	telegram_coalesce_flush_locked(co);
+	xSemaphoreGive(co->lock);
+
+	vSemaphoreDelete(co->lock);
+	telegram_free_tag(TELEGRAM_MEM_CORE, co);
+}
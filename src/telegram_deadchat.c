@@ -0,0 +1,263 @@
+#include <string.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include "telegram_deadchat.h"
+#include "telegram_mem.h"
+
+/** Slots probed from the home slot, lookups never walk further */
+#define TELEGRAM_DEADCHAT_PROBE (8U)
+
+static const char *TAG="telegram_deadchat";
+
+/** chat_id 0 marks empty slot, it is not a valid chat */
+typedef struct
+{
+	int64_t chat_id;
+	uint32_t expires; /** Seconds since boot */
+	int32_t error_code;
+} telegram_deadchat_entry_t;
+
+typedef struct
+{
+	uint32_t mask;
+	uint32_t ttl;
+	portMUX_TYPE lock;
+	telegram_deadchat_stats_t stats;
+	telegram_deadchat_entry_t *entries;
+} telegram_deadchat_t;
+
+static uint32_t telegram_deadchat_now(void)
+{
+	return (uint32_t)(esp_timer_get_time() / 1000000LL);
+}
+
+static uint32_t telegram_deadchat_hash(int64_t chat_id)
+{
+	uint64_t val = (uint64_t)chat_id;
+
+	return (uint32_t)(val ^ (val >> 32)) * 2654435761U;
+}
+
+/** Must be called under the lock, expired entry of the chat is dropped */
+static telegram_deadchat_entry_t *telegram_deadchat_find(telegram_deadchat_t *set, int64_t chat_id, uint32_t now)
+{
+	uint32_t pos = telegram_deadchat_hash(chat_id);
+	uint32_t i;
+
+	for (i = 0; (i < TELEGRAM_DEADCHAT_PROBE) && (i <= set->mask); i++)
+	{
+		telegram_deadchat_entry_t *entry = &set->entries[(pos + i) & set->mask];
+
+		if (entry->chat_id == chat_id)
+		{
+			if (entry->expires <= now)
+			{
+				memset(entry, 0, sizeof(telegram_deadchat_entry_t));
+				return NULL;
+			}
+
+			return entry;
+		}
+	}
+
+	return NULL;
+}
+
+void *telegram_deadchat_init(uint32_t capacity, uint32_t ttl_sec)
+{
+	telegram_deadchat_t *set = NULL;
+	uint32_t size = 1;
+
+	if ((capacity == 0) || (ttl_sec == 0))
+	{
+		return NULL;
+	}
+
+	while (size < capacity)
+	{
+		size <<= 1;
+	}
+
+	set = telegram_calloc(TELEGRAM_MEM_CORE, 1, sizeof(telegram_deadchat_t));
+	if (set == NULL)
+	{
+		ESP_LOGE(TAG, "No mem!");
+		return NULL;
+	}
+
+	set->entries = telegram_calloc(TELEGRAM_MEM_CORE, size, sizeof(telegram_deadchat_entry_t));
+	if (set->entries == NULL)
+	{
+		ESP_LOGE(TAG, "No mem!");
+		telegram_free_tag(TELEGRAM_MEM_CORE, set);
+		return NULL;
+	}
+
+	set->mask = size - 1;
+	set->ttl = ttl_sec;
+	set->lock = (portMUX_TYPE)portMUX_INITIALIZER_UNLOCKED;
+	return set;
+}
+
+bool telegram_deadchat_is_permanent(const telegram_response_t *resp)
+{
+	switch (telegram_response_classify(resp))
+	{
+		case TELEGRAM_RESPONSE_FORBIDDEN:
+		case TELEGRAM_RESPONSE_CHAT_NOT_FOUND:
+		case TELEGRAM_RESPONSE_MIGRATED:
+			return true;
+
+		default:
+			return false;
+	}
+}
+
+void telegram_deadchat_add(void *set_ptr, telegram_int_t chat_id, int32_t error_code)
+{
+	telegram_deadchat_t *set = (telegram_deadchat_t *)set_ptr;
+	telegram_deadchat_entry_t *entry = NULL;
+	telegram_deadchat_entry_t *slot = NULL;
+	uint32_t now = telegram_deadchat_now();
+	uint32_t pos;
+	uint32_t i;
+
+	if ((set == NULL) || (chat_id == 0))
+	{
+		return;
+	}
+
+	pos = telegram_deadchat_hash((int64_t)chat_id);
+	portENTER_CRITICAL(&set->lock);
+	entry = telegram_deadchat_find(set, (int64_t)chat_id, now);
+	if (entry == NULL)
+	{
+		/* First free or expired slot, otherwise the one which expires first */
+		for (i = 0; (i < TELEGRAM_DEADCHAT_PROBE) && (i <= set->mask); i++)
+		{
+			slot = &set->entries[(pos + i) & set->mask];
+			if ((slot->chat_id == 0) || (slot->expires <= now))
+			{
+				entry = slot;
+				break;
+			}
+
+			if ((entry == NULL) || (slot->expires < entry->expires))
+			{
+				entry = slot;
+			}
+		}
+
+		if ((entry->chat_id != 0) && (entry->expires > now))
+		{
+			set->stats.evicted++;
+		}
+
+		entry->chat_id = (int64_t)chat_id;
+		set->stats.added++;
+	}
+
+	entry->expires = now + set->ttl;
+	entry->error_code = error_code;
+	portEXIT_CRITICAL(&set->lock);
+}
+
+int32_t telegram_deadchat_check(void *set_ptr, telegram_int_t chat_id)
+{
+	telegram_deadchat_t *set = (telegram_deadchat_t *)set_ptr;
+	telegram_deadchat_entry_t *entry = NULL;
+	int32_t ret = 0;
+
+	if ((set == NULL) || (chat_id == 0))
+	{
+		return 0;
+	}
+
+	portENTER_CRITICAL(&set->lock);
+	entry = telegram_deadchat_find(set, (int64_t)chat_id, telegram_deadchat_now());
+	if (entry != NULL)
+	{
+		set->stats.suppressed++;
+		ret = entry->error_code;
+	}
+	portEXIT_CRITICAL(&set->lock);
+
+	return ret;
+}
+
+void telegram_deadchat_remove(void *set_ptr, telegram_int_t chat_id)
+{
+	telegram_deadchat_t *set = (telegram_deadchat_t *)set_ptr;
+	telegram_deadchat_entry_t *entry = NULL;
+
+	if (set == NULL)
+	{
+		return;
+	}
+
+	portENTER_CRITICAL(&set->lock);
+	entry = telegram_deadchat_find(set, (int64_t)chat_id, telegram_deadchat_now());
+	if (entry != NULL)
+	{
+		memset(entry, 0, sizeof(telegram_deadchat_entry_t));
+	}
+	portEXIT_CRITICAL(&set->lock);
+}
+
+void telegram_deadchat_clear(void *set_ptr)
+{
+	telegram_deadchat_t *set = (telegram_deadchat_t *)set_ptr;
+
+	if (set == NULL)
+	{
+		return;
+	}
+
+	portENTER_CRITICAL(&set->lock);
+	memset(set->entries, 0, (set->mask + 1) * sizeof(telegram_deadchat_entry_t));
+	portEXIT_CRITICAL(&set->lock);
+}
+
+void telegram_deadchat_get_stats(void *set_ptr, telegram_deadchat_stats_t *stats)
+{
+	telegram_deadchat_t *set = (telegram_deadchat_t *)set_ptr;
+	uint32_t now = telegram_deadchat_now();
+	uint32_t i;
+
+	if (stats == NULL)
+	{
+		return;
+	}
+
+	if (set == NULL)
+	{
+		memset(stats, 0, sizeof(telegram_deadchat_stats_t));
+		return;
+	}
+
+	portENTER_CRITICAL(&set->lock);
+	*stats = set->stats;
+	stats->entries = 0;
+	for (i = 0; i <= set->mask; i++)
+	{
+		if ((set->entries[i].chat_id != 0) && (set->entries[i].expires > now))
+		{
+			stats->entries++;
+		}
+	}
+	portEXIT_CRITICAL(&set->lock);
+}
+
+void telegram_deadchat_free(void *set_ptr)
+{
+	telegram_deadchat_t *set = (telegram_deadchat_t *)set_ptr;
+
+	if (set == NULL)
+	{
+		return;
+	}
+
+	telegram_free_tag(TELEGRAM_MEM_CORE, set->entries);
+	telegram_free_tag(TELEGRAM_MEM_CORE, set);
+}
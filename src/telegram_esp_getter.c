@@ -2,6 +2,7 @@
 #include <freertos/timers.h>
 #include <esp_log.h>
 #include "telegram_getter.h"
+#include "telegram_mem.h"
 
 static const char *TAG="telegram_esp_get";
 
@@ -55,7 +56,7 @@ void *telegram_getter_init(telegram_getMessages_t onGetMessages, void *ctx)
 		return NULL;
 	} 
 
-	teleCtx = calloc(1, sizeof(telegram_getter_t));
+	teleCtx = telegram_calloc(TELEGRAM_MEM_CORE, 1, sizeof(telegram_getter_t));
 	if (teleCtx != NULL)
 	{
 		teleCtx->onGetMessages = onGetMessages;
@@ -88,5 +89,5 @@ void telegram_getter_stop(void *teleCtx_ptr)
 #if TELEGRAM_LONG_POLLING != 1
 	xTimerDelete(teleCtx->timer, 0);
 #endif
-	free(teleCtx);
+	telegram_free_tag(TELEGRAM_MEM_CORE, teleCtx);
 }
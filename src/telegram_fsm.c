@@ -0,0 +1,396 @@
+#include <string.h>
+#include <esp_log.h>
+#include "telegram_fsm.h"
+#include "telegram_mem.h"
+#include "telegram_hash.h"
+
+#define TELEGRAM_FSM_EMPTY (UINT32_MAX)
+
+static const char *TAG="telegram_fsm";
+
+typedef struct
+{
+	uint32_t hash;
+	uint32_t idx;  /** Index of the transition or TELEGRAM_FSM_EMPTY */
+} telegram_fsm_slot_t;
+
+typedef struct
+{
+	telegram_fsm_def_t def;
+	telegram_session_cfg_t store_cfg; /** User persistence callbacks */
+	void *states;                     /** Session store, one byte of state per chat */
+	uint32_t mask;
+	telegram_fsm_slot_t *table;
+} telegram_fsm_t;
+
+static uint32_t telegram_fsm_hash(telegram_fsm_state_t from, telegram_fsm_on_t on, const char *match, uint32_t len)
+{
+	uint8_t key[] = {(uint8_t)from, (uint8_t)on};
+
+	return telegram_hash(telegram_hash(TELEGRAM_HASH_INIT, key, sizeof(key)), match, len);
+}
+
+static bool telegram_fsm_match_eq(const char *decl, const char *match, uint32_t len)
+{
+	if ((decl == NULL) || (decl[0] == '\0'))
+	{
+		return (len == 0);
+	}
+
+	return (strlen(decl) == len) && !memcmp(decl, match, len);
+}
+
+static const telegram_fsm_transition_t *telegram_fsm_find(telegram_fsm_t *fsm, telegram_fsm_state_t from,
+	telegram_fsm_on_t on, const char *match, uint32_t len)
+{
+	const telegram_fsm_transition_t *tr = NULL;
+	uint32_t hash = telegram_fsm_hash(from, on, match, len);
+	uint32_t i = hash & fsm->mask;
+
+	while (fsm->table[i].idx != TELEGRAM_FSM_EMPTY)
+	{
+		tr = &fsm->def.transitions[fsm->table[i].idx];
+		if ((fsm->table[i].hash == hash) && (tr->from == from) && (tr->on == on)
+			&& telegram_fsm_match_eq((on == TELEGRAM_FSM_ON_ANY) ? NULL : tr->match, match, len))
+		{
+			return tr;
+		}
+
+		i = (i + 1) & fsm->mask;
+	}
+
+	return NULL;
+}
+
+static bool telegram_fsm_insert(telegram_fsm_t *fsm, uint32_t idx)
+{
+	const telegram_fsm_transition_t *tr = &fsm->def.transitions[idx];
+	uint32_t len = (tr->match != NULL) ? strlen(tr->match) : 0;
+	uint32_t hash;
+	uint32_t i;
+
+	if (((tr->from >= TELEGRAM_FSM_MAX_STATES) && (tr->from != TELEGRAM_FSM_ANY))
+		|| ((tr->to >= TELEGRAM_FSM_MAX_STATES) && (tr->to != TELEGRAM_FSM_SAME)) || (tr->on >= TELEGRAM_FSM_ON_COUNT))
+	{
+		ESP_LOGE(TAG, "Bad transition %u", idx);
+		return false;
+	}
+
+	if (tr->on == TELEGRAM_FSM_ON_ANY)
+	{
+		len = 0;
+	}
+
+	/* First declared transition wins */
+	if (telegram_fsm_find(fsm, tr->from, tr->on, tr->match, len) != NULL)
+	{
+		return true;
+	}
+
+	hash = telegram_fsm_hash(tr->from, tr->on, tr->match, len);
+	i = hash & fsm->mask;
+	while (fsm->table[i].idx != TELEGRAM_FSM_EMPTY)
+	{
+		i = (i + 1) & fsm->mask;
+	}
+
+	fsm->table[i].hash = hash;
+	fsm->table[i].idx = idx;
+	return true;
+}
+
+static bool telegram_fsm_load(void *ctx, int64_t id, void *data, uint32_t size)
+{
+	telegram_fsm_t *fsm = (telegram_fsm_t *)ctx;
+
+	if ((fsm->store_cfg.load == NULL) || !fsm->store_cfg.load(fsm->store_cfg.ctx, id, data, sizeof(telegram_fsm_state_t)))
+	{
+		*(telegram_fsm_state_t *)data = fsm->def.initial;
+	}
+
+	return true;
+}
+
+static void telegram_fsm_save(void *ctx, int64_t id, const void *data, uint32_t size)
+{
+	telegram_fsm_t *fsm = (telegram_fsm_t *)ctx;
+
+	if (fsm->store_cfg.save != NULL)
+	{
+		fsm->store_cfg.save(fsm->store_cfg.ctx, id, data, sizeof(telegram_fsm_state_t));
+	}
+}
+
+void *telegram_fsm_init(const telegram_fsm_def_t *def, const telegram_session_cfg_t *store_cfg)
+{
+	uint32_t i;
+	uint32_t table_size = 1;
+	telegram_session_cfg_t cfg = {0};
+	telegram_fsm_t *fsm = NULL;
+
+	if ((def == NULL) || (def->transitions == NULL) || (def->count == 0) || (def->initial >= TELEGRAM_FSM_MAX_STATES))
+	{
+		return NULL;
+	}
+
+	fsm = telegram_calloc(TELEGRAM_MEM_CORE, 1, sizeof(telegram_fsm_t));
+	if (fsm == NULL)
+	{
+		ESP_LOGE(TAG, "No mem!");
+		return NULL;
+	}
+
+	fsm->def = *def;
+	if (store_cfg != NULL)
+	{
+		fsm->store_cfg = *store_cfg;
+	}
+
+	while (table_size < (def->count * 2))
+	{
+		table_size <<= 1;
+	}
+
+	fsm->mask = table_size - 1;
+	fsm->table = telegram_malloc(TELEGRAM_MEM_CORE, table_size * sizeof(telegram_fsm_slot_t));
+	if (fsm->table == NULL)
+	{
+		ESP_LOGE(TAG, "No mem!");
+		telegram_fsm_free(fsm);
+		return NULL;
+	}
+
+	memset(fsm->table, 0xFF, table_size * sizeof(telegram_fsm_slot_t));
+	for (i = 0; i < def->count; i++)
+	{
+		if (!telegram_fsm_insert(fsm, i))
+		{
+			telegram_fsm_free(fsm);
+			return NULL;
+		}
+	}
+
+	cfg = fsm->store_cfg;
+	cfg.data_size = sizeof(telegram_fsm_state_t);
+	cfg.load = telegram_fsm_load;
+	cfg.save = telegram_fsm_save;
+	cfg.ctx = fsm;
+	fsm->states = telegram_session_init(&cfg);
+	if (fsm->states == NULL)
+	{
+		telegram_fsm_free(fsm);
+		return NULL;
+	}
+
+	return fsm;
+}
+
+static const telegram_fsm_transition_t *telegram_fsm_lookup(telegram_fsm_t *fsm, telegram_fsm_state_t state,
+	telegram_fsm_on_t on, const char *match, uint32_t len)
+{
+	const telegram_fsm_transition_t *tr = NULL;
+
+	if (on != TELEGRAM_FSM_ON_ANY)
+	{
+		if (len != 0)
+		{
+			tr = telegram_fsm_find(fsm, state, on, match, len);
+			if (tr == NULL)
+			{
+				tr = telegram_fsm_find(fsm, TELEGRAM_FSM_ANY, on, match, len);
+			}
+		}
+
+		if (tr == NULL)
+		{
+			tr = telegram_fsm_find(fsm, state, on, NULL, 0);
+		}
+
+		if (tr == NULL)
+		{
+			tr = telegram_fsm_find(fsm, TELEGRAM_FSM_ANY, on, NULL, 0);
+		}
+	}
+
+	if (tr == NULL)
+	{
+		tr = telegram_fsm_find(fsm, state, TELEGRAM_FSM_ON_ANY, NULL, 0);
+	}
+
+	if (tr == NULL)
+	{
+		tr = telegram_fsm_find(fsm, TELEGRAM_FSM_ANY, TELEGRAM_FSM_ON_ANY, NULL, 0);
+	}
+
+	return tr;
+}
+
+/** Classify the message, match points into the text, arg is set to the rest */
+static telegram_fsm_on_t telegram_fsm_classify_msg(telegram_chat_message_t *msg, const char **match, uint32_t *len,
+	const char **arg)
+{
+	const char *text = msg->text;
+
+	if ((text != NULL) && (text[0] == '/'))
+	{
+		*match = text;
+		*len = strcspn(text, " @");
+		*arg = text + strcspn(text, " ");
+		while (**arg == ' ')
+		{
+			(*arg)++;
+		}
+
+		return TELEGRAM_FSM_ON_COMMAND;
+	}
+
+	if (text != NULL)
+	{
+		return TELEGRAM_FSM_ON_TEXT;
+	}
+
+	if (msg->file != NULL)
+	{
+		return TELEGRAM_FSM_ON_DOCUMENT;
+	}
+
+	if (msg->photo_count != 0)
+	{
+		return TELEGRAM_FSM_ON_PHOTO;
+	}
+
+	if (msg->location != NULL)
+	{
+		return TELEGRAM_FSM_ON_LOCATION;
+	}
+
+	if (msg->contact != NULL)
+	{
+		return TELEGRAM_FSM_ON_CONTACT;
+	}
+
+	return TELEGRAM_FSM_ON_ANY;
+}
+
+bool telegram_fsm_dispatch(void *fsm_ptr, void *teleCtx, telegram_update_t *upd)
+{
+	telegram_fsm_t *fsm = (telegram_fsm_t *)fsm_ptr;
+	telegram_chat_message_t *msg = NULL;
+	const telegram_fsm_transition_t *tr = NULL;
+	telegram_fsm_event_t evt = {0};
+	telegram_fsm_state_t next;
+	const char *match = NULL;
+	const char *sep = NULL;
+	uint32_t len = 0;
+
+	if ((fsm == NULL) || (upd == NULL))
+	{
+		return false;
+	}
+
+	evt.arg = "";
+	if (upd->callback_query != NULL)
+	{
+		evt.on = TELEGRAM_FSM_ON_CALLBACK;
+		msg = upd->callback_query->message;
+		evt.chat_id = telegram_get_chat_id(msg);
+		if ((evt.chat_id == -1) && (upd->callback_query->from != NULL))
+		{
+			evt.chat_id = upd->callback_query->from->id;
+		}
+
+		match = upd->callback_query->data;
+		if (match != NULL)
+		{
+			sep = strchr(match, TELEGRAM_FSM_CB_SEP);
+			len = (sep != NULL) ? (uint32_t)(sep - match) : strlen(match);
+			evt.arg = (sep != NULL) ? (sep + 1) : "";
+		}
+	} else
+	{
+		msg = telegram_get_message(upd);
+		if (msg == NULL)
+		{
+			return false;
+		}
+
+		evt.chat_id = telegram_get_chat_id(msg);
+		evt.on = telegram_fsm_classify_msg(msg, &match, &len, &evt.arg);
+	}
+
+	if (evt.chat_id == -1)
+	{
+		return false;
+	}
+
+	evt.state = telegram_fsm_get_state(fsm, evt.chat_id);
+	tr = telegram_fsm_lookup(fsm, evt.state, evt.on, match, len);
+	if (tr == NULL)
+	{
+		return false;
+	}
+
+	next = tr->to;
+	if (tr->action != NULL)
+	{
+		telegram_fsm_state_t res = tr->action(teleCtx, upd, &evt, fsm->def.ctx);
+
+		if (res != TELEGRAM_FSM_DEFAULT)
+		{
+			next = res;
+		}
+	}
+
+	if (next != TELEGRAM_FSM_SAME)
+	{
+		telegram_fsm_set_state(fsm, evt.chat_id, next);
+	}
+
+	return true;
+}
+
+telegram_fsm_state_t telegram_fsm_get_state(void *fsm_ptr, telegram_int_t chat_id)
+{
+	telegram_fsm_t *fsm = (telegram_fsm_t *)fsm_ptr;
+	telegram_fsm_state_t *state = NULL;
+
+	if (fsm == NULL)
+	{
+		return TELEGRAM_FSM_ANY;
+	}
+
+	state = telegram_session_get(fsm->states, (int64_t)chat_id, true);
+	return (state != NULL) ? *state : fsm->def.initial;
+}
+
+void telegram_fsm_set_state(void *fsm_ptr, telegram_int_t chat_id, telegram_fsm_state_t state)
+{
+	telegram_fsm_t *fsm = (telegram_fsm_t *)fsm_ptr;
+	telegram_fsm_state_t *cur = NULL;
+
+	if ((fsm == NULL) || (state >= TELEGRAM_FSM_MAX_STATES))
+	{
+		return;
+	}
+
+	cur = telegram_session_get(fsm->states, (int64_t)chat_id, true);
+	if ((cur != NULL) && (*cur != state))
+	{
+		*cur = state;
+		telegram_session_mark_dirty(fsm->states, cur);
+	}
+}
+
+void telegram_fsm_free(void *fsm_ptr)
+{
+	telegram_fsm_t *fsm = (telegram_fsm_t *)fsm_ptr;
+
+	if (fsm == NULL)
+	{
+		return;
+	}
+
+	telegram_session_free(fsm->states);
+	telegram_free_tag(TELEGRAM_MEM_CORE, fsm->table);
+	telegram_free_tag(TELEGRAM_MEM_CORE, fsm);
+}
@@ -0,0 +1,26 @@
+#include <stddef.h>
+#include "telegram_hash.h"
+
+#define TELEGRAM_HASH_PRIME (16777619U)
+
+uint32_t telegram_hash(uint32_t hash, const void *data, uint32_t len)
+{
+	const uint8_t *bytes = (const uint8_t *)data;
+
+	while (len--)
+	{
+		hash = (hash ^ *bytes++) * TELEGRAM_HASH_PRIME;
+	}
+
+	return hash;
+}
+
+uint32_t telegram_hash_str(uint32_t hash, const char *str)
+{
+	while ((str != NULL) && (*str != '\0'))
+	{
+		hash = (hash ^ (uint8_t)*str++) * TELEGRAM_HASH_PRIME;
+	}
+
+	return hash;
+}
@@ -0,0 +1,224 @@
+#include <string.h>
+#include <esp_log.h>
+#include "telegram.h"
+#include "telegram_img.h"
+#include "telegram_mem.h"
+
+#if TELEGRAM_IMG_TRANSFORM == 1
+#define MIN(x, y) (((x) < (y))?(x):(y))
+/** Decoded frame size, rounded up as the decoder writes partial blocks */
+#define TELEGRAM_IMG_FRAME_LEN(w, h, s) ((((w) + (1U << (s)) - 1) >> (s)) * (((h) + (1U << (s)) - 1) >> (s)) * 2U)
+
+static const char *TAG="telegram_img";
+
+typedef struct
+{
+	uint8_t *buf;
+	size_t size;
+	size_t len;
+	bool overflow;
+} telegram_img_out_t;
+
+/** Reads frame size from the SOFn segment */
+static bool telegram_img_jpeg_size(const uint8_t *jpg, uint32_t len, uint16_t *width, uint16_t *height)
+{
+	uint8_t marker;
+	uint32_t pos = 2;
+
+	if ((len < 4) || (jpg[0] != 0xFF) || (jpg[1] != 0xD8))
+	{
+		return false;
+	}
+
+	while ((pos + 9) < len)
+	{
+		if (jpg[pos] != 0xFF)
+		{
+			return false;
+		}
+
+		marker = jpg[pos + 1];
+		if (marker == 0xFF)
+		{
+			pos++;
+			continue;
+		}
+
+		if ((marker >= 0xC0) && (marker <= 0xCF) && (marker != 0xC4) && (marker != 0xC8) && (marker != 0xCC))
+		{
+			*height = (jpg[pos + 5] << 8) | jpg[pos + 6];
+			*width = (jpg[pos + 7] << 8) | jpg[pos + 8];
+			return true;
+		}
+
+		pos += 2 + ((jpg[pos + 2] << 8) | jpg[pos + 3]);
+	}
+
+	return false;
+}
+
+static size_t telegram_img_out_cb(void *arg, size_t index, const void *data, size_t len)
+{
+	telegram_img_out_t *out = (telegram_img_out_t *)arg;
+
+	if ((index + len) > out->size)
+	{
+		out->overflow = true;
+		return 0;
+	}
+
+	memcpy(&out->buf[index], data, len);
+	out->len = index + len;
+	return len;
+}
+
+/** Encodes into the bounded buffer, lowering quality if the result does not fit */
+static bool telegram_img_encode(const uint8_t *src, uint32_t len, uint16_t width, uint16_t height, pixformat_t format, 
+	uint8_t quality, telegram_img_out_t *out)
+{
+	uint32_t attempt;
+
+	for (attempt = 0; attempt < TELEGRAM_IMG_ENCODE_ATTEMPTS; attempt++)
+	{
+		out->len = 0;
+		out->overflow = false;
+		if (fmt2jpg_cb((uint8_t *)src, len, width, height, format, quality, telegram_img_out_cb, out) && !out->overflow)
+		{
+			return true;
+		}
+
+		if (!out->overflow || (quality <= 10))
+		{
+			break;
+		}
+
+		ESP_LOGW(TAG, "%ux%u q%u does not fit into %u bytes", width, height, quality, out->size);
+		quality /= 2;
+	}
+
+	return false;
+}
+
+static void telegram_img_defaults(const telegram_img_cfg_t *cfg, telegram_img_cfg_t *res)
+{
+	memset(res, 0, sizeof(telegram_img_cfg_t));
+	if (cfg != NULL)
+	{
+		*res = *cfg;
+	}
+
+	if ((res->quality == 0) || (res->quality > 100))
+	{
+		res->quality = TELEGRAM_IMG_QUALITY;
+	}
+
+	if (res->work_budget == 0)
+	{
+		res->work_budget = TELEGRAM_IMG_WORK_BUDGET;
+	}
+
+	if (res->out_budget == 0)
+	{
+		res->out_budget = TELEGRAM_IMG_OUT_BUDGET;
+	}
+}
+
+bool telegram_send_photo_raw(void *teleCtx_ptr, telegram_int_t chat_id, const char *caption, const char *filename,
+	const uint8_t *frame, uint32_t len, uint16_t width, uint16_t height, pixformat_t format, const telegram_img_cfg_t *cfg)
+{
+	bool res = false;
+	telegram_img_cfg_t conf;
+	telegram_img_out_t out = {0};
+
+	if ((teleCtx_ptr == NULL) || (frame == NULL) || (len == 0))
+	{
+		ESP_LOGE(TAG, "Wrong argument");
+		return false;
+	}
+
+	telegram_img_defaults(cfg, &conf);
+	out.size = conf.out_budget;
+	out.buf = telegram_malloc(TELEGRAM_MEM_CORE, out.size);
+	if (out.buf == NULL)
+	{
+		ESP_LOGE(TAG, "No mem!");
+		return false;
+	}
+
+	if (telegram_img_encode(frame, len, width, height, format, conf.quality, &out))
+	{
+		res = telegram_send_file_mem(teleCtx_ptr, chat_id, caption, filename, out.buf, out.len, TELEGRAM_PHOTO);
+	} else
+	{
+		ESP_LOGE(TAG, "Failed to encode frame");
+	}
+
+	telegram_free_tag(TELEGRAM_MEM_CORE, out.buf);
+	return res;
+}
+
+bool telegram_send_photo_jpeg(void *teleCtx_ptr, telegram_int_t chat_id, const char *caption, const char *filename,
+	const uint8_t *jpg, uint32_t len, const telegram_img_cfg_t *cfg)
+{
+	bool res = false;
+	uint16_t width = 0;
+	uint16_t height = 0;
+	uint32_t scale = JPG_SCALE_NONE;
+	uint32_t frame_len = 0;
+	uint8_t *frame = NULL;
+	telegram_img_cfg_t conf;
+	telegram_img_out_t out = {0};
+
+	if ((teleCtx_ptr == NULL) || (jpg == NULL) || (len == 0))
+	{
+		ESP_LOGE(TAG, "Wrong argument");
+		return false;
+	}
+
+	telegram_img_defaults(cfg, &conf);
+	if (!telegram_img_jpeg_size(jpg, len, &width, &height))
+	{
+		ESP_LOGW(TAG, "Not a JPEG, sent as is");
+		return telegram_send_file_mem(teleCtx_ptr, chat_id, caption, filename, jpg, len, TELEGRAM_PHOTO);
+	}
+
+	/* 1/8 is the smallest scale of the decoder, it is used even if the width is still over the limit */
+	for (scale = JPG_SCALE_NONE; scale < JPG_SCALE_8X; scale++)
+	{
+		if (((conf.max_width == 0) || ((width >> scale) <= conf.max_width)) 
+			&& (TELEGRAM_IMG_FRAME_LEN(width, height, scale) <= conf.work_budget))
+		{
+			break;
+		}
+	}
+
+	frame_len = TELEGRAM_IMG_FRAME_LEN(width, height, scale);
+	if (frame_len <= conf.work_budget)
+	{
+		frame = telegram_malloc(TELEGRAM_MEM_CORE, frame_len);
+		out.size = MIN(conf.out_budget, len);
+		out.buf = telegram_malloc(TELEGRAM_MEM_CORE, out.size);
+	}
+
+	/* Result larger than the source is useless, the source is sent then */
+	if ((frame != NULL) && (out.buf != NULL) && jpg2rgb565(jpg, len, frame, (jpg_scale_t)scale) 
+		&& telegram_img_encode(frame, (width >> scale) * (height >> scale) * 2, width >> scale, height >> scale, PIXFORMAT_RGB565, conf.quality, &out))
+	{
+		telegram_free_tag(TELEGRAM_MEM_CORE, frame);
+		frame = NULL;
+		ESP_LOGD(TAG, "%ux%u %u -> %ux%u %u", width, height, len, width >> scale, height >> scale, out.len);
+		res = telegram_send_file_mem(teleCtx_ptr, chat_id, caption, filename, out.buf, out.len, TELEGRAM_PHOTO);
+	} else
+	{
+		ESP_LOGW(TAG, "Transform of %ux%u failed, sent as is", width, height);
+		telegram_free_tag(TELEGRAM_MEM_CORE, frame);
+		frame = NULL;
+		telegram_free_tag(TELEGRAM_MEM_CORE, out.buf);
+		out.buf = NULL;
+		res = telegram_send_file_mem(teleCtx_ptr, chat_id, caption, filename, jpg, len, TELEGRAM_PHOTO);
+	}
+
+	telegram_free_tag(TELEGRAM_MEM_CORE, out.buf);
+	return res;
+}
+#endif
@@ -1,11 +1,24 @@
 #include <string.h>
+#include <stdio.h>
 #include <esp_log.h>
 #include <esp_http_client.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
 #include "telegram_io.h"
+#include "telegram_mem.h"
+#include "telegram_trace.h"
 
 #define MIN(x, y) (((x) < (y))?(x):(y))
 
 static const char *TAG="telegram_io";
+
+/** Connection kept open between requests made with the same io context */
+typedef struct
+{
+    esp_http_client_handle_t client;
+    int64_t last_us; /** When the previous request completed, 0 - not connected */
+} telegram_io_conn_t;
 #if TELGRAM_DBG == 1
 static esp_err_t telegram_http_event_handler(esp_http_client_event_t *evt);
 #endif
@@ -55,7 +68,7 @@ static esp_err_t telegram_http_event_handler(esp_http_client_event_t *evt)
 }
 #endif
 
-static char *telegram_io_read_all_content(esp_http_client_handle_t client)
+static char *telegram_io_read_all_content(esp_http_client_handle_t client, telegram_io_info_t *info)
 {
     int data_read;
     char *buffer = NULL;
@@ -72,7 +85,7 @@ static char *telegram_io_read_all_content(esp_http_client_handle_t client)
         return NULL;
     }     
 
-    buffer = calloc(1, content_length + 1);
+    buffer = telegram_calloc(TELEGRAM_MEM_IO, 1, content_length + 1);
     if (buffer == NULL)
     {
         ESP_LOGE(TAG, "No mem!");
@@ -81,20 +94,39 @@ static char *telegram_io_read_all_content(esp_http_client_handle_t client)
 
     do
     {
-        data_read = esp_http_client_read(client, &buffer[total_data_read], content_length);
+        data_read = esp_http_client_read(client, &buffer[total_data_read], content_length - total_data_read);
         if (data_read < 0)
         {
             ESP_LOGE(TAG, "Data read error: %d %d", data_read, total_data_read);
             break;
         }
         total_data_read += data_read;
-    } while(data_read != 0);
+    } while((data_read != 0) && (total_data_read < content_length));
+
+    info->bytes_in += total_data_read;
+    TELEGRAM_TRACE(TELEGRAM_TRACE_BODY, info->req_id, total_data_read);
 #if TELGRAM_DBG == 1
     ESP_LOGI(TAG, "%s", buffer);
 #endif
     return buffer;
 }
 
+static void telegram_io_report(telegram_io_info_t *info, telegram_io_info_t *stat, int64_t start)
+{
+    stat->total_us = esp_timer_get_time() - start;
+    if (info)
+    {
+        *info = *stat;
+    }
+}
+
+static void telegram_io_report_err(telegram_io_info_t *info, esp_err_t err)
+{
+    telegram_io_info_t stat = {.req_id = info?info->req_id:0, .err = err};
+
+    telegram_io_report(info, &stat, esp_timer_get_time());
+}
+
 static esp_err_t telegram_io_set_headers(esp_http_client_handle_t client, telegram_io_header_t *headers)
 {
     esp_err_t err = ESP_OK;
@@ -143,285 +175,557 @@ static esp_err_t telegram_io_prepare(esp_http_client_handle_t client, char *path
     return err;
 }
 
-static char *telegram_io_send_data(void **io_ctx, const char *path, uint32_t total_len, telegram_io_header_t *headers, 
-    esp_http_client_method_t method, const char *post_field, void *ctx, telegram_io_send_file_cb_t cb)
+static telegram_io_conn_t *telegram_io_conn_get(void **io_ctx)
 {
-    char *response = NULL;
-    esp_err_t err;
-    esp_http_client_handle_t client = NULL;
-    uint32_t len_to_send = total_len;
+    telegram_io_conn_t *conn = (telegram_io_conn_t *)*io_ctx;
 
-    if (io_ctx)
+    if (conn != NULL)
     {
-        client = (esp_http_client_handle_t)*io_ctx;
+        return conn;
     }
 
+    conn = telegram_calloc(TELEGRAM_MEM_IO, 1, sizeof(telegram_io_conn_t));
+    if (conn == NULL)
+    {
+        ESP_LOGE(TAG, "No mem!");
+        return NULL;
+    }
 
-    if (client == NULL)
+    conn->client = esp_http_client_init(&telegram_io_http_cfg);
+    if (conn->client == NULL)
     {
-        client = esp_http_client_init(&telegram_io_http_cfg);
-        if (client == NULL)
-        {
-            ESP_LOGE(TAG, "Failed to init http client");
-            return NULL; 
-        }
+        ESP_LOGE(TAG, "Failed to init http client");
+        telegram_free_tag(TELEGRAM_MEM_IO, conn);
+        return NULL;
+    }
 
-        if (io_ctx)
-        {
-            *io_ctx = client;
-        }
+    *io_ctx = conn;
+    return conn;
+}
+
+/** Keeps connection of the context open if the response was read completely, closes it otherwise */
+static void telegram_io_release(esp_http_client_handle_t client, telegram_io_conn_t *conn, bool keep)
+{
+    if ((conn != NULL) && keep && esp_http_client_is_complete_data_received(client))
+    {
+        conn->last_us = esp_timer_get_time();
+        return;
     }
 
-    err = telegram_io_prepare(client, (char *)path, method, headers);
-    if (err != ESP_OK)
+    esp_http_client_close(client);
+    if (conn == NULL)
     {
-        ESP_LOGE(TAG, "telegram_io_prepare failed err %d", err);
+        esp_http_client_cleanup(client);
+    } else
+    {
+        conn->last_us = 0;
+    }
+}
+
+/**
+ Writes memory region as is or pulls it chunk by chunk into the scratch buffer, allocated on first use.
+ A producer returning 0 ends the whole body (ended is set), like telegram_io_send_big always did.
+*/
+static esp_err_t telegram_io_write_part(esp_http_client_handle_t client, const telegram_io_part_t *part, 
+    char **buffer, telegram_io_info_t *stat, bool *ended)
+{
+    int send_len;
+    uint32_t max_size = 0;
+    uint32_t chunk_size = 0;
+    uint32_t offset = 0;
 
-        if (io_ctx == NULL)
+    if (part->data != NULL)
+    {
+        while (offset < part->len)
         {
-            esp_http_client_cleanup(client);
+            send_len = esp_http_client_write(client, (const char *)&part->data[offset], part->len - offset);
+            if (send_len <= 0)
+            {
+                ESP_LOGE(TAG, "Error during esp_http_client_write %d", send_len);
+                return ESP_ERR_HTTP_WRITE_DATA;
+            }
+
+            stat->bytes_out += send_len;
+            offset += send_len;
         }
-        return NULL;
+
+        return ESP_OK;
     }
 
-    if (post_field)
+    if (part->cb == NULL)
     {
-        len_to_send += strlen(post_field);
+        return (part->len == 0)?ESP_OK:ESP_ERR_INVALID_ARG;
     }
 
-    err = esp_http_client_open(client, len_to_send);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "esp_http_client_connect failed err %d", err);
-        if (io_ctx == NULL)
+    if (*buffer == NULL)
+    {
+        *buffer = telegram_malloc(TELEGRAM_MEM_IO, TELEGRAM_MAX_BUFFER);
+        if (*buffer == NULL)
         {
-            esp_http_client_cleanup(client);
+            ESP_LOGE(TAG, "No mem!");
+            return ESP_ERR_NO_MEM;
         }
-        return NULL;
     }
 
-    if (post_field)
+    while (offset < part->len)
     {
-        int send_len = esp_http_client_write(client, post_field, strlen(post_field));
-        if (send_len != strlen(post_field)) 
+        max_size = MIN(part->len - offset, TELEGRAM_MAX_BUFFER);
+        chunk_size = part->cb(part->ctx, (uint8_t *)*buffer, max_size, offset);
+
+        ESP_LOGD(TAG, "chunk_size %d max_size %d total_len %d offset %d", chunk_size, max_size, part->len, offset);
+        if (chunk_size > max_size)
+        {
+            ESP_LOGE(TAG, "chunk_size > max_size");
+            return ESP_ERR_INVALID_SIZE;
+        }
+
+        if (chunk_size == 0) 
         {
-            ESP_LOGW(TAG, "esp_http_client_write send_len != strlen(post_field)  %d", send_len);
+            ESP_LOGW(TAG, "Producer stopped at %d of %d", offset, part->len);
+            *ended = true;
+            return ESP_OK;
         }
 
-        if (send_len < 0)
+        send_len = esp_http_client_write(client, *buffer, chunk_size);
+        if (send_len != chunk_size) 
         {
-            ESP_LOGE(TAG, "Error during esp_http_client_write post_field");
-            err = ESP_ERR_INVALID_SIZE;
+            ESP_LOGE(TAG, "esp_http_client_write send_len != chunk_size %d", send_len);
+            return ESP_ERR_HTTP_WRITE_DATA;
         }
+
+        stat->bytes_out += send_len;
+        offset += chunk_size;
     }
 
+    return ESP_OK;
+}
+
+static char *telegram_io_send_data(void **io_ctx, const char *path, telegram_io_header_t *headers, 
+    esp_http_client_method_t method, const telegram_io_part_t *parts, uint32_t count, telegram_io_info_t *info)
+{
+    char *response = NULL;
+    char *buffer = NULL;
+    esp_err_t err;
+    uint32_t i;
+    esp_http_client_handle_t client = NULL;
+    telegram_io_conn_t *conn = NULL;
+    uint32_t len_to_send = 0;
+    bool ended = false;
+    telegram_io_info_t stat = {.req_id = info?info->req_id:0};
+    int64_t start = esp_timer_get_time();
 
-    if ((err == ESP_OK) && (total_len != 0) && (cb != NULL))
+    if (io_ctx)
     {
-        int send_len;
-        uint32_t max_size = 0;
-        uint32_t chunk_size = 0;
-        uint32_t offset = 0;
-        char *buffer = malloc(TELEGRAM_MAX_BUFFER);
-        
-        if (buffer == NULL)
+        conn = telegram_io_conn_get(io_ctx);
+        if (conn == NULL)
         {
-            ESP_LOGE(TAG, "No mem!");
+            stat.err = ESP_ERR_NO_MEM;
+            telegram_io_report(info, &stat, start);
+            return NULL; 
+        }
+
+        client = conn->client;
+        if ((conn->last_us != 0) && ((start - conn->last_us) > TELEGRAM_IO_KEEP_ALIVE_IDLE_MS * 1000LL))
+        {
+            /* Server may have dropped the idle connection already, a request sent to it would be lost */
             esp_http_client_close(client);
-            if (io_ctx == NULL)
-            {
-                esp_http_client_cleanup(client);
-            }
-            return NULL;
+            conn->last_us = 0;
         }
 
-        while (total_len)
+        stat.reused = (conn->last_us != 0);
+    } else
+    {
+        client = esp_http_client_init(&telegram_io_http_cfg);
+        if (client == NULL)
         {
-            max_size = MIN(total_len, TELEGRAM_MAX_BUFFER);
-            chunk_size = cb(ctx, (uint8_t *)buffer, max_size, offset);
+            ESP_LOGE(TAG, "Failed to init http client");
+            stat.err = ESP_ERR_NO_MEM;
+            telegram_io_report(info, &stat, start);
+            return NULL; 
+        }
+    }
 
-            ESP_LOGI(TAG, "chunk_size %d max_size %d total_len %d offset %d", chunk_size, max_size, total_len, offset);
-            if (chunk_size > max_size)
-            {
-                err = ESP_ERR_INVALID_SIZE;
-                ESP_LOGE(TAG, "chunk_size > max_size");
-                break;
-            }
+    err = telegram_io_prepare(client, (char *)path, method, headers);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "telegram_io_prepare failed err %d", err);
+        telegram_io_release(client, conn, false);
+        stat.err = err;
+        telegram_io_report(info, &stat, start);
+        return NULL;
+    }
 
-            if (chunk_size == 0) 
-            {
-                break;
-            }
+    for (i = 0; i < count; i++)
+    {
+        len_to_send += parts[i].len;
+    }
 
-            offset += chunk_size;
-            send_len = esp_http_client_write(client, buffer, chunk_size);
-            if (send_len != chunk_size) 
-            {
-                ESP_LOGW(TAG, "esp_http_client_write send_len != chunk_size %d", send_len);
-            }
+    err = esp_http_client_open(client, len_to_send);
+    stat.connect_us = esp_timer_get_time() - start;
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "esp_http_client_connect failed err %d", err);
+        telegram_io_release(client, conn, false);
+        stat.err = err;
+        telegram_io_report(info, &stat, start);
+        return NULL;
+    }
 
-            if (send_len < 0)
-            {
-                ESP_LOGE(TAG, "Error during esp_http_client_write");
-                break;
-            }
+    for (i = 0; (i < count) && (err == ESP_OK) && !ended; i++)
+    {
+        err = telegram_io_write_part(client, &parts[i], &buffer, &stat, &ended);
+    }
 
+    telegram_free_tag(TELEGRAM_MEM_IO, buffer);
 
-            total_len -= chunk_size;
+    if (err == ESP_OK)
+    {
+        /* From here the server may have processed the request even if no answer is received */
+        stat.body_sent = !ended;
+        if (esp_http_client_fetch_headers(client) > 0)
+        {    
+            stat.first_byte_us = esp_timer_get_time() - start;
+            stat.status = esp_http_client_get_status_code(client);
+            TELEGRAM_TRACE(TELEGRAM_TRACE_HEADERS, stat.req_id, stat.status);
+            response = telegram_io_read_all_content(client, &stat); 
+        } else
+        {
+            err = ESP_ERR_HTTP_FETCH_HEADER;
         }
-
-        free(buffer);
     }
 
-    if ((err == ESP_OK) && (esp_http_client_fetch_headers(client) > 0))
-    {    
-        response = telegram_io_read_all_content(client); 
-    }
+    telegram_io_release(client, conn, (err == ESP_OK));
 
-    esp_http_client_close(client);
-    if (io_ctx == NULL)
-    {
-        esp_http_client_cleanup(client);
-    }
+    stat.err = err;
+    telegram_io_report(info, &stat, start);
+    TELEGRAM_TRACE(TELEGRAM_TRACE_SEND_DONE, stat.req_id, stat.status);
     return response;
 }
 
-char *telegram_io_get(const char *path, telegram_io_header_t *headers)
+char *telegram_io_get(const char *path, telegram_io_header_t *headers, telegram_io_info_t *info)
 {
     if (path == NULL)
     {
         ESP_LOGE(TAG, "Wrong arguments(get)");
+        telegram_io_report_err(info, ESP_ERR_INVALID_ARG);
         return NULL;
     }
 
-    return telegram_io_send_data(NULL, path, 0, headers,  HTTP_METHOD_GET,  NULL, NULL, NULL);
+    return telegram_io_send_data(NULL, path, headers,  HTTP_METHOD_GET,  NULL, 0, info);
 }
 
 
-char *telegram_io_get_ctx(void **io_ctx, const char *path, telegram_io_header_t *headers)
+char *telegram_io_get_ctx(void **io_ctx, const char *path, telegram_io_header_t *headers, telegram_io_info_t *info)
 {
     if (path == NULL)
     {
         ESP_LOGE(TAG, "Wrong arguments(get)");
+        telegram_io_report_err(info, ESP_ERR_INVALID_ARG);
         return NULL;
     }
 
-    return telegram_io_send_data(io_ctx, path, 0, headers,  HTTP_METHOD_GET,  NULL, NULL, NULL);
+    return telegram_io_send_data(io_ctx, path, headers,  HTTP_METHOD_GET,  NULL, 0, info);
 }
 
 void telegram_io_free_ctx(void **io_ctx)
 {
-    if (io_ctx == NULL)
+    telegram_io_conn_t *conn;
+
+    if ((io_ctx == NULL) || (*io_ctx == NULL))
     {
         return;
     }
 
-    esp_http_client_cleanup((esp_http_client_handle_t)*io_ctx);
+    conn = (telegram_io_conn_t *)*io_ctx;
+    esp_http_client_close(conn->client);
+    esp_http_client_cleanup(conn->client);
+    telegram_free_tag(TELEGRAM_MEM_IO, conn);
     *io_ctx = NULL;
 }
 
-void telegram_io_send(const char *path, const char *message, telegram_io_header_t *headers)
+char *telegram_io_send(const char *path, const char *message, telegram_io_header_t *headers, telegram_io_info_t *info)
 {
-    char *buffer;
+    telegram_io_part_t part = {0};
+
     if ((path == NULL) || (message == NULL))
     {
         ESP_LOGE(TAG, "Wrong arguments(send)");
-        return;
+        telegram_io_report_err(info, ESP_ERR_INVALID_ARG);
+        return NULL;
     }
 
-    ESP_LOGI(TAG, "Send message: %s", message);
+    ESP_LOGD(TAG, "Send message: %s", message);
+    part.data = (const uint8_t *)message;
+    part.len = strlen(message);
 
-    buffer = telegram_io_send_data(NULL, path, 0, headers,  HTTP_METHOD_POST,  (char *)message, NULL, NULL);
-    free(buffer);
+    return telegram_io_send_data(NULL, path, headers,  HTTP_METHOD_POST,  &part, 1, info);
 }
 
-char *telegram_io_send_big(const char *path, uint32_t total_len, telegram_io_header_t *headers, 
-    const char *post_field, void *ctx, telegram_io_send_file_cb_t cb)
+char *telegram_io_send_ctx(void **io_ctx, const char *path, const char *message, telegram_io_header_t *headers, 
+    telegram_io_info_t *info)
 {
-    if ((path == NULL) || (cb == NULL) || (total_len == 0))
+    telegram_io_part_t part = {0};
+
+    if ((path == NULL) || (message == NULL))
     {
-        ESP_LOGE(TAG, "Wrong arguments(send_big)");
+        ESP_LOGE(TAG, "Wrong arguments(send)");
+        telegram_io_report_err(info, ESP_ERR_INVALID_ARG);
         return NULL;
     }
 
-    return telegram_io_send_data(NULL, path, total_len, headers, HTTP_METHOD_POST, (char *)post_field, ctx, cb);
+    ESP_LOGD(TAG, "Send message: %s", message);
+    part.data = (const uint8_t *)message;
+    part.len = strlen(message);
+
+    return telegram_io_send_data(io_ctx, path, headers,  HTTP_METHOD_POST,  &part, 1, info);
 }
 
-void telegram_io_read_file(const char *file_path, void *ctx, telegram_io_get_file_cb_t cb)
+telegram_io_fail_t telegram_io_classify(const telegram_io_info_t *info)
 {
-    esp_err_t err;
-    int total_len;
-    int data_read;
-    uint8_t *buffer = NULL;
-    uint32_t buffer_size;
-    esp_http_client_handle_t client;
+    if (info == NULL)
+    {
+        return TELEGRAM_IO_FAIL_OTHER;
+    }
 
-    if ((file_path == NULL) || (cb == NULL))
+    if (info->status != 0)
     {
-        ESP_LOGE(TAG, "Wrong params");
-        return;    
+        if ((info->status >= 200) && (info->status < 300))
+        {
+            return TELEGRAM_IO_OK;
+        }
+
+        if (info->status == 429)
+        {
+            return TELEGRAM_IO_FAIL_FLOOD;
+        }
+
+        return (info->status >= 500)?TELEGRAM_IO_FAIL_SERVER:TELEGRAM_IO_FAIL_CLIENT;
     }
 
-    client = esp_http_client_init(&telegram_io_http_cfg);
-    if (client == NULL)
+    switch (info->err)
     {
-        ESP_LOGE(TAG, "Failed to init http client");
-        cb(ctx, buffer, -1, 0);
-        return; 
+        case ESP_ERR_HTTP_CONNECT:
+        case ESP_ERR_HTTP_CONNECTING:
+            return TELEGRAM_IO_FAIL_CONNECT;
+
+        case ESP_ERR_HTTP_WRITE_DATA:
+            return TELEGRAM_IO_FAIL_SEND;
+
+        case ESP_ERR_HTTP_FETCH_HEADER:
+        case ESP_ERR_HTTP_EAGAIN:
+            return TELEGRAM_IO_FAIL_TIMEOUT;
+
+        default:
+            return TELEGRAM_IO_FAIL_OTHER;
+    }
+}
+
+char *telegram_io_send_big(const char *path, uint32_t total_len, telegram_io_header_t *headers, 
+    const char *post_field, void *ctx, telegram_io_send_file_cb_t cb, telegram_io_info_t *info)
+{
+    if ((path == NULL) || (cb == NULL) || (total_len == 0))
+    {
+        ESP_LOGE(TAG, "Wrong arguments(send_big)");
+        telegram_io_report_err(info, ESP_ERR_INVALID_ARG);
+        return NULL;
+    }
+
+    telegram_io_part_t parts[2] = 
+    {
+        {.data = (const uint8_t *)post_field, .len = (post_field != NULL)?strlen(post_field):0},
+        {.len = total_len, .cb = cb, .ctx = ctx},
+    };
+
+    return telegram_io_send_data(NULL, path, headers, HTTP_METHOD_POST, parts, 2, info);
+}
+
+char *telegram_io_send_parts(void **io_ctx, const char *path, telegram_io_header_t *headers, 
+    const telegram_io_part_t *parts, uint32_t count, telegram_io_info_t *info)
+{
+    if ((path == NULL) || (parts == NULL) || (count == 0))
+    {
+        ESP_LOGE(TAG, "Wrong arguments(send_parts)");
+        telegram_io_report_err(info, ESP_ERR_INVALID_ARG);
+        return NULL;
     }
 
+    return telegram_io_send_data(io_ctx, path, headers, HTTP_METHOD_POST, parts, count, info);
+}
+
+static esp_err_t telegram_io_open_range(esp_http_client_handle_t client, const char *file_path, uint32_t offset,
+    int *total_len, telegram_io_info_t *stat, int64_t start)
+{
+    esp_err_t err;
+    int content_length;
+    int status;
+    char range[TELEGRAM_IO_RANGE_HDR_LEN];
+
     err = telegram_io_prepare(client, (char *)file_path, HTTP_METHOD_GET, NULL);
     if (err != ESP_OK)
     {
         ESP_LOGE(TAG, "telegram_io_prepare failed err %d", err);
-        esp_http_client_cleanup(client);
-        cb(ctx, buffer, -1, 0);
-        return;
+        return err;
+    }
+
+    if (offset)
+    {
+        snprintf(range, sizeof(range), "bytes=%u-", offset);
+        err = esp_http_client_set_header(client, "Range", range);
+        if (err != ESP_OK)
+        {
+            ESP_LOGE(TAG, "Failed to set Range header err %d", err);
+            return err;
+        }
     }
 
     err = esp_http_client_open(client, 0);
-    if (err != ESP_OK) {
+    stat->connect_us = esp_timer_get_time() - start;
+    if (err != ESP_OK) 
+    {
         ESP_LOGE(TAG, "esp_http_client_connect failed err %d", err);
-        esp_http_client_cleanup(client);
-        cb(ctx, buffer, -1, 0);
-        return;
+        return err;
     }
 
-    total_len = esp_http_client_fetch_headers(client);
-    if (total_len < 0)
+    content_length = esp_http_client_fetch_headers(client);
+    if ((content_length < 0) && !esp_http_client_is_chunked_response(client))
     {
-        ESP_LOGE(TAG, "esp_http_client_fetch_headers failed %d", total_len);
-        esp_http_client_cleanup(client);
-        cb(ctx, buffer, -1, 0);
-        return;   
+        ESP_LOGE(TAG, "esp_http_client_fetch_headers failed %d", content_length);
+        esp_http_client_close(client);
+        return ESP_ERR_HTTP_FETCH_HEADER;
     }
 
-    buffer_size = MIN(total_len, TELEGRAM_MAX_BUFFER);
-    buffer = calloc(buffer_size, sizeof(uint8_t));
-    if (buffer == NULL)
+    if (esp_http_client_is_chunked_response(client) || (content_length == 0))
     {
-        ESP_LOGE(TAG, "No mem!");
-        esp_http_client_cleanup(client);
-        cb(ctx, buffer, -1, 0);
-        return;  
+        /* Unknown length, read until the end of the body */
+        content_length = 0;
     }
 
-    do
+    stat->first_byte_us = esp_timer_get_time() - start;
+    status = esp_http_client_get_status_code(client);
+    stat->status = status;
+    TELEGRAM_TRACE(TELEGRAM_TRACE_HEADERS, stat->req_id, status);
+    if (status == 206)
+    {
+        *total_len = content_length ? ((int)offset + content_length) : 0;
+    } else if ((status == 200) && (offset == 0))
+    {
+        *total_len = content_length;
+    } else
+    {
+        ESP_LOGE(TAG, "Unexpected status %d for offset %u", status, offset);
+        esp_http_client_close(client);
+        return ESP_FAIL;
+    }
+
+    return ESP_OK;
+}
+
+bool telegram_io_read_file(const char *file_path, uint32_t offset, void *ctx, telegram_io_get_file_cb_t cb,
+    telegram_io_info_t *info)
+{
+    esp_err_t err;
+    int total_len = 0;
+    int data_read;
+    uint8_t *buffer = NULL;
+    uint32_t buffer_size = 0;
+    uint32_t attempt = 0;
+    bool done = false;
+    bool aborted = false;
+    esp_http_client_handle_t client;
+    telegram_io_info_t stat = {.req_id = info?info->req_id:0};
+    int64_t start = esp_timer_get_time();
+
+    if ((file_path == NULL) || (cb == NULL))
+    {
+        ESP_LOGE(TAG, "Wrong params");
+        telegram_io_report_err(info, ESP_ERR_INVALID_ARG);
+        return false;    
+    }
+
+    client = esp_http_client_init(&telegram_io_http_cfg);
+    if (client == NULL)
+    {
+        ESP_LOGE(TAG, "Failed to init http client");
+        cb(ctx, buffer, -1, offset, 0);
+        stat.err = ESP_ERR_NO_MEM;
+        telegram_io_report(info, &stat, start);
+        return false; 
+    }
+
+    while (!done && !aborted && (attempt++ < TELEGRAM_IO_RESUME_ATTEMPTS))
     {
-        data_read = esp_http_client_read(client, (char *)buffer, buffer_size);
-        if (!cb(ctx, buffer, data_read, total_len))
+        if (attempt > 1)
         {
-            break;
+            vTaskDelay((TELEGRAM_IO_RESUME_DELAY_MS << (attempt - 2)) / portTICK_PERIOD_MS);
         }
 
-        if (data_read < 0)
+        err = telegram_io_open_range(client, file_path, offset, &total_len, &stat, start);
+        stat.err = err;
+        if (err != ESP_OK)
         {
-            ESP_LOGE(TAG, "Data read error: %d", data_read);
-            break;
+            continue;
+        }
+
+        if (buffer == NULL)
+        {
+            buffer_size = (total_len > 0) ? MIN(total_len, TELEGRAM_MAX_BUFFER) : TELEGRAM_MAX_BUFFER;
+            buffer = telegram_calloc(TELEGRAM_MEM_IO, buffer_size, sizeof(uint8_t));
+            if (buffer == NULL)
+            {
+                ESP_LOGE(TAG, "No mem!");
+                esp_http_client_close(client);
+                stat.err = ESP_ERR_NO_MEM;
+                break;
+            }
         }
 
-    } while(data_read);
+        do
+        {
+            data_read = esp_http_client_read(client, (char *)buffer, buffer_size);
+            if (data_read < 0)
+            {
+                ESP_LOGE(TAG, "Data read error: %d offset %u", data_read, offset);
+                stat.err = data_read;
+                break;
+            }
 
-    free(buffer);
-    esp_http_client_close(client);
+            if (data_read == 0)
+            {
+                /* Without the length the end of the file is the terminating chunk, not a closed connection */
+                done = (total_len == 0) ? esp_http_client_is_complete_data_received(client) 
+                    : (offset >= (uint32_t)total_len);
+                if (!done)
+                {
+                    ESP_LOGW(TAG, "Connection dropped at %u of %d, resuming", offset, total_len);
+                }
+                break;
+            }
+
+            if (!cb(ctx, buffer, data_read, offset, total_len))
+            {
+                aborted = true;
+                break;
+            }
+
+            offset += data_read;
+            stat.bytes_in += data_read;
+            TELEGRAM_TRACE(TELEGRAM_TRACE_BODY, stat.req_id, data_read);
+        } while(true);
+
+        esp_http_client_close(client);
+    }
+
+    if (!done && !aborted)
+    {
+        if (stat.err == ESP_OK)
+        {
+            stat.err = ESP_FAIL;
+        }
+        cb(ctx, NULL, -1, offset, total_len);
+    }
+
+    telegram_free_tag(TELEGRAM_MEM_IO, buffer);
     esp_http_client_cleanup(client);  
-}
\ No newline at end of file
+    telegram_io_report(info, &stat, start);
+    TELEGRAM_TRACE(TELEGRAM_TRACE_SEND_DONE, stat.req_id, stat.status);
+    return done;
+}
@@ -0,0 +1,21 @@
+#include "telegram_lane.h"
+
+telegram_lane_t telegram_lane_default(telegram_method_t method)
+{
+	switch (method)
+	{
+		case TELEGRAM_ANSWER_QUERY:
+		case TELEGRAM_EDIT_MESSAGE_TEXT:
+		case TELEGRAM_EDIT_MESSAGE_MARKUP:
+			return TELEGRAM_LANE_INTERACTIVE;
+
+		case TELEGRAM_GET_FILE:
+		case TELEGRAM_SEND_FILE:
+		case TELEGRAM_SEND_PHOTO:
+		case TELEGRAM_SEND_MEDIA_GROUP:
+			return TELEGRAM_LANE_BULK;
+
+		default:
+			return TELEGRAM_LANE_NORMAL;
+	}
+}
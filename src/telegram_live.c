@@ -0,0 +1,250 @@
+#include <string.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/timers.h>
+#include "telegram.h"
+#include "telegram_live.h"
+#include "telegram_mem.h"
+#include "telegram_hash.h"
+
+static const char *TAG="telegram_live";
+
+typedef struct
+{
+	void *teleCtx;
+	telegram_int_t chat_id;
+	telegram_int_t message_id;
+	int64_t min_interval_us;
+	int64_t last_us;
+	uint32_t text_hash;
+	uint32_t kbrd_hash;
+	portMUX_TYPE lock;           /** Guards shown and pending state, the timer callback may run at any time */
+	TimerHandle_t timer;         /** Sends the pending edit when the interval expires */
+	char *pending;               /** Throttled edit payload, the latest one wins */
+	telegram_method_t pending_method;
+	uint32_t pending_text_hash;
+	uint32_t pending_kbrd_hash;
+} telegram_live_t;
+
+/** Drop the pending edit, the caller holds the lock, returns the payload to free outside of it */
+static char *telegram_live_take_pending(telegram_live_t *live)
+{
+	char *pending = live->pending;
+
+	live->pending = NULL;
+	return pending;
+}
+
+static void telegram_live_timer_cb(TimerHandle_t timer)
+{
+	char *pending;
+	telegram_method_t method;
+	telegram_live_t *live = (telegram_live_t *)pvTimerGetTimerID(timer);
+
+	portENTER_CRITICAL(&live->lock);
+	pending = telegram_live_take_pending(live);
+	method = live->pending_method;
+	if (pending != NULL)
+	{
+		/* Queued edit is considered shown, it is not repeated if it fails */
+		live->text_hash = live->pending_text_hash;
+		live->kbrd_hash = live->pending_kbrd_hash;
+		live->last_us = esp_timer_get_time();
+	}
+	portEXIT_CRITICAL(&live->lock);
+
+	if ((pending != NULL) && !telegram_request_async(live->teleCtx, method, live->chat_id, pending, NULL, NULL))
+	{
+		ESP_LOGW(TAG, "Throttled edit is lost, async sender is not started or full");
+	}
+}
+
+/** Called in the timer task after the timer is deleted, so the callback does not run anymore */
+static void telegram_live_free_cb(void *live_ptr, uint32_t arg)
+{
+	telegram_live_t *live = (telegram_live_t *)live_ptr;
+
+	telegram_free_tag(TELEGRAM_MEM_MAKE, live->pending);
+	telegram_free_tag(TELEGRAM_MEM_CORE, live);
+}
+
+void *telegram_live_init(void *teleCtx_ptr, telegram_int_t chat_id, uint32_t min_interval_ms)
+{
+	telegram_live_t *live = NULL;
+
+	if (teleCtx_ptr == NULL)
+	{
+		return NULL;
+	}
+
+	live = telegram_calloc(TELEGRAM_MEM_CORE, 1, sizeof(telegram_live_t));
+	if (live == NULL)
+	{
+		ESP_LOGE(TAG, "No mem!");
+		return NULL;
+	}
+
+	if (min_interval_ms == 0)
+	{
+		min_interval_ms = TELEGRAM_LIVE_MIN_INTERVAL_MS;
+	}
+
+	live->teleCtx = teleCtx_ptr;
+	live->chat_id = chat_id;
+	live->message_id = -1;
+	live->min_interval_us = (int64_t)min_interval_ms * 1000;
+	live->lock = (portMUX_TYPE)portMUX_INITIALIZER_UNLOCKED;
+	live->timer = xTimerCreate("telegram_live", pdMS_TO_TICKS(min_interval_ms) + 1, pdFALSE, live, 
+		telegram_live_timer_cb);
+	if (live->timer == NULL)
+	{
+		ESP_LOGE(TAG, "Failed to create timer");
+		telegram_free_tag(TELEGRAM_MEM_CORE, live);
+		return NULL;
+	}
+
+	return live;
+}
+
+telegram_live_res_t telegram_live_update(void *live_ptr, const char *text, telegram_kbrd_t *kbrd)
+{
+	char *kbrd_json = NULL;
+	char *pending = NULL;
+	uint32_t text_hash;
+	uint32_t kbrd_hash;
+	int64_t wait_us;
+	bool unchanged;
+	bool text_changed;
+	bool res = false;
+	int64_t now = esp_timer_get_time();
+	telegram_live_t *live = (telegram_live_t *)live_ptr;
+
+	if ((live == NULL) || (text == NULL))
+	{
+		return TELEGRAM_LIVE_FAILED;
+	}
+
+	if (kbrd != NULL)
+	{
+		kbrd_json = telegram_make_kbrd(kbrd);
+		if (kbrd_json == NULL)
+		{
+			ESP_LOGE(TAG, "No mem!");
+			return TELEGRAM_LIVE_FAILED;
+		}
+	}
+
+	text_hash = telegram_hash_str(TELEGRAM_HASH_INIT, text);
+	kbrd_hash = telegram_hash_str(TELEGRAM_HASH_INIT, kbrd_json);
+	telegram_free_tag(TELEGRAM_MEM_MAKE, kbrd_json);
+
+	portENTER_CRITICAL(&live->lock);
+	/* The newest state replaces the pending one in any case */
+	pending = telegram_live_take_pending(live);
+	unchanged = (text_hash == live->text_hash) && (kbrd_hash == live->kbrd_hash);
+	wait_us = live->min_interval_us - (now - live->last_us);
+	text_changed = (text_hash != live->text_hash);
+	portEXIT_CRITICAL(&live->lock);
+	telegram_free_tag(TELEGRAM_MEM_MAKE, pending);
+	pending = NULL;
+
+	if (live->message_id < 0)
+	{
+		live->message_id = telegram_send_message_get_id(live->teleCtx, live->chat_id, text, kbrd);
+		res = (live->message_id >= 0);
+	} else
+	{
+		if (unchanged)
+		{
+			return TELEGRAM_LIVE_UNCHANGED;
+		}
+
+		/* editMessageText drops the keyboard if it is not passed, so it is always sent with the text,
+		 keyboard removal is done the same way */
+		if (!text_changed && (kbrd != NULL))
+		{
+			text = NULL;
+		}
+
+		if (wait_us > 0)
+		{
+			pending = telegram_make_edit_message(live->chat_id, live->message_id, text, kbrd);
+			if (pending == NULL)
+			{
+				ESP_LOGE(TAG, "No mem!");
+				return TELEGRAM_LIVE_FAILED;
+			}
+
+			portENTER_CRITICAL(&live->lock);
+			live->pending = pending;
+			live->pending_method = (text != NULL) ? TELEGRAM_EDIT_MESSAGE_TEXT : TELEGRAM_EDIT_MESSAGE_MARKUP;
+			live->pending_text_hash = text_hash;
+			live->pending_kbrd_hash = kbrd_hash;
+			portEXIT_CRITICAL(&live->lock);
+			if (!xTimerIsTimerActive(live->timer))
+			{
+				xTimerChangePeriod(live->timer, pdMS_TO_TICKS(wait_us / 1000) + 1, 0);
+			}
+
+			return TELEGRAM_LIVE_THROTTLED;
+		}
+
+		res = telegram_edit_message(live->teleCtx, live->chat_id, live->message_id, text, kbrd);
+	}
+
+	if (!res)
+	{
+		return TELEGRAM_LIVE_FAILED;
+	}
+
+	portENTER_CRITICAL(&live->lock);
+	live->text_hash = text_hash;
+	live->kbrd_hash = kbrd_hash;
+	live->last_us = now;
+	portEXIT_CRITICAL(&live->lock);
+	return TELEGRAM_LIVE_SENT;
+}
+
+telegram_int_t telegram_live_get_message_id(void *live_ptr)
+{
+	telegram_live_t *live = (telegram_live_t *)live_ptr;
+
+	if (live == NULL)
+	{
+		return -1;
+	}
+
+	return live->message_id;
+}
+
+void telegram_live_reset(void *live_ptr)
+{
+	char *pending = NULL;
+	telegram_live_t *live = (telegram_live_t *)live_ptr;
+
+	if (live == NULL)
+	{
+		return;
+	}
+
+	portENTER_CRITICAL(&live->lock);
+	pending = telegram_live_take_pending(live);
+	portEXIT_CRITICAL(&live->lock);
+	telegram_free_tag(TELEGRAM_MEM_MAKE, pending);
+	live->message_id = -1;
+}
+
+void telegram_live_free(void *live_ptr)
+{
+	telegram_live_t *live = (telegram_live_t *)live_ptr;
+
+	if (live == NULL)
+	{
+		return;
+	}
+
+	/* Commands are executed by the timer task in order, the memory is freed after the timer is gone */
+	xTimerDelete(live->timer, portMAX_DELAY);
+	xTimerPendFunctionCall(telegram_live_free_cb, live, 0, portMAX_DELAY);
+}
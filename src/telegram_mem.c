@@ -0,0 +1,234 @@
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <freertos/FreeRTOS.h>
+#include <esp_heap_caps.h>
+#include <cJSON.h>
+#include "telegram_mem.h"
+
+static size_t telegram_mem_heap_size(void *ptr)
+{
+	return heap_caps_get_allocated_size(ptr);
+}
+
+static telegram_malloc_fn_t telegram_malloc_fn = malloc;
+static telegram_free_fn_t telegram_free_fn = free;
+static telegram_size_fn_t telegram_size_fn = telegram_mem_heap_size;
+/** Set by the first allocation or by telegram_mem_set_hooks, the allocator can not change afterwards */
+static bool telegram_mem_locked = false;
+
+#if TELEGRAM_MEM_ACCOUNTING == 1
+static telegram_mem_stats_t telegram_mem_stats[TELEGRAM_MEM_TAG_COUNT];
+static telegram_mem_usage_t telegram_mem_usage;
+static portMUX_TYPE telegram_mem_lock = portMUX_INITIALIZER_UNLOCKED;
+#endif
+
+#if TELEGRAM_MEM_HOOK_CJSON == 1
+static void *telegram_json_malloc(size_t size)
+{
+	return telegram_malloc(TELEGRAM_MEM_JSON, size);
+}
+
+static void telegram_json_free(void *ptr)
+{
+	telegram_free_tag(TELEGRAM_MEM_JSON, ptr);
+}
+#endif
+
+bool telegram_mem_set_hooks(telegram_malloc_fn_t malloc_fn, telegram_free_fn_t free_fn, telegram_size_fn_t size_fn)
+{
+	bool res = false;
+
+#if TELEGRAM_MEM_ACCOUNTING == 1
+	portENTER_CRITICAL(&telegram_mem_lock);
+#endif
+	if (!telegram_mem_locked)
+	{
+		telegram_malloc_fn = (malloc_fn != NULL)?malloc_fn:malloc;
+		telegram_free_fn = (free_fn != NULL)?free_fn:free;
+		telegram_size_fn = (malloc_fn != NULL)?size_fn:telegram_mem_heap_size;
+		telegram_mem_locked = true;
+		res = true;
+	}
+#if TELEGRAM_MEM_ACCOUNTING == 1
+	portEXIT_CRITICAL(&telegram_mem_lock);
+#endif
+
+	return res;
+}
+
+void telegram_mem_init(void)
+{
+#if TELEGRAM_MEM_HOOK_CJSON == 1
+	static bool initialized = false;
+	cJSON_Hooks hooks = {.malloc_fn = telegram_json_malloc, .free_fn = telegram_json_free};
+
+	if (!initialized)
+	{
+		cJSON_InitHooks(&hooks);
+		initialized = true;
+	}
+#endif
+}
+
+void *telegram_malloc(telegram_mem_tag_t tag, size_t size)
+{
+#if TELEGRAM_MEM_ACCOUNTING == 1
+	void *ptr = NULL;
+	uint32_t block = 0;
+
+	if (tag >= TELEGRAM_MEM_TAG_COUNT)
+	{
+		tag = TELEGRAM_MEM_CORE;
+	}
+
+	ptr = telegram_malloc_fn(size);
+	if ((ptr != NULL) && (telegram_size_fn != NULL))
+	{
+		block = telegram_size_fn(ptr);
+	}
+
+	portENTER_CRITICAL(&telegram_mem_lock);
+	telegram_mem_locked = true;
+	if (ptr == NULL)
+	{
+		telegram_mem_stats[tag].failed++;
+	} else
+	{
+		telegram_mem_stats[tag].allocated += size;
+		telegram_mem_stats[tag].count++;
+		telegram_mem_stats[tag].live++;
+		telegram_mem_stats[tag].current += block;
+		if (telegram_mem_stats[tag].current > telegram_mem_stats[tag].peak)
+		{
+			telegram_mem_stats[tag].peak = telegram_mem_stats[tag].current;
+		}
+		telegram_mem_usage.count++;
+		telegram_mem_usage.current += block;
+		if (telegram_mem_usage.current > telegram_mem_usage.peak)
+		{
+			telegram_mem_usage.peak = telegram_mem_usage.current;
+		}
+	}
+	portEXIT_CRITICAL(&telegram_mem_lock);
+
+	return ptr;
+#else
+	telegram_mem_locked = true;
+	return telegram_malloc_fn(size);
+#endif
+}
+
+void *telegram_calloc(telegram_mem_tag_t tag, size_t num, size_t size)
+{
+	void *ptr = NULL;
+
+	if ((size != 0) && (num > (SIZE_MAX / size)))
+	{
+		return NULL;
+	}
+
+	ptr = telegram_malloc(tag, num * size);
+	if (ptr != NULL)
+	{
+		memset(ptr, 0, num * size);
+	}
+
+	return ptr;
+}
+
+char *telegram_strdup(telegram_mem_tag_t tag, const char *str)
+{
+	char *ret = NULL;
+	size_t len;
+
+	if (str == NULL)
+	{
+		return NULL;
+	}
+
+	len = strlen(str) + 1;
+	ret = telegram_malloc(tag, len);
+	if (ret != NULL)
+	{
+		memcpy(ret, str, len);
+	}
+
+	return ret;
+}
+
+#if TELEGRAM_MEM_ACCOUNTING == 1
+/** Blocks allocated elsewhere (e.g. cJSON trees made before the hooks) may be freed here, do not underflow */
+static void telegram_mem_release(uint32_t *current, uint32_t *live, uint32_t block)
+{
+	*current -= (block < *current) ? block : *current;
+	if (*live != 0)
+	{
+		(*live)--;
+	}
+}
+#endif
+
+void telegram_free_tag(telegram_mem_tag_t tag, void *ptr)
+{
+#if TELEGRAM_MEM_ACCOUNTING == 1
+	uint32_t block = 0;
+
+	if (ptr == NULL)
+	{
+		return;
+	}
+
+	if (telegram_size_fn != NULL)
+	{
+		block = telegram_size_fn(ptr);
+	}
+
+	portENTER_CRITICAL(&telegram_mem_lock);
+	telegram_mem_release(&telegram_mem_usage.current, &telegram_mem_usage.count, block);
+	if (tag < TELEGRAM_MEM_TAG_COUNT)
+	{
+		telegram_mem_release(&telegram_mem_stats[tag].current, &telegram_mem_stats[tag].live, block);
+	}
+	portEXIT_CRITICAL(&telegram_mem_lock);
+#endif
+	telegram_free_fn(ptr);
+}
+
+void telegram_free(void *ptr)
+{
+	telegram_free_tag(TELEGRAM_MEM_TAG_COUNT, ptr);
+}
+
+void telegram_mem_get_stats(telegram_mem_tag_t tag, telegram_mem_stats_t *stats)
+{
+	if (stats == NULL)
+	{
+		return;
+	}
+
+	memset(stats, 0, sizeof(telegram_mem_stats_t));
+#if TELEGRAM_MEM_ACCOUNTING == 1
+	if (tag < TELEGRAM_MEM_TAG_COUNT)
+	{
+		portENTER_CRITICAL(&telegram_mem_lock);
+		*stats = telegram_mem_stats[tag];
+		portEXIT_CRITICAL(&telegram_mem_lock);
+	}
+#endif
+}
+
+void telegram_mem_get_usage(telegram_mem_usage_t *usage)
+{
+	if (usage == NULL)
+	{
+		return;
+	}
+
+	memset(usage, 0, sizeof(telegram_mem_usage_t));
+#if TELEGRAM_MEM_ACCOUNTING == 1
+	portENTER_CRITICAL(&telegram_mem_lock);
+	*usage = telegram_mem_usage;
+	portEXIT_CRITICAL(&telegram_mem_lock);
+#endif
+}
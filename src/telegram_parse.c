@@ -2,8 +2,11 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stddef.h>
 #include <cJSON.h>
 #include "telegram_parse.h"
+#include "telegram_mem.h"
+#include "telegram_response.h"
 
 #define TEGLEGRAM_CHAT_ID_MAX_LEN TELEGRAM_INT_MAX_VAL_LENGTH
 
@@ -19,6 +22,8 @@
 
 #define TELEGRAM_MSG_FMT "\"chat_id\": \"%.0f\", \"text\": \"%s\""
 #define TELEGRAM_MSG_MARKUP_FMT ", \"reply_markup\": {%s}"
+#define TELEGRAM_EDIT_MSG_FMT "\"chat_id\": \"%.0f\", \"message_id\": %.0f"
+#define TELEGRAM_EDIT_TEXT_FMT ", \"text\": \"%s\""
 
 #define TELEGRAM_ANSWER_QUERY_FMT_PL "{\"callback_query_id\": \"%s\", \"text\": \"%s\", \"show_alert\": \"%s\", \"url\": \"%s\", \"cache_time\": \"%.0f\"}"
 
@@ -30,80 +35,93 @@
 #define TELEGRAM_SEND_FILE_FMT  TELEGRAM_SERVER"/bot%s/sendDocument"
 #define TELEGRAM_SEND_PHOTO_FMT  TELEGRAM_SERVER"/bot%s/sendPhoto"
 #define TELEGRAM_ANSWER_QUERY_FMT  TELEGRAM_SERVER"/bot%s/answerCallbackQuery"
+#define TELEGRAM_SET_WEBHOOK_FMT  TELEGRAM_SERVER"/bot%s/setWebhook"
+#define TELEGRAM_DELETE_WEBHOOK_FMT  TELEGRAM_SERVER"/bot%s/deleteWebhook"
+#define TELEGRAM_EDIT_MESSAGE_TEXT_FMT  TELEGRAM_SERVER"/bot%s/editMessageText"
+#define TELEGRAM_EDIT_MESSAGE_MARKUP_FMT  TELEGRAM_SERVER"/bot%s/editMessageReplyMarkup"
+#define TELEGRAM_SEND_MEDIA_GROUP_FMT  TELEGRAM_SERVER"/bot%s/sendMediaGroup"
 
+#define TELEGRAM_INLINE_REPLY_FMT "{\"method\": \"%s\""
 
-static void telegram_free_user(telegram_user_t *user);
-static void telegram_free_chat(telegram_chat_t *chat);
-static void telegram_free_file(telegram_document_t *file);
-static void telegram_free_photosize(telegram_photosize_t *file);
-static void telegram_free_message(telegram_chat_message_t *msg);
-static void telegram_free_callback_query(telegram_chat_callback_t *query);
-static telegram_chat_type_t telegram_get_chat_type(const char *strType);
-static telegram_user_t *telegram_parse_user(cJSON *subitem);
-static telegram_chat_t *telegram_parse_chat(cJSON *subitem);
-static telegram_chat_message_t *telegram_parse_message(cJSON *subitem);
-static telegram_chat_callback_t *telegram_parse_callback_query(cJSON *subitem);
+#define TELEGRAM_WEBHOOK_FMT_PL "{\"url\": \"%s\""
+#define TELEGRAM_WEBHOOK_MAX_CONN_FMT_PL ", \"max_connections\": %u"
+#define TELEGRAM_WEBHOOK_SECRET_FMT_PL ", \"secret_token\": \"%s\""
 
-static void telegram_free_user(telegram_user_t *user)
-{
-	free(user);
-}
 
-static void telegram_free_chat(telegram_chat_t *chat)
+typedef enum
 {
-	if (chat == NULL)
-	{
-		return;
-	}
-
-	telegram_free_message(chat->pinned_message);
-	free(chat);
-}
-
-static void telegram_free_photosize(telegram_photosize_t *file)
-{
-	free(file);
-}
-
-static void telegram_free_file(telegram_document_t *file)
+	TELEGRAM_FIELD_INT,
+	TELEGRAM_FIELD_FLOAT,
+	TELEGRAM_FIELD_BOOL,
+	TELEGRAM_FIELD_STR,
+	TELEGRAM_FIELD_CHAT_TYPE,
+	TELEGRAM_FIELD_OBJ,
+	TELEGRAM_FIELD_ARR,
+} telegram_field_kind_t;
+
+struct telegram_schema;
+
+/** Row of the field table generated from telegram_schema.h */
+typedef struct
 {
-	if (file == NULL)
-	{
-		return;
-	}
-
-	telegram_free_photosize(file->thumb);
-	free(file);
-}
-
-static void telegram_free_message(telegram_chat_message_t *msg)
+	const char *key;                   /** JSON key */
+	uint16_t offset;                   /** Offset of the field in the structure */
+	uint16_t count_offset;             /** Offset of <name>_count for arrays */
+	uint8_t kind;                      /** See telegram_field_kind_t */
+	uint8_t bit;                       /** Bit in the presence mask */
+	const struct telegram_schema *sub; /** Schema of the nested object */
+} telegram_field_t;
+
+typedef struct telegram_schema
 {
-	if (msg == NULL)
-	{
-		return;
-	}
-
-	telegram_free_user(msg->from);
-	telegram_free_user(msg->forward_from);
-	telegram_free_chat(msg->chat);
-	telegram_free_chat(msg->forward_from_chat);
-	telegram_free_message(msg->reply_to_message);
-	telegram_free_file(msg->file);
-	free(msg);
-}
-
-static void telegram_free_callback_query(telegram_chat_callback_t *query)
-{
-	if (query == NULL)
-	{
-		return;
-	}
-
-	telegram_free_user(query->from);
-	telegram_free_message(query->message);
-	free(query);
-}
-
+	const telegram_field_t *fields;
+	uint16_t count;
+	uint16_t size;           /** sizeof of the structure */
+	uint16_t present_offset; /** Offset of the presence mask */
+} telegram_schema_t;
+
+#define TELEGRAM_FIELD_COUNT_OFFSET_INT(T, name) 0
+#define TELEGRAM_FIELD_COUNT_OFFSET_FLOAT(T, name) 0
+#define TELEGRAM_FIELD_COUNT_OFFSET_BOOL(T, name) 0
+#define TELEGRAM_FIELD_COUNT_OFFSET_STR(T, name) 0
+#define TELEGRAM_FIELD_COUNT_OFFSET_CHAT_TYPE(T, name) 0
+#define TELEGRAM_FIELD_COUNT_OFFSET_OBJ(T, name) 0
+#define TELEGRAM_FIELD_COUNT_OFFSET_ARR(T, name) offsetof(T, name##_count)
+
+#define TELEGRAM_FIELD_SUB_INT(sub) NULL
+#define TELEGRAM_FIELD_SUB_FLOAT(sub) NULL
+#define TELEGRAM_FIELD_SUB_BOOL(sub) NULL
+#define TELEGRAM_FIELD_SUB_STR(sub) NULL
+#define TELEGRAM_FIELD_SUB_CHAT_TYPE(sub) NULL
+#define TELEGRAM_FIELD_SUB_OBJ(sub) &telegram_schema_##sub
+#define TELEGRAM_FIELD_SUB_ARR(sub) &telegram_schema_##sub
+
+#define TELEGRAM_FIELD_ROW(T, kind, name, key, sub) \
+	{key, offsetof(T, name), TELEGRAM_FIELD_COUNT_OFFSET_##kind(T, name), TELEGRAM_FIELD_##kind, \
+		TELEGRAM_F_##T##_##name, TELEGRAM_FIELD_SUB_##kind(sub)},
+
+#define TELEGRAM_SCHEMA_DECLARE(LIST, T) static const telegram_schema_t telegram_schema_##T;
+
+#define TELEGRAM_SCHEMA_DEFINE(LIST, T) \
+	static const telegram_field_t telegram_fields_##T[] = { LIST(TELEGRAM_FIELD_ROW, T) }; \
+	static const telegram_schema_t telegram_schema_##T = \
+	{ \
+		telegram_fields_##T, sizeof(telegram_fields_##T) / sizeof(telegram_field_t), sizeof(T), offsetof(T, present) \
+	};
+
+#define TELEGRAM_SCHEMA_ALL(X) \
+	X(TELEGRAM_SCHEMA_USER, telegram_user_t) \
+	X(TELEGRAM_SCHEMA_CHAT, telegram_chat_t) \
+	X(TELEGRAM_SCHEMA_PHOTOSIZE, telegram_photosize_t) \
+	X(TELEGRAM_SCHEMA_DOCUMENT, telegram_document_t) \
+	X(TELEGRAM_SCHEMA_LOCATION, telegram_location_t) \
+	X(TELEGRAM_SCHEMA_CONTACT, telegram_contact_t) \
+	X(TELEGRAM_SCHEMA_MESSAGE, telegram_chat_message_t) \
+	X(TELEGRAM_SCHEMA_CALLBACK, telegram_chat_callback_t) \
+	X(TELEGRAM_SCHEMA_UPDATE, telegram_update_t)
+
+TELEGRAM_SCHEMA_ALL(TELEGRAM_SCHEMA_DECLARE)
+TELEGRAM_SCHEMA_ALL(TELEGRAM_SCHEMA_DEFINE)
 
 static telegram_chat_type_t telegram_get_chat_type(const char *strType)
 {
@@ -130,397 +148,212 @@ static telegram_chat_type_t telegram_get_chat_type(const char *strType)
 	return TELEGRAM_CHAT_TYPE_UNIMPL;
 }
 
-static telegram_chat_t *telegram_parse_chat(cJSON *subitem)
+static void telegram_schema_free_fields(const telegram_schema_t *schema, uint8_t *obj)
 {
-	cJSON *val = NULL;
-	telegram_chat_t *chat = calloc(1, sizeof(telegram_chat_t));
-
-	if (chat == NULL)
-	{
-		return NULL;
-	}
+	uint32_t i;
+	uint32_t j;
 
-	val = cJSON_GetObjectItem(subitem, "id");
-	if (val != NULL)
+	for (i = 0; i < schema->count; i++)
 	{
-		chat->id = val->valuedouble; 
-	}
+		const telegram_field_t *field = &schema->fields[i];
+		uint8_t *sub = NULL;
 
-	val = cJSON_GetObjectItem(subitem, "title");
-	if (val != NULL)
-	{
-		chat->title = val->valuestring; 
-	}
+		if ((field->kind != TELEGRAM_FIELD_OBJ) && (field->kind != TELEGRAM_FIELD_ARR))
+		{
+			continue;
+		}
 
-	val = cJSON_GetObjectItem(subitem, "type");
-	if (val != NULL)
-	{
-		chat->type = telegram_get_chat_type(val->valuestring);
-	}
+		sub = *(uint8_t **)&obj[field->offset];
+		if (sub == NULL)
+		{
+			continue;
+		}
 
-	val = cJSON_GetObjectItem(subitem, "pinned_message");
-	if (val != NULL)
-	{
-		chat->pinned_message = telegram_parse_message(val);
+		if (field->kind == TELEGRAM_FIELD_OBJ)
+		{
+			telegram_schema_free_fields(field->sub, sub);
+			telegram_free_tag(TELEGRAM_MEM_PARSE, sub);
+		} else if (field->kind == TELEGRAM_FIELD_ARR)
+		{
+			for (j = 0; j < *(uint32_t *)&obj[field->count_offset]; j++)
+			{
+				telegram_schema_free_fields(field->sub, &sub[j * field->sub->size]);
+			}
+			telegram_free_tag(TELEGRAM_MEM_PARSE, sub);
+		}
 	}
-
-	return chat;
 }
 
-static telegram_photosize_t *telegram_parse_photosize(cJSON *subitem)
+static void telegram_schema_free(const telegram_schema_t *schema, void *obj)
 {
-	cJSON *val = NULL;
-	telegram_photosize_t *photosize = calloc(1, sizeof(telegram_photosize_t));
-
-	if (photosize == NULL)
-	{
-		return NULL;
-	}
-
-	val = cJSON_GetObjectItem(subitem, "file_id");
-	if (val != NULL)
-	{
-		photosize->id = val->valuestring;
-	}
-
-	val = cJSON_GetObjectItem(subitem, "width");
-	if (val != NULL)
-	{
-		photosize->width = val->valuedouble;
-	}
-
-	val = cJSON_GetObjectItem(subitem, "height");
-	if (val != NULL)
-	{
-		photosize->height = val->valuedouble;
-	}
-
-	val = cJSON_GetObjectItem(subitem, "file_size");
-	if (val != NULL)
+	if (obj == NULL)
 	{
-		photosize->file_size = val->valuedouble;
+		return;
 	}
 
-	return photosize;
+	telegram_schema_free_fields(schema, (uint8_t *)obj);
+	telegram_free_tag(TELEGRAM_MEM_PARSE, obj);
 }
 
-static telegram_document_t *telegram_parse_file(cJSON *subitem)
-{
-	cJSON *val = NULL;
-	telegram_document_t *file = calloc(1, sizeof(telegram_document_t));
-
-	if (file == NULL)
-	{
-		return NULL;
-	}
-
-	val = cJSON_GetObjectItem(subitem, "file_id");
-	if (val != NULL)
-	{
-		file->id = val->valuestring;
-	}
-
-	val = cJSON_GetObjectItem(subitem, "thumb");
-	if (val != NULL)
-	{
-		file->thumb = telegram_parse_photosize(val);
-	}
+static void *telegram_schema_parse(const telegram_schema_t *schema, cJSON *json);
 
-	val = cJSON_GetObjectItem(subitem, "file_name");
-	if (val != NULL)
-	{
-		file->name = val->valuestring;
-	}
-
-	val = cJSON_GetObjectItem(subitem, "mime_type");
-	if (val != NULL)
-	{
-		file->mime_type = val->valuestring;
-	}
-
-	val = cJSON_GetObjectItem(subitem, "file_size");
-	if (val != NULL)
-	{
-		file->file_size = val->valuedouble;
-	}
-
-	return file;
-}
-
-static telegram_chat_message_t *telegram_parse_message(cJSON *subitem)
+/** Strings are not copied, they point into the JSON tree */
+static void telegram_schema_parse_fields(const telegram_schema_t *schema, cJSON *json, uint8_t *obj)
 {
-	cJSON *val = NULL;
-	telegram_chat_message_t *msg = calloc(1, sizeof(telegram_chat_message_t));
-
-	if (msg == NULL)
-	{
-		return NULL;
-	}
-
-	val = cJSON_GetObjectItem(subitem, "message_id");
-	if (val != NULL)
-	{
-		msg->id = val->valuedouble;
-	}
-
-	val = cJSON_GetObjectItem(subitem, "from");
-	if (val != NULL)
-	{
-		msg->from = telegram_parse_user(val);
-	}
-
-	val = cJSON_GetObjectItem(subitem, "date");
-	if (val != NULL)
-	{
-		msg->timestamp = val->valuedouble;
-	}
-
-	val = cJSON_GetObjectItem(subitem, "chat");
-	if (val != NULL)
-	{
-		msg->chat = telegram_parse_chat(val);
-	}
-
-	val = cJSON_GetObjectItem(subitem, "forward_from");
-	if (val != NULL)
-	{
-		msg->forward_from = telegram_parse_user(val);
-	}
-
-	val = cJSON_GetObjectItem(subitem, "forward_from_chat");
-	if (val != NULL)
-	{
-		msg->forward_from_chat = telegram_parse_chat(val);
-	}
-
-	val = cJSON_GetObjectItem(subitem, "forward_from_message_id");
-	if (val != NULL)
-	{
-		msg->forward_from_message_id = val->valuedouble;
-	}
+	uint32_t i;
+	uint32_t j;
+	uint32_t count;
+	cJSON *item = NULL;
+	cJSON *elem = NULL;
+	uint32_t *present = (uint32_t *)&obj[schema->present_offset];
 
-	val = cJSON_GetObjectItem(subitem, "forward_signature");
-	if (val != NULL)
+	for (item = json->child; item != NULL; item = item->next)
 	{
-		msg->forward_signature = val->valuestring;
-	}
+		const telegram_field_t *field = NULL;
+		uint8_t *dst = NULL;
 
-	val = cJSON_GetObjectItem(subitem, "forward_date");
-	if (val != NULL)
-	{
-		msg->forward_date = val->valuedouble;
-	}
+		for (i = 0; (item->string != NULL) && (i < schema->count); i++)
+		{
+			if (!strcmp(schema->fields[i].key, item->string))
+			{
+				field = &schema->fields[i];
+				break;
+			}
+		}
 
-	val = cJSON_GetObjectItem(subitem, "reply_to_message");
-	if (val != NULL)
-	{
-		msg->reply_to_message = telegram_parse_message(val);
-	}
+		if (field == NULL)
+		{
+			continue;
+		}
 
-	val = cJSON_GetObjectItem(subitem, "edit_date");
-	if (val != NULL)
-	{
-		msg->edit_date = val->valuedouble;
-	}
+		dst = &obj[field->offset];
+		switch (field->kind)
+		{
+			case TELEGRAM_FIELD_INT:
+			case TELEGRAM_FIELD_FLOAT:
+				if (!cJSON_IsNumber(item))
+				{
+					continue;
+				}
+				*(double *)dst = item->valuedouble;
+				break;
 
-	val = cJSON_GetObjectItem(subitem, "media_group_id");
-	if (val != NULL)
-	{
-		msg->media_group_id = val->valuestring;
-	}
+			case TELEGRAM_FIELD_BOOL:
+				if (!cJSON_IsBool(item))
+				{
+					continue;
+				}
+				*(bool *)dst = cJSON_IsTrue(item);
+				break;
 
-	val = cJSON_GetObjectItem(subitem, "author_signature");
-	if (val != NULL)
-	{
-		msg->author_signature = val->valuestring;
-	}
+			case TELEGRAM_FIELD_STR:
+				if (!cJSON_IsString(item))
+				{
+					continue;
+				}
+				*(const char **)dst = item->valuestring;
+				break;
 
-	val = cJSON_GetObjectItem(subitem, "text");
-	if (val != NULL)
-	{
-		msg->text = val->valuestring;
-	}
+			case TELEGRAM_FIELD_CHAT_TYPE:
+				if (!cJSON_IsString(item))
+				{
+					continue;
+				}
+				*(telegram_chat_type_t *)dst = telegram_get_chat_type(item->valuestring);
+				break;
 
-	val = cJSON_GetObjectItem(subitem, "document");
-	if (val != NULL)
-	{
-		msg->file = telegram_parse_file(val);
-	}
+			case TELEGRAM_FIELD_OBJ:
+				if (!cJSON_IsObject(item) || (*(void **)dst != NULL))
+				{
+					continue;
+				}
 
-	val = cJSON_GetObjectItem(subitem, "caption");
-	if (val != NULL)
-	{
-		msg->caption = val->valuestring;
-	}
+				*(void **)dst = telegram_schema_parse(field->sub, item);
+				if (*(void **)dst == NULL)
+				{
+					continue;
+				}
+				break;
 
-	return msg;
-}
+			case TELEGRAM_FIELD_ARR:
+				if (!cJSON_IsArray(item) || (*(void **)dst != NULL))
+				{
+					continue;
+				}
 
-static telegram_chat_callback_t *telegram_parse_callback_query(cJSON *subitem)
-{
-	cJSON *val = NULL;
-	telegram_chat_callback_t *cb = calloc(1, sizeof(telegram_chat_callback_t));
-	
-	if (cb == NULL)
-	{
-		return NULL;
-	}
+				count = cJSON_GetArraySize(item);
+				if (count == 0)
+				{
+					continue;
+				}
 
-	val = cJSON_GetObjectItem(subitem, "id");
-	if (val != NULL)
-	{
-		cb->id = val->valuestring;
-	}
+				*(void **)dst = telegram_calloc(TELEGRAM_MEM_PARSE, count, field->sub->size);
+				if (*(void **)dst == NULL)
+				{
+					continue;
+				}
 
-	val = cJSON_GetObjectItem(subitem, "from");
-	if (val != NULL)
-	{
-		cb->from = telegram_parse_user(val);
-	}
+				*(uint32_t *)&obj[field->count_offset] = count;
+				j = 0;
+				cJSON_ArrayForEach(elem, item)
+				{
+					if (cJSON_IsObject(elem))
+					{
+						telegram_schema_parse_fields(field->sub, elem, &(*(uint8_t **)dst)[j * field->sub->size]);
+					}
+					j++;
+				}
+				break;
 
-	val = cJSON_GetObjectItem(subitem, "data");
-	if (val != NULL)
-	{
-		cb->data = val->valuestring;
-	}
+			default:
+				continue;
+		}
 
-	val = cJSON_GetObjectItem(subitem, "message");
-	if (val != NULL)
-	{
-		cb->message = telegram_parse_message(val);
+		*present |= (1UL << field->bit);
 	}
-
-	return cb;
 }
 
-static telegram_user_t *telegram_parse_user(cJSON *subitem)
+static void *telegram_schema_parse(const telegram_schema_t *schema, cJSON *json)
 {
-	cJSON *val = NULL;
-	telegram_user_t *user = calloc(1, sizeof(telegram_user_t));
+	uint8_t *obj = telegram_calloc(TELEGRAM_MEM_PARSE, 1, schema->size);
 
-	if (user == NULL)
+	if (obj == NULL)
 	{
 		return NULL;
 	}
 
-	val = cJSON_GetObjectItem(subitem, "id");
-	if (val != NULL)
-	{
-		user->id = val->valuedouble;
-	}
-
-	val = cJSON_GetObjectItem(subitem, "is_bot");
-	if (val != NULL)
-	{
-		user->is_bot = (val->valueint == 1);
-	}
-
-	val = cJSON_GetObjectItem(subitem, "first_name");
-	if (val != NULL)
-	{
-		user->first_name = val->valuestring;
-	}
-
-	val = cJSON_GetObjectItem(subitem, "last_name");
-	if (val != NULL)
-	{
-		user->last_name = val->valuestring;
-	}
-
-	val = cJSON_GetObjectItem(subitem, "username");
-	if (val != NULL)
-	{
-		user->username = val->valuestring;
-	}
-
-	val = cJSON_GetObjectItem(subitem, "language_code");
-	if (val != NULL)
-	{
-		user->language_code = val->valuestring;
-	}
-
-	return user;
+	telegram_schema_parse_fields(schema, json, obj);
+	return obj;
 }
 
 static telegram_update_t *telegram_parse_update(cJSON *subitem)
 {
 	telegram_update_t *upd = NULL;
-	cJSON *val = NULL;
 
 	if (subitem == NULL)
 	{
 		return NULL;
 	}
 
-	upd = calloc(1, sizeof(telegram_update_t));
-	if (upd == NULL)
+	if ((cJSON_GetObjectItem(subitem, "update_id") == NULL) && (cJSON_GetObjectItem(subitem, "message_id") != NULL))
 	{
-		return NULL;
-	}
-
-	val = cJSON_GetObjectItem(subitem, "update_id");
-	if (val != NULL)
-	{
-		upd->id = val->valuedouble;
-	} else
-	{
-		val = cJSON_GetObjectItem(subitem, "message_id");
-		if (val != NULL)
+		/* Result of send methods is a message, it is reported as an update with the message only */
+		upd = telegram_calloc(TELEGRAM_MEM_PARSE, 1, sizeof(telegram_update_t));
+		if (upd != NULL)
 		{
-			upd->message = telegram_parse_message(subitem);
+			upd->message = telegram_schema_parse(&telegram_schema_telegram_chat_message_t, subitem);
+			upd->present |= (upd->message != NULL)?(1UL << TELEGRAM_F_telegram_update_t_message):0;
 		}
 
 		return upd;
 	}
 
-	val = cJSON_GetObjectItem(subitem, "message");
-	if (val != NULL)
-	{
-		upd->message = telegram_parse_message(val);
-	}
-
-	val = cJSON_GetObjectItem(subitem, "edited_message");
-	if (val != NULL)
-	{
-		upd->edited_message = telegram_parse_message(val);
-	}
-
-	val = cJSON_GetObjectItem(subitem, "channel_post");
-	if (val != NULL)
-	{
-		upd->channel_post = telegram_parse_message(val);
-	}
-
-	val = cJSON_GetObjectItem(subitem, "edited_channel_post");
-	if (val != NULL)
-	{
-		upd->channel_post = telegram_parse_message(val);
-	}
-
-	val = cJSON_GetObjectItem(subitem, "callback_query");
-	if (val != NULL)
-	{
-		upd->callback_query = telegram_parse_callback_query(val);
-	}
-
-	return upd;
+	return telegram_schema_parse(&telegram_schema_telegram_update_t, subitem);
 }
 
 static void telegram_free_update_info(telegram_update_t **upd)
 {
-	telegram_update_t *info = *upd;
-
-	if (*upd == NULL)
-	{
-		return;
-	}
-
-	telegram_free_message(info->message);
-	telegram_free_message(info->channel_post);
-	telegram_free_message(info->edited_message);
-	telegram_free_message(info->edited_channel_post);
-	telegram_free_callback_query(info->callback_query);
-	free(*upd);
+	telegram_schema_free(&telegram_schema_telegram_update_t, *upd);
 	*upd = NULL;
 }
 
@@ -579,7 +412,7 @@ static char *telegram_make_markup_kbrd(telegram_kbrd_markup_t *kbrd)
 		row++;
 	}
 
-	str = calloc(sizeof(char), reqSize);
+	str = telegram_calloc(TELEGRAM_MEM_MAKE, sizeof(char), reqSize);
 	if (str == NULL)
 	{
 		return NULL;
@@ -650,7 +483,7 @@ static char *telegram_make_inline_kbrd(telegram_kbrd_inline_t *kbrd)
 		return NULL;
 	}
 
-	str = (char *)calloc(sizeof(char), reqSize + count*strlen(TELEGRAM_INLINE_BTN_FMT) + count + 1
+	str = (char *)telegram_calloc(TELEGRAM_MEM_MAKE, sizeof(char), reqSize + count*strlen(TELEGRAM_INLINE_BTN_FMT) + count + 1
 		+ strlen(TELEGRAM_INLINE_KBRD_FMT) + 2 + 2*row_count + 1); //count +1 number of comas, 2 - brackets
 
 	if (str == NULL)
@@ -696,7 +529,7 @@ static char *telegram_make_markup_remove(telegram_kbrd_markup_remove_t *markup_r
 		return NULL;
 	}
 
-	json_res = calloc(sizeof(char), strlen(TELEGRAM_REPLY_KBRD_REMOVE_FMT) + strlen("false"));
+	json_res = telegram_calloc(TELEGRAM_MEM_MAKE, sizeof(char), strlen(TELEGRAM_REPLY_KBRD_REMOVE_FMT) + strlen("false"));
 	if (json_res == NULL)
 	{
 		return NULL;
@@ -716,7 +549,7 @@ static char *telegram_make_force_reply(telegram_kbrd_force_reply_t *force_reply)
 		return NULL;
 	}
 
-	json_res = calloc(sizeof(char), strlen(TELEGRAM_REPLY_KBRD_REMOVE_FMT) + strlen("false"));
+	json_res = telegram_calloc(TELEGRAM_MEM_MAKE, sizeof(char), strlen(TELEGRAM_REPLY_KBRD_REMOVE_FMT) + strlen("false"));
 	if (json_res == NULL)
 	{
 		return NULL;
@@ -785,10 +618,10 @@ char *telegram_make_message(telegram_int_t chat_id, const char *message, telegra
 		size += strlen(additional_json) + strlen(TELEGRAM_MSG_MARKUP_FMT);
 	}
 
-	payload = calloc(sizeof(char), size);
+	payload = telegram_calloc(TELEGRAM_MEM_MAKE, sizeof(char), size);
 	if (!payload)
 	{
-		free(additional_json);
+		telegram_free_tag(TELEGRAM_MEM_MAKE, additional_json);
 		return NULL;
 	}
 
@@ -797,7 +630,61 @@ char *telegram_make_message(telegram_int_t chat_id, const char *message, telegra
 	if (additional_json)
 	{
 		size += sprintf(&payload[size], TELEGRAM_MSG_MARKUP_FMT, additional_json);
-		free(additional_json);
+		telegram_free_tag(TELEGRAM_MEM_MAKE, additional_json);
+	}
+
+	size += sprintf(&payload[size], "}");	
+
+	return payload;
+}
+
+char *telegram_make_edit_message(telegram_int_t chat_id, telegram_int_t message_id, const char *message, 
+	telegram_kbrd_t *kbrd)
+{
+	uint32_t size = strlen(TELEGRAM_EDIT_MSG_FMT) + TEGLEGRAM_CHAT_ID_MAX_LEN + TELEGRAM_INT_MAX_VAL_LENGTH + 2 + 1;
+	char *additional_json = NULL;
+	char *payload = NULL;
+
+	if ((message == NULL) && (kbrd == NULL)) /* nothing to edit */
+	{
+		return NULL;
+	}
+
+	if (message)
+	{
+		size += strlen(TELEGRAM_EDIT_TEXT_FMT) + strlen(message);
+	}
+
+	if (kbrd)
+	{
+		additional_json = telegram_make_kbrd(kbrd);
+
+		if (!additional_json)
+		{
+			return NULL;
+		}
+
+		size += strlen(additional_json) + strlen(TELEGRAM_MSG_MARKUP_FMT);
+	}
+
+	payload = telegram_calloc(TELEGRAM_MEM_MAKE, sizeof(char), size);
+	if (!payload)
+	{
+		telegram_free_tag(TELEGRAM_MEM_MAKE, additional_json);
+		return NULL;
+	}
+
+	size = sprintf(payload, "{");	
+	size += sprintf(&payload[size], TELEGRAM_EDIT_MSG_FMT, chat_id, message_id);
+	if (message)
+	{
+		size += sprintf(&payload[size], TELEGRAM_EDIT_TEXT_FMT, message);
+	}
+
+	if (additional_json)
+	{
+		size += sprintf(&payload[size], TELEGRAM_MSG_MARKUP_FMT, additional_json);
+		telegram_free_tag(TELEGRAM_MEM_MAKE, additional_json);
 	}
 
 	size += sprintf(&payload[size], "}");	
@@ -814,7 +701,7 @@ char *telegram_make_answer_query(const char *cid, const char *text, bool show_al
 		return NULL;
 	}
 
-	str = calloc(sizeof(char), strlen(TELEGRAM_ANSWER_QUERY_FMT_PL) + strlen(cid) + strlen("false")
+	str = telegram_calloc(TELEGRAM_MEM_MAKE, sizeof(char), strlen(TELEGRAM_ANSWER_QUERY_FMT_PL) + strlen(cid) + strlen("false")
 		+ ((text != NULL)?strlen(text):0) + ((url!= NULL)?strlen(url):0) + TELEGRAM_INT_MAX_VAL_LENGTH);
 	if (str == NULL)
 	{
@@ -826,6 +713,100 @@ char *telegram_make_answer_query(const char *cid, const char *text, bool show_al
 	return str;
 }
 
+char *telegram_make_inline_reply(telegram_method_t method, const char *payload)
+{
+	char *str = NULL;
+	const char *name = NULL;
+	size_t count = 0;
+
+	switch (method)
+	{
+		case TELEGRAM_SEND_MESSAGE:
+			name = "sendMessage";
+			break;
+
+		case TELEGRAM_ANSWER_QUERY:
+			name = "answerCallbackQuery";
+			break;
+
+		case TELEGRAM_EDIT_MESSAGE_TEXT:
+			name = "editMessageText";
+			break;
+
+		case TELEGRAM_EDIT_MESSAGE_MARKUP:
+			name = "editMessageReplyMarkup";
+			break;
+
+		default:
+			return NULL;
+	}
+
+	while ((payload != NULL) && (*payload == ' '))
+	{
+		payload++;
+	}
+
+	if ((payload == NULL) || (*payload != '{'))
+	{
+		return NULL;
+	}
+
+	payload++;
+	str = telegram_calloc(TELEGRAM_MEM_MAKE, sizeof(char), strlen(TELEGRAM_INLINE_REPLY_FMT) + strlen(name) 
+		+ strlen(payload) + 3);
+	if (str == NULL)
+	{
+		return NULL;
+	}
+
+	count = sprintf(str, TELEGRAM_INLINE_REPLY_FMT, name);
+	while (*payload == ' ')
+	{
+		payload++;
+	}
+
+	if (*payload != '}')
+	{
+		count += sprintf(&str[count], ", ");
+	}
+
+	sprintf(&str[count], "%s", payload);
+	return str;
+}
+
+char *telegram_make_webhook(const char *url, uint32_t max_connections, const char *secret_token)
+{
+	char *str = NULL;
+	size_t count = 0;
+
+	if (url == NULL)
+	{
+		return NULL;
+	}
+
+	str = telegram_calloc(TELEGRAM_MEM_MAKE, sizeof(char), strlen(TELEGRAM_WEBHOOK_FMT_PL) + strlen(url) 
+		+ strlen(TELEGRAM_WEBHOOK_MAX_CONN_FMT_PL) + TELEGRAM_INT_MAX_VAL_LENGTH 
+		+ strlen(TELEGRAM_WEBHOOK_SECRET_FMT_PL) + ((secret_token != NULL)?strlen(secret_token):0) + 2);
+	if (str == NULL)
+	{
+		return NULL;
+	}
+
+	count = sprintf(str, TELEGRAM_WEBHOOK_FMT_PL, url);
+	if (max_connections)
+	{
+		count += sprintf(&str[count], TELEGRAM_WEBHOOK_MAX_CONN_FMT_PL, max_connections);
+	}
+
+	if (secret_token)
+	{
+		count += sprintf(&str[count], TELEGRAM_WEBHOOK_SECRET_FMT_PL, secret_token);
+	}
+
+	sprintf(&str[count], "}");
+	return str;
+}
+
 char *telegram_make_method_path(const telegram_method_t method_id, const char *token, 
 	uint32_t limit, telegram_int_t offset, const char *file_id_path)
 {
@@ -839,7 +820,7 @@ char *telegram_make_method_path(const telegram_method_t method_id, const char *t
 	{
 		case TELEGRAM_GET_UPDATES:
 			{
-				str = calloc(sizeof(char), strlen(TELEGRAM_GET_UPDATES_FMT) + strlen(token) + 1
+				str = telegram_calloc(TELEGRAM_MEM_MAKE, sizeof(char), strlen(TELEGRAM_GET_UPDATES_FMT) + strlen(token) + 1
 					+ TELEGRAM_INT_MAX_VAL_LENGTH
 					+ (offset?(strlen(TELEGRAM_GET_MESSAGE_POST_DATA_OFFSET_FMT) + TELEGRAM_INT_MAX_VAL_LENGTH):0));
 				if (str)
@@ -860,7 +841,7 @@ char *telegram_make_method_path(const telegram_method_t method_id, const char *t
 
 		case TELEGRAM_SEND_MESSAGE:
 			{
-				str = calloc(sizeof(char), strlen(TELEGRAM_SEND_MESSAGE_FMT) + strlen(token) + 1);
+				str = telegram_calloc(TELEGRAM_MEM_MAKE, sizeof(char), strlen(TELEGRAM_SEND_MESSAGE_FMT) + strlen(token) + 1);
 				if (str)
 				{
 					sprintf(str, TELEGRAM_SEND_MESSAGE_FMT, token);
@@ -875,7 +856,7 @@ char *telegram_make_method_path(const telegram_method_t method_id, const char *t
 					return NULL;
 				}
 				
-				str = calloc(sizeof(char), strlen(TELEGRAM_GET_FILE_PATH_FMT) + strlen(file_id_path) 
+				str = telegram_calloc(TELEGRAM_MEM_MAKE, sizeof(char), strlen(TELEGRAM_GET_FILE_PATH_FMT) + strlen(file_id_path) 
 					+ strlen(token) + 1);
 				if (str)
 				{
@@ -891,7 +872,7 @@ char *telegram_make_method_path(const telegram_method_t method_id, const char *t
 					return NULL;
 				}
 
-				str = calloc(sizeof(char), strlen(TELEGRAM_GET_FILE_FMT) + strlen(token) 
+				str = telegram_calloc(TELEGRAM_MEM_MAKE, sizeof(char), strlen(TELEGRAM_GET_FILE_FMT) + strlen(token) 
 					+ strlen(file_id_path) + 1);
 				if (str)
 				{
@@ -902,7 +883,7 @@ char *telegram_make_method_path(const telegram_method_t method_id, const char *t
 
 		case TELEGRAM_SEND_FILE:
 			{
-				str = calloc(sizeof(char), strlen(TELEGRAM_SEND_FILE_FMT) + strlen(token) + 1);
+				str = telegram_calloc(TELEGRAM_MEM_MAKE, sizeof(char), strlen(TELEGRAM_SEND_FILE_FMT) + strlen(token) + 1);
 				if (str)
 				{
 					sprintf(str, TELEGRAM_SEND_FILE_FMT, token);
@@ -912,7 +893,7 @@ char *telegram_make_method_path(const telegram_method_t method_id, const char *t
 
 		case TELEGRAM_SEND_PHOTO:
 			{
-				str = calloc(sizeof(char), strlen(TELEGRAM_SEND_PHOTO_FMT) + strlen(token) + 1);
+				str = telegram_calloc(TELEGRAM_MEM_MAKE, sizeof(char), strlen(TELEGRAM_SEND_PHOTO_FMT) + strlen(token) + 1);
 				if (str)
 				{
 					sprintf(str, TELEGRAM_SEND_PHOTO_FMT, token);
@@ -923,13 +904,63 @@ char *telegram_make_method_path(const telegram_method_t method_id, const char *t
 
 		case TELEGRAM_ANSWER_QUERY:
 			{
-				str = calloc(sizeof(char), strlen(TELEGRAM_ANSWER_QUERY_FMT) + strlen(token) + 1);
+				str = telegram_calloc(TELEGRAM_MEM_MAKE, sizeof(char), strlen(TELEGRAM_ANSWER_QUERY_FMT) + strlen(token) + 1);
 				if (str)
 				{
 					sprintf(str, TELEGRAM_ANSWER_QUERY_FMT, token);
 				}
 			}
 			break;
+
+		case TELEGRAM_SET_WEBHOOK:
+			{
+				str = telegram_calloc(TELEGRAM_MEM_MAKE, sizeof(char), strlen(TELEGRAM_SET_WEBHOOK_FMT) + strlen(token) + 1);
+				if (str)
+				{
+					sprintf(str, TELEGRAM_SET_WEBHOOK_FMT, token);
+				}
+			}
+			break;
+
+		case TELEGRAM_DELETE_WEBHOOK:
+			{
+				str = telegram_calloc(TELEGRAM_MEM_MAKE, sizeof(char), strlen(TELEGRAM_DELETE_WEBHOOK_FMT) + strlen(token) + 1);
+				if (str)
+				{
+					sprintf(str, TELEGRAM_DELETE_WEBHOOK_FMT, token);
+				}
+			}
+			break;
+
+		case TELEGRAM_EDIT_MESSAGE_TEXT:
+			{
+				str = telegram_calloc(TELEGRAM_MEM_MAKE, sizeof(char), strlen(TELEGRAM_EDIT_MESSAGE_TEXT_FMT) + strlen(token) + 1);
+				if (str)
+				{
+					sprintf(str, TELEGRAM_EDIT_MESSAGE_TEXT_FMT, token);
+				}
+			}
+			break;
+
+		case TELEGRAM_EDIT_MESSAGE_MARKUP:
+			{
+				str = telegram_calloc(TELEGRAM_MEM_MAKE, sizeof(char), strlen(TELEGRAM_EDIT_MESSAGE_MARKUP_FMT) + strlen(token) + 1);
+				if (str)
+				{
+					sprintf(str, TELEGRAM_EDIT_MESSAGE_MARKUP_FMT, token);
+				}
+			}
+			break;
+
+		case TELEGRAM_SEND_MEDIA_GROUP:
+			{
+				str = telegram_calloc(TELEGRAM_MEM_MAKE, sizeof(char), strlen(TELEGRAM_SEND_MEDIA_GROUP_FMT) + strlen(token) + 1);
+				if (str)
+				{
+					sprintf(str, TELEGRAM_SEND_MEDIA_GROUP_FMT, token);
+				}
+			}
+			break;
 			
 		default:
 			break;
@@ -966,6 +997,29 @@ void telegram_parse_messages(void *teleCtx, const char *buffer, telegram_on_msg_
 	cJSON_Delete(json);
 }
 
+void telegram_parse_update_object(void *teleCtx, const char *buffer, telegram_on_msg_cb_t cb)
+{
+	cJSON *json = NULL;
+
+	if ((buffer == NULL) || (cb == NULL))
+	{
+		return;
+	}
+
+	json = cJSON_Parse(buffer);
+	if (json == NULL)
+	{
+		return;
+	}
+
+	if (cJSON_IsObject(json))
+	{
+		telegram_process_messages(teleCtx, json, cb);
+	}
+
+	cJSON_Delete(json);
+}
+
 char *telegram_parse_file_path(const char *buffer)
 {
 	char *ret = NULL;
@@ -993,7 +1047,7 @@ char *telegram_parse_file_path(const char *buffer)
 
 			if (file_path != NULL)
 			{
-				ret = strdup(file_path->valuestring);
+				ret = telegram_strdup(TELEGRAM_MEM_PARSE, file_path->valuestring);
 			}
 		}
 	}
@@ -1002,3 +1056,47 @@ char *telegram_parse_file_path(const char *buffer)
 	return ret;
 }
 
+
+telegram_int_t telegram_parse_message_id(const char *buffer)
+{
+	telegram_int_t ret = -1;
+	cJSON *json = NULL;
+	cJSON *ok_item = NULL;
+
+	if (buffer == NULL)
+	{
+		return -1;
+	}
+
+	json = cJSON_Parse(buffer);
+	if (json == NULL)
+	{
+		return -1;
+	}
+
+	ok_item = cJSON_GetObjectItem(json, "ok");
+	if  ((ok_item != NULL) && (cJSON_IsBool(ok_item) && (ok_item->valueint)))
+	{
+		cJSON *msg = cJSON_GetObjectItem(json, "result");
+		if (msg != NULL)
+		{
+			cJSON *message_id = cJSON_GetObjectItem(msg, "message_id");
+
+			if ((message_id != NULL) && cJSON_IsNumber(message_id))
+			{
+				ret = message_id->valuedouble;
+			}
+		}
+	}
+
+	cJSON_Delete(json);
+	return ret;
+}
+
+uint32_t telegram_parse_retry_after(const char *buffer)
+{
+	telegram_response_t resp;
+
+	telegram_response_parse(buffer, &resp);
+	return resp.retry_after;
+}
@@ -0,0 +1,367 @@
+#include <string.h>
+#include <stddef.h>
+#include <esp_log.h>
+#include "telegram_rec.h"
+#include "telegram_mem.h"
+
+static const char *TAG="telegram_rec";
+
+/** Fill numeric fields of the header and collect string sources of the update */
+static void telegram_rec_collect(const telegram_update_t *upd, telegram_rec_t *hdr, const char **src)
+{
+	const telegram_chat_message_t *msg = NULL;
+	const telegram_user_t *from = NULL;
+	uint32_t i;
+
+	memset(hdr, 0, sizeof(telegram_rec_t));
+	memset(src, 0, TELEGRAM_REC_STR_COUNT * sizeof(const char *));
+	hdr->update_id = (uint32_t)upd->id;
+
+	if (upd->message != NULL)
+	{
+		hdr->kind = TELEGRAM_REC_KIND_MESSAGE;
+		msg = upd->message;
+	} else if (upd->edited_message != NULL)
+	{
+		hdr->kind = TELEGRAM_REC_KIND_EDITED_MESSAGE;
+		msg = upd->edited_message;
+	} else if (upd->channel_post != NULL)
+	{
+		hdr->kind = TELEGRAM_REC_KIND_CHANNEL_POST;
+		msg = upd->channel_post;
+	} else if (upd->edited_channel_post != NULL)
+	{
+		hdr->kind = TELEGRAM_REC_KIND_EDITED_CHANNEL_POST;
+		msg = upd->edited_channel_post;
+	} else if (upd->callback_query != NULL)
+	{
+		hdr->kind = TELEGRAM_REC_KIND_CALLBACK_QUERY;
+		msg = upd->callback_query->message;
+		from = upd->callback_query->from;
+		src[TELEGRAM_REC_STR_CB_ID] = upd->callback_query->id;
+		src[TELEGRAM_REC_STR_CB_DATA] = upd->callback_query->data;
+	}
+
+	if (msg != NULL)
+	{
+		hdr->flags |= TELEGRAM_REC_HAS_MESSAGE;
+		hdr->message_id = (uint32_t)msg->id;
+		hdr->date = (uint32_t)msg->timestamp;
+		src[TELEGRAM_REC_STR_TEXT] = msg->text;
+		src[TELEGRAM_REC_STR_CAPTION] = msg->caption;
+		src[TELEGRAM_REC_STR_MEDIA_GROUP_ID] = msg->media_group_id;
+
+		if (from == NULL)
+		{
+			from = msg->from;
+		}
+
+		if (msg->chat != NULL)
+		{
+			hdr->chat_id = (int64_t)msg->chat->id;
+			hdr->chat_type = (uint8_t)msg->chat->type;
+			src[TELEGRAM_REC_STR_CHAT_TITLE] = msg->chat->title;
+			src[TELEGRAM_REC_STR_CHAT_USERNAME] = msg->chat->username;
+		}
+
+		if (msg->reply_to_message != NULL)
+		{
+			hdr->flags |= TELEGRAM_REC_HAS_REPLY;
+			hdr->reply_to_message_id = (uint32_t)msg->reply_to_message->id;
+		}
+
+		if (msg->forward_from != NULL)
+		{
+			hdr->flags |= TELEGRAM_REC_HAS_FORWARD;
+			hdr->forward_from_id = (int64_t)msg->forward_from->id;
+		}
+
+		if (TELEGRAM_HAS(msg, telegram_chat_message_t, edit_date))
+		{
+			hdr->flags |= TELEGRAM_REC_HAS_EDIT;
+			hdr->edit_date = (uint32_t)msg->edit_date;
+		}
+
+		if (msg->file != NULL)
+		{
+			hdr->flags |= TELEGRAM_REC_HAS_FILE;
+			hdr->file_size = (uint32_t)msg->file->file_size;
+			src[TELEGRAM_REC_STR_FILE_ID] = msg->file->id;
+			src[TELEGRAM_REC_STR_FILE_NAME] = msg->file->name;
+			src[TELEGRAM_REC_STR_MIME_TYPE] = msg->file->mime_type;
+		} else if (msg->photo_count > 0)
+		{
+			const telegram_photosize_t *largest = &msg->photo[0];
+
+			for (i = 1; i < msg->photo_count; i++)
+			{
+				if ((msg->photo[i].width * msg->photo[i].height) > (largest->width * largest->height))
+				{
+					largest = &msg->photo[i];
+				}
+			}
+
+			hdr->flags |= TELEGRAM_REC_HAS_PHOTO;
+			hdr->file_size = (uint32_t)largest->file_size;
+			src[TELEGRAM_REC_STR_FILE_ID] = largest->id;
+		}
+
+		if (msg->location != NULL)
+		{
+			hdr->flags |= TELEGRAM_REC_HAS_LOCATION;
+			hdr->latitude = (float)msg->location->latitude;
+			hdr->longitude = (float)msg->location->longitude;
+		}
+	}
+
+	if (from != NULL)
+	{
+		hdr->flags |= TELEGRAM_REC_HAS_FROM;
+		hdr->from_id = (int64_t)from->id;
+		if (from->is_bot)
+		{
+			hdr->flags |= TELEGRAM_REC_IS_BOT;
+		}
+
+		src[TELEGRAM_REC_STR_FROM_NAME] = from->first_name;
+		src[TELEGRAM_REC_STR_FROM_USERNAME] = from->username;
+		src[TELEGRAM_REC_STR_FROM_LANG] = from->language_code;
+	}
+}
+
+static uint32_t telegram_rec_calc_size(const char **src)
+{
+	uint32_t size = sizeof(telegram_rec_t) + 1;
+	uint32_t i;
+
+	for (i = 0; i < TELEGRAM_REC_STR_COUNT; i++)
+	{
+		if (src[i] != NULL)
+		{
+			size += strlen(src[i]) + 1;
+		}
+	}
+
+	/* Keep records placed one after another aligned */
+	size = (size + sizeof(int64_t) - 1) & ~(sizeof(int64_t) - 1);
+	return (size > TELEGRAM_REC_MAX_SIZE) ? 0 : size;
+}
+
+uint32_t telegram_rec_size_for(const telegram_update_t *upd)
+{
+	telegram_rec_t hdr;
+	const char *src[TELEGRAM_REC_STR_COUNT];
+
+	if (upd == NULL)
+	{
+		return 0;
+	}
+
+	telegram_rec_collect(upd, &hdr, src);
+	return telegram_rec_calc_size(src);
+}
+
+uint32_t telegram_rec_pack(const telegram_update_t *upd, void *buf, uint32_t buf_size)
+{
+	telegram_rec_t *rec = (telegram_rec_t *)buf;
+	const char *src[TELEGRAM_REC_STR_COUNT];
+	uint32_t size;
+	uint32_t pos = 1;
+	uint32_t len;
+	uint32_t i;
+
+	if ((upd == NULL) || (rec == NULL) || (buf_size < sizeof(telegram_rec_t)))
+	{
+		return 0;
+	}
+
+	telegram_rec_collect(upd, rec, src);
+	size = telegram_rec_calc_size(src);
+	if ((size == 0) || (size > buf_size))
+	{
+		return 0;
+	}
+
+	memset(rec->strs, 0, size - sizeof(telegram_rec_t));
+	rec->size = (uint16_t)size;
+	for (i = 0; i < TELEGRAM_REC_STR_COUNT; i++)
+	{
+		if (src[i] == NULL)
+		{
+			continue;
+		}
+
+		len = strlen(src[i]) + 1;
+		memcpy(&rec->strs[pos], src[i], len);
+		rec->str[i] = (uint16_t)pos;
+		pos += len;
+	}
+
+	return size;
+}
+
+telegram_rec_t *telegram_rec_from_update(const telegram_update_t *upd)
+{
+	telegram_rec_t *rec = NULL;
+	uint32_t size = telegram_rec_size_for(upd);
+
+	if (size == 0)
+	{
+		return NULL;
+	}
+
+	rec = telegram_malloc(TELEGRAM_MEM_PARSE, size);
+	if (rec == NULL)
+	{
+		ESP_LOGE(TAG, "No mem!");
+		return NULL;
+	}
+
+	telegram_rec_pack(upd, rec, size);
+	return rec;
+}
+
+telegram_rec_t *telegram_rec_copy(const telegram_rec_t *rec)
+{
+	telegram_rec_t *copy = NULL;
+
+	if (rec == NULL)
+	{
+		return NULL;
+	}
+
+	copy = telegram_malloc(TELEGRAM_MEM_PARSE, rec->size);
+	if (copy == NULL)
+	{
+		ESP_LOGE(TAG, "No mem!");
+		return NULL;
+	}
+
+	memcpy(copy, rec, rec->size);
+	return copy;
+}
+
+bool telegram_rec_check(const void *buf, uint32_t len)
+{
+	const telegram_rec_t *rec = (const telegram_rec_t *)buf;
+	uint32_t strs_len;
+	uint32_t i;
+
+	if ((rec == NULL) || (len < sizeof(telegram_rec_t)) || (rec->size <= sizeof(telegram_rec_t))
+		|| (rec->size > len) || ((rec->size % sizeof(int64_t)) != 0) || (rec->kind >= TELEGRAM_REC_KIND_COUNT))
+	{
+		return false;
+	}
+
+	/* Last byte is always zero, so any offset inside the area is a terminated string */
+	strs_len = rec->size - sizeof(telegram_rec_t);
+	if (rec->strs[strs_len - 1] != '\0')
+	{
+		return false;
+	}
+
+	for (i = 0; i < TELEGRAM_REC_STR_COUNT; i++)
+	{
+		if (rec->str[i] >= strs_len)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+uint32_t telegram_rec_size(const telegram_rec_t *rec)
+{
+	return (rec != NULL) ? rec->size : 0;
+}
+
+const char *telegram_rec_get_str(const telegram_rec_t *rec, telegram_rec_str_t slot)
+{
+	if ((rec == NULL) || (slot >= TELEGRAM_REC_STR_COUNT) || (rec->str[slot] == 0))
+	{
+		return NULL;
+	}
+
+	return &rec->strs[rec->str[slot]];
+}
+
+bool telegram_rec_has(const telegram_rec_t *rec, uint16_t flags)
+{
+	return (rec != NULL) && ((rec->flags & flags) == flags);
+}
+
+telegram_rec_kind_t telegram_rec_get_kind(const telegram_rec_t *rec)
+{
+	return (rec != NULL) ? (telegram_rec_kind_t)rec->kind : TELEGRAM_REC_KIND_NONE;
+}
+
+uint32_t telegram_rec_get_update_id(const telegram_rec_t *rec)
+{
+	return (rec != NULL) ? rec->update_id : 0;
+}
+
+uint32_t telegram_rec_get_message_id(const telegram_rec_t *rec)
+{
+	return (rec != NULL) ? rec->message_id : 0;
+}
+
+uint32_t telegram_rec_get_date(const telegram_rec_t *rec)
+{
+	return (rec != NULL) ? rec->date : 0;
+}
+
+uint32_t telegram_rec_get_edit_date(const telegram_rec_t *rec)
+{
+	return (rec != NULL) ? rec->edit_date : 0;
+}
+
+uint32_t telegram_rec_get_reply_to(const telegram_rec_t *rec)
+{
+	return (rec != NULL) ? rec->reply_to_message_id : 0;
+}
+
+uint32_t telegram_rec_get_file_size(const telegram_rec_t *rec)
+{
+	return (rec != NULL) ? rec->file_size : 0;
+}
+
+int64_t telegram_rec_get_chat_id(const telegram_rec_t *rec)
+{
+	return (rec != NULL) ? rec->chat_id : 0;
+}
+
+telegram_chat_type_t telegram_rec_get_chat_type(const telegram_rec_t *rec)
+{
+	return (rec != NULL) ? (telegram_chat_type_t)rec->chat_type : TELEGRAM_CHAT_TYPE_UNIMPL;
+}
+
+int64_t telegram_rec_get_from_id(const telegram_rec_t *rec)
+{
+	return (rec != NULL) ? rec->from_id : 0;
+}
+
+int64_t telegram_rec_get_forward_from_id(const telegram_rec_t *rec)
+{
+	return (rec != NULL) ? rec->forward_from_id : 0;
+}
+
+bool telegram_rec_get_location(const telegram_rec_t *rec, float *latitude, float *longitude)
+{
+	if (!telegram_rec_has(rec, TELEGRAM_REC_HAS_LOCATION))
+	{
+		return false;
+	}
+
+	if (latitude != NULL)
+	{
+		*latitude = rec->latitude;
+	}
+
+	if (longitude != NULL)
+	{
+		*longitude = rec->longitude;
+	}
+
+	return true;
+}
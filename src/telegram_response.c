@@ -0,0 +1,278 @@
+#include <string.h>
+#include <stdlib.h>
+#include "telegram_response.h"
+
+#define TELEGRAM_RESPONSE_MAX_DEPTH (32U)
+#define TELEGRAM_RESPONSE_KEY(key, len, str) (((len) == (sizeof(str) - 1)) && !memcmp((key), (str), (len)))
+
+static const char *telegram_response_ws(const char *p)
+{
+	while ((*p == ' ') || (*p == '\t') || (*p == '\r') || (*p == '\n'))
+	{
+		p++;
+	}
+
+	return p;
+}
+
+/** p points to the opening quote, returns position after the closing quote or NULL */
+static const char *telegram_response_skip_str(const char *p)
+{
+	for (p++; *p != '"'; p++)
+	{
+		if (*p == '\0')
+		{
+			return NULL;
+		}
+
+		if ((*p == '\\') && (*++p == '\0'))
+		{
+			return NULL;
+		}
+	}
+
+	return p + 1;
+}
+
+static const char *telegram_response_skip_value(const char *p)
+{
+	uint32_t depth = 0;
+
+	do
+	{
+		switch (*p)
+		{
+			case '\0':
+				return NULL;
+
+			case '"':
+				p = telegram_response_skip_str(p);
+				if (p == NULL)
+				{
+					return NULL;
+				}
+				break;
+
+			case '{':
+			case '[':
+				if (++depth > TELEGRAM_RESPONSE_MAX_DEPTH)
+				{
+					return NULL;
+				}
+				p++;
+				break;
+
+			case '}':
+			case ']':
+				if (depth == 0)
+				{
+					return p;
+				}
+				depth--;
+				p++;
+				break;
+
+			case ',':
+				if (depth == 0)
+				{
+					return p;
+				}
+				p++;
+				break;
+
+			default:
+				p++;
+				break;
+		}
+	} while ((depth != 0) || ((*p != ',') && (*p != '}') && (*p != ']') && (*p != '\0')));
+
+	return p;
+}
+
+/** Copy JSON string without quotes, escapes are simplified: control characters become spaces, \u - '?' */
+static void telegram_response_copy_str(const char *p, char *dst, uint32_t size)
+{
+	uint32_t len = 0;
+
+	for (p++; (*p != '"') && (*p != '\0') && (len < (size - 1)); p++)
+	{
+		if (*p == '\\')
+		{
+			p++;
+			switch (*p)
+			{
+				case '"':
+				case '\\':
+				case '/':
+					dst[len++] = *p;
+					break;
+
+				case 'u':
+					dst[len++] = '?';
+					p += (strnlen(p + 1, 4) == 4) ? 4 : 0;
+					break;
+
+				case '\0':
+					p--;
+					break;
+
+				default:
+					dst[len++] = ' ';
+					break;
+			}
+		} else
+		{
+			dst[len++] = *p;
+		}
+	}
+
+	dst[len] = '\0';
+}
+
+/**
+ Scans object at p, returns position after it or NULL. Top-level scan stops right after "ok": true,
+ so the result of the successful answer is never walked.
+*/
+static const char *telegram_response_object(const char *p, telegram_response_t *resp, bool params)
+{
+	const char *key;
+	uint32_t len;
+	long val;
+
+	p = telegram_response_ws(p);
+	if (*p != '{')
+	{
+		return NULL;
+	}
+
+	p = telegram_response_ws(p + 1);
+	if (*p == '}')
+	{
+		return p + 1;
+	}
+
+	while (true)
+	{
+		if (*p != '"')
+		{
+			return NULL;
+		}
+
+		key = p + 1;
+		p = telegram_response_skip_str(p);
+		if (p == NULL)
+		{
+			return NULL;
+		}
+
+		len = p - key - 1;
+		p = telegram_response_ws(p);
+		if (*p != ':')
+		{
+			return NULL;
+		}
+
+		p = telegram_response_ws(p + 1);
+		if (params)
+		{
+			if (TELEGRAM_RESPONSE_KEY(key, len, "retry_after"))
+			{
+				val = strtol(p, NULL, 10);
+				resp->retry_after = (val > 0) ? (uint32_t)val : 0;
+			} else if (TELEGRAM_RESPONSE_KEY(key, len, "migrate_to_chat_id"))
+			{
+				resp->migrate_to_chat_id = strtod(p, NULL);
+			}
+		} else if (TELEGRAM_RESPONSE_KEY(key, len, "ok"))
+		{
+			resp->ok = !strncmp(p, "true", 4);
+			if (resp->ok)
+			{
+				return p + 4;
+			}
+		} else if (TELEGRAM_RESPONSE_KEY(key, len, "error_code"))
+		{
+			resp->error_code = strtol(p, NULL, 10);
+		} else if (TELEGRAM_RESPONSE_KEY(key, len, "description") && (*p == '"'))
+		{
+			telegram_response_copy_str(p, resp->description, sizeof(resp->description));
+		} else if (TELEGRAM_RESPONSE_KEY(key, len, "parameters") && (*p == '{'))
+		{
+			p = telegram_response_object(p, resp, true);
+			if (p == NULL)
+			{
+				return NULL;
+			}
+		}
+
+		p = telegram_response_skip_value(p);
+		if (p == NULL)
+		{
+			return NULL;
+		}
+
+		p = telegram_response_ws(p);
+		if (*p == '}')
+		{
+			return p + 1;
+		}
+
+		if (*p != ',')
+		{
+			return NULL;
+		}
+
+		p = telegram_response_ws(p + 1);
+	}
+}
+
+bool telegram_response_parse(const char *buffer, telegram_response_t *resp)
+{
+	if (resp == NULL)
+	{
+		return false;
+	}
+
+	memset(resp, 0, sizeof(telegram_response_t));
+	if (buffer == NULL)
+	{
+		return false;
+	}
+
+	return (telegram_response_object(buffer, resp, false) != NULL);
+}
+
+telegram_response_class_t telegram_response_classify(const telegram_response_t *resp)
+{
+	if (resp->ok)
+	{
+		return TELEGRAM_RESPONSE_OK;
+	}
+
+	if (resp->migrate_to_chat_id != 0)
+	{
+		return TELEGRAM_RESPONSE_MIGRATED;
+	}
+
+	switch (resp->error_code)
+	{
+		case 0:
+			return TELEGRAM_RESPONSE_INVALID;
+
+		case 400:
+			return (strstr(resp->description, "chat not found") != NULL) ? TELEGRAM_RESPONSE_CHAT_NOT_FOUND
+				: TELEGRAM_RESPONSE_BAD_REQUEST;
+
+		case 401:
+			return TELEGRAM_RESPONSE_UNAUTHORIZED;
+
+		case 403:
+			return TELEGRAM_RESPONSE_FORBIDDEN;
+
+		case 429:
+			return TELEGRAM_RESPONSE_FLOOD;
+
+		default:
+			return (resp->error_code >= 500) ? TELEGRAM_RESPONSE_SERVER : TELEGRAM_RESPONSE_OTHER;
+	}
+}
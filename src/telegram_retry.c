@@ -0,0 +1,89 @@
+#include <esp_log.h>
+#include <esp_system.h>
+#include "telegram_retry.h"
+
+static const char *TAG="telegram_retry";
+
+bool telegram_retry_is_idempotent(telegram_method_t method)
+{
+	switch (method)
+	{
+		case TELEGRAM_SEND_MESSAGE:
+		case TELEGRAM_SEND_FILE:
+		case TELEGRAM_SEND_PHOTO:
+		case TELEGRAM_SEND_MEDIA_GROUP:
+			return false;
+
+		default:
+			return true;
+	}
+}
+
+static uint32_t telegram_retry_backoff(uint32_t attempt)
+{
+	uint32_t delay = TELEGRAM_RETRY_MAX_MS;
+
+	if (attempt <= 16)
+	{
+		delay = TELEGRAM_RETRY_BASE_MS << (attempt - 1);
+	}
+
+	if (delay > TELEGRAM_RETRY_MAX_MS)
+	{
+		delay = TELEGRAM_RETRY_MAX_MS;
+	}
+
+	/* Equal jitter: half of the delay is fixed, the other half is random, so devices do not retry in sync */
+	return delay / 2 + esp_random() % (delay / 2 + 1);
+}
+
+bool telegram_retry_next(telegram_method_t method, uint32_t attempt, const telegram_io_info_t *info, 
+	uint32_t retry_after, uint32_t *delay_ms)
+{
+	bool retry = false;
+	telegram_io_fail_t fail = telegram_io_classify(info);
+
+	if ((attempt == 0) || (attempt >= TELEGRAM_RETRY_ATTEMPTS) || (delay_ms == NULL))
+	{
+		return false;
+	}
+
+	*delay_ms = telegram_retry_backoff(attempt);
+	switch (fail)
+	{
+		case TELEGRAM_IO_FAIL_CONNECT:
+		case TELEGRAM_IO_FAIL_SEND:
+			retry = true;
+			break;
+
+		case TELEGRAM_IO_FAIL_TIMEOUT:
+		case TELEGRAM_IO_FAIL_SERVER:
+			retry = telegram_retry_is_idempotent(method);
+			break;
+
+		case TELEGRAM_IO_FAIL_FLOOD:
+			if (retry_after > TELEGRAM_RETRY_MAX_MS / 1000)
+			{
+				ESP_LOGW(TAG, "retry_after %u is too long", retry_after);
+				break;
+			}
+
+			if (retry_after)
+			{
+				*delay_ms = retry_after * 1000 + *delay_ms / 2;
+			}
+			retry = true;
+			break;
+
+		default:
+			break;
+	}
+
+	if (retry)
+	{
+		ESP_LOGW(TAG, "Method %d attempt %u failed (class %d status %d err %d), retry in %u ms", 
+			method, attempt, fail, info->status, info->err, *delay_ms);
+	}
+
+	return retry;
+}
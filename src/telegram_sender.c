@@ -0,0 +1,228 @@
+#include <string.h>
+#include <esp_log.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include <freertos/queue.h>
+#include "telegram_sender.h"
+#include "telegram_mem.h"
+
+static const char *TAG="telegram_sender";
+
+typedef struct
+{
+	telegram_method_t method; /** TELEGRAM_METHOD_COUNT - stop the task */
+	telegram_int_t chat_id;
+	char *payload;
+	telegram_send_done_cb_t cb;
+	void *ctx;
+} telegram_sender_job_t;
+
+typedef struct
+{
+	QueueHandle_t queue;
+	TaskHandle_t task;
+	SemaphoreHandle_t stopped;
+	telegram_sender_exec_t exec;
+	void *owner;
+	bool self_stop; /** Stopped from a completion callback, set and read only by the sender task */
+} telegram_sender_t;
+
+typedef struct
+{
+	telegram_sender_t *sender;
+	telegram_sender_job_t *job;
+	telegram_send_result_t res;
+	bool reported;
+} telegram_sender_report_t;
+
+static void telegram_sender_report_cb(void *ctx, telegram_update_t *upd)
+{
+	telegram_sender_report_t *report = (telegram_sender_report_t *)ctx;
+
+	if (report->reported)
+	{
+		return;
+	}
+
+	report->res.message = upd->message;
+	report->job->cb(report->sender->owner, report->job->ctx, &report->res);
+	report->res.message = NULL;
+	report->reported = true;
+}
+
+static void telegram_sender_execute(telegram_sender_t *sender, telegram_sender_job_t *job)
+{
+	char *response = NULL;
+	telegram_io_info_t info = {0};
+	telegram_sender_report_t report = {.sender = sender, .job = job};
+
+	report.res.method = job->method;
+	report.res.ok = sender->exec(sender->owner, job->method, job->chat_id, job->payload, &response, &info, 
+		&report.res.api);
+	report.res.status = info.status;
+	report.res.err = info.err;
+
+	if (job->cb != NULL)
+	{
+		telegram_parse_messages(&report, response, telegram_sender_report_cb);
+		if (!report.reported)
+		{
+			job->cb(sender->owner, job->ctx, &report.res);
+		}
+	}
+
+	telegram_free_tag(TELEGRAM_MEM_IO, response);
+	telegram_free_tag(TELEGRAM_MEM_MAKE, job->payload);
+}
+
+static void telegram_sender_free(telegram_sender_t *sender)
+{
+	if (sender->queue != NULL)
+	{
+		vQueueDelete(sender->queue);
+	}
+
+	if (sender->stopped != NULL)
+	{
+		vSemaphoreDelete(sender->stopped);
+	}
+
+	telegram_free_tag(TELEGRAM_MEM_CORE, sender);
+}
+
+static void telegram_sender_task(void *param)
+{
+	telegram_sender_job_t job;
+	telegram_sender_t *sender = (telegram_sender_t *)param;
+
+	while (true)
+	{
+		if (xQueueReceive(sender->queue, &job, portMAX_DELAY) != pdTRUE)
+		{
+			continue;
+		}
+
+		if (job.method == TELEGRAM_METHOD_COUNT)
+		{
+			if (sender->self_stop)
+			{
+				telegram_sender_free(sender);
+				vTaskDelete(NULL);
+			}
+
+			xSemaphoreGive(sender->stopped);
+			vTaskSuspend(NULL);
+		}
+
+		if (sender->self_stop)
+		{
+			/* Owner may be already freed */
+			telegram_free_tag(TELEGRAM_MEM_MAKE, job.payload);
+			continue;
+		}
+
+		telegram_sender_execute(sender, &job);
+	}
+}
+
+void *telegram_sender_init(uint32_t queue_len, telegram_sender_exec_t exec, void *owner)
+{
+	telegram_sender_t *sender = NULL;
+
+	if (exec == NULL)
+	{
+		return NULL;
+	}
+
+	if (queue_len == 0)
+	{
+		queue_len = TELEGRAM_SENDER_QUEUE_LEN;
+	}
+
+	sender = telegram_calloc(TELEGRAM_MEM_CORE, 1, sizeof(telegram_sender_t));
+	if (sender == NULL)
+	{
+		ESP_LOGE(TAG, "No mem!");
+		return NULL;
+	}
+
+	sender->exec = exec;
+	sender->owner = owner;
+	/* One extra slot for the stop request */
+	sender->queue = xQueueCreate(queue_len + 1, sizeof(telegram_sender_job_t));
+	vSemaphoreCreateBinary(sender->stopped);
+	if ((sender->queue == NULL) || (sender->stopped == NULL))
+	{
+		ESP_LOGE(TAG, "No mem!");
+		telegram_sender_stop(sender);
+		return NULL;
+	}
+
+	xSemaphoreTake(sender->stopped, 0);
+	if (xTaskCreate(&telegram_sender_task, "telegram_sender", TELEGRAM_SENDER_TASK_STACK, sender, 5, &sender->task) != pdPASS)
+	{
+		ESP_LOGE(TAG, "Failed to create task");
+		sender->task = NULL;
+		telegram_sender_stop(sender);
+		return NULL;
+	}
+
+	return sender;
+}
+
+bool telegram_sender_push(void *sender_ptr, telegram_method_t method, telegram_int_t chat_id, char *payload, 
+	telegram_send_done_cb_t cb, void *ctx)
+{
+	telegram_sender_job_t job = {.method = method, .chat_id = chat_id, .payload = payload, .cb = cb, .ctx = ctx};
+	telegram_sender_t *sender = (telegram_sender_t *)sender_ptr;
+
+	if ((sender == NULL) || (payload == NULL) || (method >= TELEGRAM_METHOD_COUNT))
+	{
+		telegram_free_tag(TELEGRAM_MEM_MAKE, payload);
+		return false;
+	}
+
+	if (uxQueueSpacesAvailable(sender->queue) <= 1)
+	{
+		ESP_LOGW(TAG, "Queue is full");
+		telegram_free_tag(TELEGRAM_MEM_MAKE, payload);
+		return false;
+	}
+
+	if (xQueueSendToBack(sender->queue, &job, 0) != pdTRUE)
+	{
+		telegram_free_tag(TELEGRAM_MEM_MAKE, payload);
+		return false;
+	}
+
+	return true;
+}
+
+void telegram_sender_stop(void *sender_ptr)
+{
+	telegram_sender_job_t job = {.method = TELEGRAM_METHOD_COUNT};
+	telegram_sender_t *sender = (telegram_sender_t *)sender_ptr;
+
+	if (sender == NULL)
+	{
+		return;
+	}
+
+	if ((sender->task != NULL) && (sender->task == xTaskGetCurrentTaskHandle()))
+	{
+		/* Called from a completion callback: the task can not wait for itself, it exits after the callback */
+		sender->self_stop = true;
+		xQueueSendToBack(sender->queue, &job, 0);
+		return;
+	}
+
+	if (sender->task != NULL)
+	{
+		xQueueSendToBack(sender->queue, &job, portMAX_DELAY);
+		xSemaphoreTake(sender->stopped, portMAX_DELAY);
+		vTaskDelete(sender->task);
+	}
+
+	telegram_sender_free(sender);
+}
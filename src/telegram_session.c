@@ -0,0 +1,414 @@
+#include <string.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include "telegram_session.h"
+#include "telegram_mem.h"
+
+#define TELEGRAM_SESSION_NONE  (UINT32_MAX)
+#define TELEGRAM_SESSION_USED  (1U << 0)
+#define TELEGRAM_SESSION_DIRTY (1U << 1)
+
+static const char *TAG="telegram_session";
+
+/** Slot header, session data follows it */
+typedef struct
+{
+	int64_t id;
+	int64_t last_us;
+	uint32_t prev;  /** LRU list, towards the most recently used */
+	uint32_t next;  /** LRU list or free list */
+	uint32_t flags;
+	uint32_t reserved;
+} telegram_session_slot_t;
+
+typedef struct
+{
+	telegram_session_cfg_t cfg;
+	int64_t ttl_us;
+	uint32_t slot_size;
+	uint32_t mask;      /** Index size - 1, index is at least twice bigger than capacity */
+	uint32_t *index;    /** Slot numbers, linear probing */
+	uint8_t *slab;
+	uint32_t head;      /** Most recently used */
+	uint32_t tail;      /** Least recently used */
+	uint32_t free_list;
+	telegram_session_stats_t stats;
+} telegram_session_store_t;
+
+static telegram_session_slot_t *telegram_session_slot(telegram_session_store_t *store, uint32_t n)
+{
+	return (telegram_session_slot_t *)&store->slab[n * store->slot_size];
+}
+
+static void *telegram_session_data(telegram_session_slot_t *slot)
+{
+	return (uint8_t *)slot + sizeof(telegram_session_slot_t);
+}
+
+/** 64-bit finalizer, spreads sequential ids over the index */
+static uint32_t telegram_session_hash(telegram_session_store_t *store, int64_t id)
+{
+	uint64_t x = (uint64_t)id;
+
+	x ^= x >> 33;
+	x *= 0xff51afd7ed558ccdULL;
+	x ^= x >> 33;
+	x *= 0xc4ceb9fe1a85ec53ULL;
+	x ^= x >> 33;
+	return (uint32_t)x & store->mask;
+}
+
+/** Returns slot number or NONE, pos is set to the index position of the session or to the free position */
+static uint32_t telegram_session_lookup(telegram_session_store_t *store, int64_t id, uint32_t *pos)
+{
+	uint32_t i = telegram_session_hash(store, id);
+
+	while (store->index[i] != TELEGRAM_SESSION_NONE)
+	{
+		if (telegram_session_slot(store, store->index[i])->id == id)
+		{
+			*pos = i;
+			return store->index[i];
+		}
+
+		i = (i + 1) & store->mask;
+	}
+
+	*pos = i;
+	return TELEGRAM_SESSION_NONE;
+}
+
+/** Backward shift deletion, keeps probe sequences without tombstones */
+static void telegram_session_index_remove(telegram_session_store_t *store, uint32_t pos)
+{
+	uint32_t i = pos;
+	uint32_t j = pos;
+	uint32_t k;
+
+	for (;;)
+	{
+		store->index[i] = TELEGRAM_SESSION_NONE;
+		for (;;)
+		{
+			j = (j + 1) & store->mask;
+			if (store->index[j] == TELEGRAM_SESSION_NONE)
+			{
+				return;
+			}
+
+			/* Entry at j stays if its home position is cyclically in (i, j] */
+			k = telegram_session_hash(store, telegram_session_slot(store, store->index[j])->id);
+			if ((i <= j) ? ((i < k) && (k <= j)) : ((i < k) || (k <= j)))
+			{
+				continue;
+			}
+
+			break;
+		}
+
+		store->index[i] = store->index[j];
+		i = j;
+	}
+}
+
+static void telegram_session_unlink(telegram_session_store_t *store, uint32_t n)
+{
+	telegram_session_slot_t *slot = telegram_session_slot(store, n);
+
+	if (slot->prev != TELEGRAM_SESSION_NONE)
+	{
+		telegram_session_slot(store, slot->prev)->next = slot->next;
+	} else
+	{
+		store->head = slot->next;
+	}
+
+	if (slot->next != TELEGRAM_SESSION_NONE)
+	{
+		telegram_session_slot(store, slot->next)->prev = slot->prev;
+	} else
+	{
+		store->tail = slot->prev;
+	}
+}
+
+static void telegram_session_link_head(telegram_session_store_t *store, uint32_t n)
+{
+	telegram_session_slot_t *slot = telegram_session_slot(store, n);
+
+	slot->prev = TELEGRAM_SESSION_NONE;
+	slot->next = store->head;
+	if (store->head != TELEGRAM_SESSION_NONE)
+	{
+		telegram_session_slot(store, store->head)->prev = n;
+	} else
+	{
+		store->tail = n;
+	}
+
+	store->head = n;
+}
+
+static void telegram_session_save(telegram_session_store_t *store, telegram_session_slot_t *slot)
+{
+	if ((slot->flags & TELEGRAM_SESSION_DIRTY) && (store->cfg.save != NULL))
+	{
+		store->cfg.save(store->cfg.ctx, slot->id, telegram_session_data(slot), store->cfg.data_size);
+	}
+
+	slot->flags &= ~TELEGRAM_SESSION_DIRTY;
+}
+
+static void telegram_session_drop(telegram_session_store_t *store, uint32_t n, bool save)
+{
+	uint32_t pos;
+	telegram_session_slot_t *slot = telegram_session_slot(store, n);
+
+	if (save)
+	{
+		telegram_session_save(store, slot);
+	}
+
+	if (telegram_session_lookup(store, slot->id, &pos) == n)
+	{
+		telegram_session_index_remove(store, pos);
+	}
+
+	telegram_session_unlink(store, n);
+	slot->flags = 0;
+	slot->next = store->free_list;
+	store->free_list = n;
+	store->stats.count--;
+}
+
+static bool telegram_session_is_expired(telegram_session_store_t *store, telegram_session_slot_t *slot, int64_t now)
+{
+	return (store->ttl_us != 0) && ((now - slot->last_us) >= store->ttl_us);
+}
+
+void *telegram_session_init(const telegram_session_cfg_t *cfg)
+{
+	uint32_t i;
+	uint32_t index_size = 1;
+	telegram_session_store_t *store = telegram_calloc(TELEGRAM_MEM_CORE, 1, sizeof(telegram_session_store_t));
+
+	if (store == NULL)
+	{
+		ESP_LOGE(TAG, "No mem!");
+		return NULL;
+	}
+
+	if (cfg != NULL)
+	{
+		store->cfg = *cfg;
+	}
+
+	if (store->cfg.capacity == 0)
+	{
+		store->cfg.capacity = TELEGRAM_SESSION_CAPACITY;
+	}
+
+	if (store->cfg.data_size == 0)
+	{
+		store->cfg.data_size = TELEGRAM_SESSION_DATA_SIZE;
+	}
+
+	while (index_size < (store->cfg.capacity * 2))
+	{
+		index_size <<= 1;
+	}
+
+	store->mask = index_size - 1;
+	store->ttl_us = (int64_t)store->cfg.ttl_sec * 1000000LL;
+	store->slot_size = sizeof(telegram_session_slot_t) + ((store->cfg.data_size + 7U) & ~7U);
+	store->index = telegram_malloc(TELEGRAM_MEM_CORE, index_size * sizeof(uint32_t));
+	store->slab = telegram_calloc(TELEGRAM_MEM_CORE, store->cfg.capacity, store->slot_size);
+	if ((store->index == NULL) || (store->slab == NULL))
+	{
+		ESP_LOGE(TAG, "No mem!");
+		telegram_session_free(store);
+		return NULL;
+	}
+
+	memset(store->index, 0xFF, index_size * sizeof(uint32_t));
+	store->head = TELEGRAM_SESSION_NONE;
+	store->tail = TELEGRAM_SESSION_NONE;
+	store->free_list = TELEGRAM_SESSION_NONE;
+	for (i = store->cfg.capacity; i > 0; i--)
+	{
+		telegram_session_slot(store, i - 1)->next = store->free_list;
+		store->free_list = i - 1;
+	}
+
+	return store;
+}
+
+void *telegram_session_get(void *store_ptr, int64_t id, bool create)
+{
+	uint32_t n;
+	uint32_t pos;
+	telegram_session_slot_t *slot = NULL;
+	telegram_session_store_t *store = (telegram_session_store_t *)store_ptr;
+	int64_t now = esp_timer_get_time();
+
+	if (store == NULL)
+	{
+		return NULL;
+	}
+
+	n = telegram_session_lookup(store, id, &pos);
+	if (n != TELEGRAM_SESSION_NONE)
+	{
+		slot = telegram_session_slot(store, n);
+		if (!telegram_session_is_expired(store, slot, now))
+		{
+			store->stats.hits++;
+			slot->last_us = now;
+			if (store->head != n)
+			{
+				telegram_session_unlink(store, n);
+				telegram_session_link_head(store, n);
+			}
+
+			return telegram_session_data(slot);
+		}
+
+		telegram_session_drop(store, n, true);
+		store->stats.expired++;
+	}
+
+	store->stats.misses++;
+	if (!create)
+	{
+		return NULL;
+	}
+
+	if (store->free_list == TELEGRAM_SESSION_NONE)
+	{
+		telegram_session_drop(store, store->tail, true);
+		store->stats.evictions++;
+	}
+
+	/* Drop may shift index entries, find free position again */
+	telegram_session_lookup(store, id, &pos);
+	n = store->free_list;
+	slot = telegram_session_slot(store, n);
+	store->free_list = slot->next;
+	slot->id = id;
+	slot->last_us = now;
+	slot->flags = TELEGRAM_SESSION_USED;
+	memset(telegram_session_data(slot), 0, store->cfg.data_size);
+	if (store->cfg.load != NULL)
+	{
+		store->cfg.load(store->cfg.ctx, id, telegram_session_data(slot), store->cfg.data_size);
+	}
+
+	store->index[pos] = n;
+	telegram_session_link_head(store, n);
+	store->stats.count++;
+	return telegram_session_data(slot);
+}
+
+void telegram_session_mark_dirty(void *store_ptr, void *data)
+{
+	uint8_t *ptr = (uint8_t *)data;
+	telegram_session_store_t *store = (telegram_session_store_t *)store_ptr;
+
+	if ((store == NULL) || (ptr < store->slab + sizeof(telegram_session_slot_t))
+		|| (ptr >= store->slab + store->cfg.capacity * store->slot_size))
+	{
+		return;
+	}
+
+	((telegram_session_slot_t *)(ptr - sizeof(telegram_session_slot_t)))->flags |= TELEGRAM_SESSION_DIRTY;
+}
+
+void telegram_session_remove(void *store_ptr, int64_t id)
+{
+	uint32_t n;
+	uint32_t pos;
+	telegram_session_store_t *store = (telegram_session_store_t *)store_ptr;
+
+	if (store == NULL)
+	{
+		return;
+	}
+
+	n = telegram_session_lookup(store, id, &pos);
+	if (n != TELEGRAM_SESSION_NONE)
+	{
+		telegram_session_drop(store, n, false);
+	}
+}
+
+void telegram_session_expire(void *store_ptr)
+{
+	telegram_session_store_t *store = (telegram_session_store_t *)store_ptr;
+	int64_t now = esp_timer_get_time();
+
+	if ((store == NULL) || (store->ttl_us == 0))
+	{
+		return;
+	}
+
+	/* LRU order is the order of last use, stop at the first live session */
+	while ((store->tail != TELEGRAM_SESSION_NONE)
+		&& telegram_session_is_expired(store, telegram_session_slot(store, store->tail), now))
+	{
+		telegram_session_drop(store, store->tail, true);
+		store->stats.expired++;
+	}
+}
+
+void telegram_session_flush(void *store_ptr)
+{
+	uint32_t n;
+	telegram_session_store_t *store = (telegram_session_store_t *)store_ptr;
+
+	if ((store == NULL) || (store->cfg.save == NULL))
+	{
+		return;
+	}
+
+	for (n = store->head; n != TELEGRAM_SESSION_NONE; n = telegram_session_slot(store, n)->next)
+	{
+		telegram_session_save(store, telegram_session_slot(store, n));
+	}
+}
+
+void telegram_session_get_stats(void *store_ptr, telegram_session_stats_t *stats)
+{
+	telegram_session_store_t *store = (telegram_session_store_t *)store_ptr;
+
+	if (stats == NULL)
+	{
+		return;
+	}
+
+	if (store == NULL)
+	{
+		memset(stats, 0, sizeof(telegram_session_stats_t));
+		return;
+	}
+
+	*stats = store->stats;
+}
+
+void telegram_session_free(void *store_ptr)
+{
+	telegram_session_store_t *store = (telegram_session_store_t *)store_ptr;
+
+	if (store == NULL)
+	{
+		return;
+	}
+
+	if (store->slab != NULL)
+	{
+		telegram_session_flush(store);
+	}
+
+	telegram_free_tag(TELEGRAM_MEM_CORE, store->index);
+	telegram_free_tag(TELEGRAM_MEM_CORE, store->slab);
+	telegram_free_tag(TELEGRAM_MEM_CORE, store);
+}
@@ -0,0 +1,193 @@
+#include <string.h>
+#include <esp_log.h>
+#include "telegram_snap.h"
+#include "telegram_mem.h"
+
+static const char *TAG="telegram_snap";
+
+/** Half-byte table of the reflected CRC-32 (IEEE 802.3, same as zlib), 64 bytes instead of 1K for the full table */
+static const uint32_t telegram_snap_crc_tbl[16] =
+{
+	0x00000000U, 0x1DB71064U, 0x3B6E20C8U, 0x26D930ACU, 0x76DC4190U, 0x6B6B51F4U, 0x4DB26158U, 0x5005713CU,
+	0xEDB88320U, 0xF00F9344U, 0xD6D6A3E8U, 0xCB61B38CU, 0x9B64C2B0U, 0x86D3D2D4U, 0xA00AE278U, 0xBDBDF21CU,
+};
+
+static uint32_t telegram_snap_crc(uint32_t crc, const uint8_t *data, uint32_t len)
+{
+	crc = ~crc;
+	while (len--)
+	{
+		crc ^= *data++;
+		crc = (crc >> 4) ^ telegram_snap_crc_tbl[crc & 0x0F];
+		crc = (crc >> 4) ^ telegram_snap_crc_tbl[crc & 0x0F];
+	}
+
+	return ~crc;
+}
+
+static uint8_t *telegram_snap_data(const telegram_snap_t *snap)
+{
+	return (uint8_t *)snap + sizeof(telegram_snap_t);
+}
+
+telegram_snap_t *telegram_snap_init(void *buf, uint32_t buf_size)
+{
+	telegram_snap_t *snap = (telegram_snap_t *)buf;
+
+	if ((snap == NULL) || (buf_size < sizeof(telegram_snap_t)))
+	{
+		return NULL;
+	}
+
+	memset(snap, 0, sizeof(telegram_snap_t));
+	snap->magic = TELEGRAM_SNAP_MAGIC;
+	snap->version = TELEGRAM_SNAP_VERSION;
+	snap->rec_hdr = sizeof(telegram_rec_t);
+	snap->size = sizeof(telegram_snap_t);
+	snap->crc = telegram_snap_crc(0, NULL, 0);
+	return snap;
+}
+
+bool telegram_snap_add(telegram_snap_t *snap, uint32_t buf_size, const telegram_update_t *upd)
+{
+	uint8_t *dst = NULL;
+	uint32_t size;
+
+	if ((snap == NULL) || (upd == NULL) || (buf_size < snap->size))
+	{
+		return false;
+	}
+
+	dst = (uint8_t *)snap + snap->size;
+	size = telegram_rec_pack(upd, dst, buf_size - snap->size);
+	if (size == 0)
+	{
+		return false;
+	}
+
+	snap->crc = telegram_snap_crc(snap->crc, dst, size);
+	snap->size += size;
+	snap->count++;
+	return true;
+}
+
+bool telegram_snap_add_rec(telegram_snap_t *snap, uint32_t buf_size, const telegram_rec_t *rec)
+{
+	uint8_t *dst = NULL;
+	uint32_t size = telegram_rec_size(rec);
+
+	if ((snap == NULL) || (size == 0) || (buf_size < snap->size) || ((buf_size - snap->size) < size))
+	{
+		return false;
+	}
+
+	dst = (uint8_t *)snap + snap->size;
+	memcpy(dst, rec, size);
+	snap->crc = telegram_snap_crc(snap->crc, dst, size);
+	snap->size += size;
+	snap->count++;
+	return true;
+}
+
+telegram_snap_t *telegram_snap_from_update(const telegram_update_t *upd)
+{
+	telegram_snap_t *snap = NULL;
+	uint32_t size = telegram_rec_size_for(upd);
+
+	if (size == 0)
+	{
+		return NULL;
+	}
+
+	size += sizeof(telegram_snap_t);
+	snap = telegram_malloc(TELEGRAM_MEM_PARSE, size);
+	if (snap == NULL)
+	{
+		ESP_LOGE(TAG, "No mem!");
+		return NULL;
+	}
+
+	telegram_snap_init(snap, size);
+	telegram_snap_add(snap, size, upd);
+	return snap;
+}
+
+uint32_t telegram_snap_size(const telegram_snap_t *snap)
+{
+	return (snap != NULL) ? snap->size : 0;
+}
+
+uint32_t telegram_snap_count(const telegram_snap_t *snap)
+{
+	return (snap != NULL) ? snap->count : 0;
+}
+
+const telegram_snap_t *telegram_snap_check(const void *buf, uint32_t len)
+{
+	const telegram_snap_t *snap = (const telegram_snap_t *)buf;
+	const uint8_t *data = NULL;
+	uint32_t pos = 0;
+	uint32_t data_len;
+	uint32_t i;
+
+	if ((snap == NULL) || (len < sizeof(telegram_snap_t)))
+	{
+		return NULL;
+	}
+
+	if ((snap->magic != TELEGRAM_SNAP_MAGIC) || (snap->version != TELEGRAM_SNAP_VERSION)
+		|| (snap->rec_hdr != sizeof(telegram_rec_t)))
+	{
+		ESP_LOGW(TAG, "Unknown snapshot format");
+		return NULL;
+	}
+
+	if ((snap->size < sizeof(telegram_snap_t)) || (snap->size > len))
+	{
+		ESP_LOGW(TAG, "Truncated snapshot %u/%u", snap->size, len);
+		return NULL;
+	}
+
+	data = telegram_snap_data(snap);
+	data_len = snap->size - sizeof(telegram_snap_t);
+	if (telegram_snap_crc(0, data, data_len) != snap->crc)
+	{
+		ESP_LOGW(TAG, "Snapshot CRC mismatch");
+		return NULL;
+	}
+
+	for (i = 0; i < snap->count; i++)
+	{
+		if (!telegram_rec_check(&data[pos], data_len - pos))
+		{
+			ESP_LOGW(TAG, "Bad record %u", i);
+			return NULL;
+		}
+
+		pos += telegram_rec_size((const telegram_rec_t *)&data[pos]);
+	}
+
+	return (pos == data_len) ? snap : NULL;
+}
+
+const telegram_rec_t *telegram_snap_next(const telegram_snap_t *snap, const telegram_rec_t *prev)
+{
+	const uint8_t *end = NULL;
+	const uint8_t *next = NULL;
+
+	if (snap == NULL)
+	{
+		return NULL;
+	}
+
+	end = (const uint8_t *)snap + snap->size;
+	if (prev == NULL)
+	{
+		next = telegram_snap_data(snap);
+	} else
+	{
+		next = (const uint8_t *)prev + telegram_rec_size(prev);
+	}
+
+	return (next < end) ? (const telegram_rec_t *)next : NULL;
+}
@@ -0,0 +1,59 @@
+#include <string.h>
+#include "telegram_stats.h"
+
+void telegram_stats_sample(telegram_stats_hist_t *hist, int64_t us)
+{
+	uint32_t bucket = 0;
+	uint32_t ms;
+
+	if ((hist == NULL) || (us < 0))
+	{
+		return;
+	}
+
+	ms = (uint32_t)(us / 1000);
+	while (ms && (bucket < (TELEGRAM_STATS_HIST_BUCKETS - 1)))
+	{
+		ms >>= 1;
+		bucket++;
+	}
+
+	hist->buckets[bucket]++;
+	hist->count++;
+	hist->sum_us += (uint64_t)us;
+	if ((uint64_t)us > hist->max_us)
+	{
+		hist->max_us = (us > UINT32_MAX)?UINT32_MAX:(uint32_t)us;
+	}
+}
+
+void telegram_stats_request(telegram_stats_t *stats, telegram_method_t method, const telegram_io_info_t *info)
+{
+	telegram_method_stats_t *m = NULL;
+
+	if ((stats == NULL) || (info == NULL) || (method >= TELEGRAM_METHOD_COUNT))
+	{
+		return;
+	}
+
+	m = &stats->methods[method];
+	m->requests++;
+	if ((info->err != 0) || (info->status < 200) || (info->status > 299))
+	{
+		m->errors++;
+	}
+
+	m->bytes_out += info->bytes_out;
+	m->bytes_in += info->bytes_in;
+	if (info->connect_us)
+	{
+		telegram_stats_sample(&m->connect, info->connect_us);
+	}
+
+	if (info->first_byte_us)
+	{
+		telegram_stats_sample(&m->first_byte, info->first_byte_us);
+	}
+
+	telegram_stats_sample(&m->total, info->total_us);
+}
@@ -0,0 +1,40 @@
+#include <stdlib.h>
+#include <freertos/FreeRTOS.h>
+#include <esp_timer.h>
+#include "telegram_trace.h"
+
+#if TELEGRAM_TRACE_ENABLE == 1
+static telegram_trace_cb_t telegram_trace_cb = NULL;
+static uint32_t telegram_trace_id = 0;
+static portMUX_TYPE telegram_trace_lock = portMUX_INITIALIZER_UNLOCKED;
+
+void telegram_trace_set_cb(telegram_trace_cb_t cb)
+{
+	telegram_trace_cb = cb;
+}
+
+uint32_t telegram_trace_new_id(void)
+{
+	uint32_t id;
+
+	portENTER_CRITICAL(&telegram_trace_lock);
+	id = ++telegram_trace_id;
+	if (id == 0)
+	{
+		id = ++telegram_trace_id;
+	}
+	portEXIT_CRITICAL(&telegram_trace_lock);
+
+	return id;
+}
+
+void telegram_trace_emit(telegram_trace_evt_t evt, uint32_t req_id, uint32_t arg)
+{
+	telegram_trace_cb_t cb = telegram_trace_cb;
+
+	if (cb != NULL)
+	{
+		cb(evt, req_id, esp_timer_get_time(), arg);
+	}
+}
+#endif
@@ -0,0 +1,224 @@
+#include <string.h>
+#include <esp_log.h>
+#include <esp_http_server.h>
+#include "telegram_webhook.h"
+#include "telegram_io.h"
+#include "telegram_mem.h"
+#if TELEGRAM_WEBHOOK_HTTPS == 1
+#include <esp_https_server.h>
+#endif
+
+static const char *TAG="telegram_webhook";
+
+typedef struct
+{
+	httpd_handle_t server;
+	char *path;
+	char *secret_token;
+	telegram_webhook_on_update_t on_update;
+	void *ctx;
+} telegram_webhook_t;
+
+static bool telegram_webhook_check_secret(telegram_webhook_t *hook, httpd_req_t *req)
+{
+	char secret[TELEGRAM_WEBHOOK_SECRET_MAX_LEN + 1];
+
+	if (hook->secret_token == NULL)
+	{
+		return true;
+	}
+
+	if (httpd_req_get_hdr_value_str(req, TELEGRAM_WEBHOOK_SECRET_HDR, secret, sizeof(secret)) != ESP_OK)
+	{
+		return false;
+	}
+
+	return !strcmp(secret, hook->secret_token);
+}
+
+static esp_err_t telegram_webhook_send_status(httpd_req_t *req, const char *status)
+{
+	httpd_resp_set_status(req, status);
+	return httpd_resp_send(req, NULL, 0);
+}
+
+static esp_err_t telegram_webhook_handler(httpd_req_t *req)
+{
+	int data_read;
+	size_t total_data_read = 0;
+	char *buffer = NULL;
+	char *reply = NULL;
+	esp_err_t err;
+	telegram_webhook_t *hook = (telegram_webhook_t *)req->user_ctx;
+
+	if (!telegram_webhook_check_secret(hook, req))
+	{
+		ESP_LOGW(TAG, "Wrong secret token");
+		return telegram_webhook_send_status(req, "401 Unauthorized");
+	}
+
+	if (req->content_len == 0)
+	{
+		ESP_LOGE(TAG, "Empty body");
+		return telegram_webhook_send_status(req, "400 Bad Request");
+	}
+
+	if (req->content_len > TELEGRAM_MAX_BUFFER)
+	{
+		ESP_LOGE(TAG, "Wrong content length %d", req->content_len);
+		return telegram_webhook_send_status(req, "413 Payload Too Large");
+	}
+
+	buffer = telegram_calloc(TELEGRAM_MEM_IO, 1, req->content_len + 1);
+	if (buffer == NULL)
+	{
+		ESP_LOGE(TAG, "No mem!");
+		/* Telegram will redeliver the update later */
+		return telegram_webhook_send_status(req, "503 Service Unavailable");
+	}
+
+	while (total_data_read < req->content_len)
+	{
+		data_read = httpd_req_recv(req, &buffer[total_data_read], req->content_len - total_data_read);
+		if (data_read == HTTPD_SOCK_ERR_TIMEOUT)
+		{
+			continue;
+		}
+
+		if (data_read <= 0)
+		{
+			ESP_LOGE(TAG, "Data read error: %d %d", data_read, total_data_read);
+			telegram_free_tag(TELEGRAM_MEM_IO, buffer);
+			return ESP_FAIL;
+		}
+
+		total_data_read += data_read;
+	}
+
+	reply = hook->on_update(hook->ctx, buffer);
+	telegram_free_tag(TELEGRAM_MEM_IO, buffer);
+	if (reply == NULL)
+	{
+		return telegram_webhook_send_status(req, "200 OK");
+	}
+
+	httpd_resp_set_type(req, "application/json");
+	err = httpd_resp_send(req, reply, strlen(reply));
+	telegram_free_tag(TELEGRAM_MEM_MAKE, reply);
+	return err;
+}
+
+static esp_err_t telegram_webhook_start_server(telegram_webhook_t *hook, const telegram_webhook_cfg_t *cfg)
+{
+	uint32_t stack_size = (cfg->stack_size != 0) ? cfg->stack_size : TELEGRAM_WEBHOOK_TASK_STACK;
+#if TELEGRAM_WEBHOOK_HTTPS == 1
+	httpd_ssl_config_t conf = HTTPD_SSL_CONFIG_DEFAULT();
+
+	if ((cfg->cert_pem == NULL) || (cfg->key_pem == NULL))
+	{
+		ESP_LOGE(TAG, "Certificate and key are required");
+		return ESP_ERR_INVALID_ARG;
+	}
+
+	conf.cacert_pem = cfg->cert_pem;
+	conf.cacert_len = cfg->cert_len;
+	conf.prvtkey_pem = cfg->key_pem;
+	conf.prvtkey_len = cfg->key_len;
+	conf.port_secure = cfg->port;
+	/* TLS server default is already larger, do not shrink it */
+	if ((cfg->stack_size != 0) || (conf.httpd.stack_size < stack_size))
+	{
+		conf.httpd.stack_size = stack_size;
+	}
+	return httpd_ssl_start(&hook->server, &conf);
+#else
+	httpd_config_t conf = HTTPD_DEFAULT_CONFIG();
+
+	conf.server_port = cfg->port;
+	conf.stack_size = stack_size;
+	return httpd_start(&hook->server, &conf);
+#endif
+}
+
+static void telegram_webhook_stop_server(telegram_webhook_t *hook)
+{
+#if TELEGRAM_WEBHOOK_HTTPS == 1
+	httpd_ssl_stop(hook->server);
+#else
+	httpd_stop(hook->server);
+#endif
+}
+
+void *telegram_webhook_init(const telegram_webhook_cfg_t *cfg, telegram_webhook_on_update_t on_update, void *ctx)
+{
+	esp_err_t err;
+	httpd_uri_t uri = {.method = HTTP_POST, .handler = telegram_webhook_handler, };
+	telegram_webhook_t *hook = NULL;
+
+	if ((cfg == NULL) || (on_update == NULL) || (cfg->port == 0))
+	{
+		return NULL;
+	}
+
+	hook = telegram_calloc(TELEGRAM_MEM_CORE, 1, sizeof(telegram_webhook_t));
+	if (hook == NULL)
+	{
+		return NULL;
+	}
+
+	hook->on_update = on_update;
+	hook->ctx = ctx;
+	hook->path = telegram_strdup(TELEGRAM_MEM_CORE, (cfg->path != NULL)?cfg->path:TELEGRAM_WEBHOOK_DEFAULT_PATH);
+	if (cfg->secret_token != NULL)
+	{
+		hook->secret_token = telegram_strdup(TELEGRAM_MEM_CORE, cfg->secret_token);
+	}
+
+	if ((hook->path == NULL) || ((cfg->secret_token != NULL) && (hook->secret_token == NULL)))
+	{
+		ESP_LOGE(TAG, "No mem!");
+		telegram_webhook_stop(hook);
+		return NULL;
+	}
+
+	err = telegram_webhook_start_server(hook, cfg);
+	if (err != ESP_OK)
+	{
+		ESP_LOGE(TAG, "Failed to start server err %d", err);
+		hook->server = NULL;
+		telegram_webhook_stop(hook);
+		return NULL;
+	}
+
+	uri.uri = hook->path;
+	uri.user_ctx = hook;
+	err = httpd_register_uri_handler(hook->server, &uri);
+	if (err != ESP_OK)
+	{
+		ESP_LOGE(TAG, "Failed to register handler err %d", err);
+		telegram_webhook_stop(hook);
+		return NULL;
+	}
+
+	ESP_LOGI(TAG, "Listening on port %d %s", cfg->port, hook->path);
+	return hook;
+}
+
+void telegram_webhook_stop(void *webhook)
+{
+	telegram_webhook_t *hook = (telegram_webhook_t *)webhook;
+
+	if (webhook == NULL)
+	{
+		return;
+	}
+
+	if (hook->server != NULL)
+	{
+		telegram_webhook_stop_server(hook);
+	}
+
+	telegram_free_tag(TELEGRAM_MEM_CORE, hook->secret_token);
+	telegram_free_tag(TELEGRAM_MEM_CORE, hook->path);
+	telegram_free_tag(TELEGRAM_MEM_CORE, hook);
+}